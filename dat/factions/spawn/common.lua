@@ -65,17 +65,51 @@ function scom.choose( stable )
 end
 
 
+-- @brief Checks to see if all the pilots are plain fleets
+function scom.isBatch( pilots )
+   for k,v in ipairs(pilots) do
+      if type(v["pilot"]) ~= 'string' then
+         return false
+      end
+   end
+   return true
+end
+
+
 -- @brief Actually spawns the pilots
+--
+-- Returns the table for the scheduler (nil if the engine already accounted
+-- the presence) and an array with all the pilots created.
 function scom.spawn( pilots, faction, guerilla )
    local spawned = {}
+   local created = {}
    local leader = nil
 
    -- Case no pilots
    if pilots == nil then
-      return nil
+      return nil, {}
    end
 
    local origin = pilot.choosePoint( faction, false, guerilla ) -- Find a suitable spawn point
+
+   -- Plain fleets are created in one go, presence is accounted by the engine
+   if scom.isBatch( pilots ) then
+      spawned = pilot.addBatch( pilots, origin )
+      if #pilots > 0 and #spawned == 0 then
+         error(_("No pilots added"))
+      end
+      if pilots.__fleet then
+         leader = spawned[1]
+         if pilots.__formation ~= nil then
+            leader:memory().formation = pilots.__formation
+         end
+         for i=2,#spawned do
+            spawned[i]:setLeader(leader)
+         end
+      end
+      return nil, spawned
+   end
+
    for k,v in ipairs(pilots) do
       local p
       if type(v["pilot"])=='function' then
@@ -103,9 +137,10 @@ function scom.spawn( pilots, faction, guerilla )
             end
          end
          spawned[ #spawned+1 ] = { pilot = vv, presence = presence }
+         created[ #created+1 ] = vv
       end
    end
-   return spawned
+   return spawned, created
 end
 
 
@@ -96,7 +96,7 @@ end
 
 -- @brief Spawning hook
 function spawn ( presence, max )
-   local pilots
+   local pilots, created
 
    -- Over limit
    if presence > max then
@@ -104,11 +104,11 @@ function spawn ( presence, max )
    end
   
    -- Actually spawn the pilots
-   pilots = scom.spawn( spawn_data, "Thurion" )
+   pilots, created = scom.spawn( spawn_data, "Thurion" )
    
    if not faction.get("Thurion"):known() then
-      for i, s in ipairs( pilots ) do
-         s.pilot:rename(_("Unknown"))
+      for i, p in ipairs( created ) do
+         p:rename(_("Unknown"))
       end
    end
 
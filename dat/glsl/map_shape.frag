@@ -0,0 +1,25 @@
+#version 140
+
+uniform float alpha;    /* Alpha of the whole batch. */
+
+in vec4 color;
+in vec2 pos;
+in float r;
+in float style;
+out vec4 color_out;
+
+void main(void) {
+   float d;
+
+   color_out = color;
+   if (style < .5) /* Ring. */
+      color_out.a *= 1. - clamp( abs( r - length( pos ) ), 0., 1. );
+   else if (style < 1.5) /* Filled circle. */
+      color_out.a *= clamp( r - length( pos ), 0., 1. );
+   else if (style < 2.5) { /* Faction disk, same falloff as gl_genFactionDisk(). */
+      d = dot( pos, pos ) / (r*r);
+      color_out.a *= (d < 1.) ? exp( 1. / (d + 1.) - .5 ) - 1. : 0.;
+   }
+   /* Anything else is solid. */
+   color_out.a *= alpha;
+}
@@ -0,0 +1,21 @@
+#version 140
+
+uniform mat4 projection;
+uniform float zoom;     /* Map zoom, world to screen units. */
+uniform float radius;   /* Radius of the system circles on screen. */
+
+in vec4 vertex;         /* Centre in world coordinates, offset in radii. */
+in vec4 vertex_color;
+in vec4 shape;          /* World radius, system radius factor, padding, style. */
+out vec4 color;
+out vec2 pos;
+out float r;
+out float style;
+
+void main(void) {
+   r     = shape.x * zoom + shape.y * radius;
+   pos   = vertex.zw * (r + shape.z);
+   color = vertex_color;
+   style = shape.w;
+   gl_Position = projection * vec4( vertex.xy * zoom + pos, 0., 1. );
+}
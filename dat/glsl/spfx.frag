@@ -0,0 +1,11 @@
+#version 140
+
+uniform sampler2D sampler;
+
+in vec2 tex_coord;
+in float alpha;
+out vec4 color_out;
+
+void main(void) {
+   color_out = vec4( 1., 1., 1., alpha ) * texture(sampler, tex_coord);
+}
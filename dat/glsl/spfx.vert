@@ -0,0 +1,25 @@
+#version 140
+
+uniform mat4 projection;
+uniform vec2 dims;      /* Size of a sprite on screen. */
+uniform vec2 sprites;   /* Number of sprites on the x and y axis. */
+uniform vec2 tex_dims;  /* Size of a sprite in texture coordinates. */
+uniform int offset;     /* First instance of the batch. */
+uniform samplerBuffer instances; /* x, y, frame, alpha per instance. */
+
+in vec4 vertex;
+out vec2 tex_coord;
+out float alpha;
+
+void main(void) {
+   vec4 inst = texelFetch( instances, offset + gl_InstanceID );
+
+   /* Sprite sheet is laid out left to right, top to bottom. */
+   float frame = floor( inst.z + .5 );
+   float col   = mod( frame, sprites.x );
+   float row   = floor( frame / sprites.x );
+   tex_coord   = (vec2( col, sprites.y - row - 1. ) + vertex.xy) * tex_dims;
+
+   gl_Position = projection * vec4( inst.xy + vertex.xy * dims, 0., 1. );
+   alpha       = inst.w;
+}
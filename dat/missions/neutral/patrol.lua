@@ -242,7 +242,8 @@ function timer ()
    if timer_hook ~= nil then hook.rm( timer_hook ) end
 
    local player_pos = player.pilot():pos()
-   local enemies = pilot.get( paying_faction:enemies() )
+   local enemies = pilot.getInRadius( player_pos, 1500,
+         { faction = paying_faction, rel = "enemy" } )
 
    for i, j in ipairs( enemies ) do
       if j ~= nil and j:exists() then
@@ -253,15 +254,13 @@ function timer ()
             end
          end
          if not already_in then
-            if player_pos:dist( j:pos() ) < 1500 then
-               j:setVisible( true )
-               j:setHilight( true )
-               j:setHostile( true )
-               hook.pilot( j, "death", "pilot_leave" )
-               hook.pilot( j, "jump", "pilot_leave" )
-               hook.pilot( j, "land", "pilot_leave" )
-               hostiles[ #hostiles + 1 ] = j
-            end
+            j:setVisible( true )
+            j:setHilight( true )
+            j:setHostile( true )
+            hook.pilot( j, "death", "pilot_leave" )
+            hook.pilot( j, "jump", "pilot_leave" )
+            hook.pilot( j, "land", "pilot_leave" )
+            hostiles[ #hostiles + 1 ] = j
          end
       end
    end
@@ -67,6 +67,8 @@
 #include <math.h>
 #include <ctype.h> /* isdigit */
 
+#include "SDL.h"
+
 /* yay more Lua */
 #include <lauxlib.h>
 #include <lualib.h>
@@ -107,6 +109,14 @@
 #define AI_DISTRESS     (1<<2)   /**< Sent distress signal. */
 
 
+/*
+ * level of detail
+ */
+#define AI_LOD_FAR_MOD  9.    /**< Squared sensor range multiplier beyond which a pilot is far. */
+#define AI_LOD_BUDGET   2000. /**< Microseconds per frame reduced detail thinks may use. */
+#define AI_LOD_MAXDEFER 0.5   /**< Seconds a think may be deferred by the budget. */
+
+
 /*
  * file info
  */
@@ -121,6 +131,16 @@ static AI_Profile* profiles = NULL; /**< Array of AI_Profiles loaded. */
 static nlua_env equip_env = LUA_NOREF; /**< Equipment enviornment. */
 
 
+/*
+ * level of detail scheduling
+ */
+static const double ai_lod_interval[AI_LOD_MAX] = {
+   0., 0.1, 0.25, 0.5 }; /**< Seconds between thinks per level of detail. */
+static AIStats ai_stats; /**< Counters of the current frame. */
+static AIStats ai_stats_last; /**< Counters of the last complete frame. */
+static double ai_lod_time = 0.; /**< Microseconds used by reduced detail thinks this frame. */
+
+
 /*
  * extern pilot hacks
  */
@@ -140,6 +160,9 @@ static int ai_loadEquip (void);
 /* Task management. */
 static void ai_taskGC( Pilot* pilot );
 static Task* ai_curTask( Pilot* pilot );
+static int ai_inCombat( const Pilot *pilot, const Task *t );
+static AILod ai_lod( Pilot *pilot, Task *t );
+static void ai_thinkRun( Pilot *pilot );
 static Task* ai_createTask( lua_State *L, int subtask );
 static int ai_tasktarget( lua_State *L, Task *t );
 
@@ -162,6 +185,8 @@ static int aiL_getsubtarget( lua_State *L ); /* pointer subtarget() */
 static int aiL_pilot( lua_State *L ); /* number pilot() */
 static int aiL_getrndpilot( lua_State *L ); /* number getrndpilot() */
 static int aiL_getnearestpilot( lua_State *L ); /* number getnearestpilot() */
+static int aiL_getnearestpilots( lua_State *L ); /* table nearestpilots( [number], [string], [number] ) */
+static int aiL_getpilotsinradius( lua_State *L ); /* table pilotsinradius( number, [string] ) */
 static int aiL_getdistance( lua_State *L ); /* number getdist(Vector2d) */
 static int aiL_getflybydistance( lua_State *L ); /* number getflybydist(Vector2d) */
 static int aiL_minbrakedist( lua_State *L ); /* number minbrakedist( [number] ) */
@@ -267,6 +292,8 @@ static const luaL_Reg aiL_methods[] = {
    { "pilot", aiL_pilot },
    { "rndpilot", aiL_getrndpilot },
    { "nearestpilot", aiL_getnearestpilot },
+   { "nearestpilots", aiL_getnearestpilots },
+   { "pilotsinradius", aiL_getpilotsinradius },
    { "dist", aiL_getdistance },
    { "flyby_dist", aiL_getflybydistance },
    { "minbrakedist", aiL_minbrakedist },
@@ -736,22 +763,184 @@ void ai_exit (void)
 }
 
 
+/**
+ * @brief Resets the AI think budget, called once per frame before pilots think.
+ */
+void ai_lodFrame (void)
+{
+   ai_stats_last = ai_stats;
+   memset( &ai_stats, 0, sizeof(AIStats) );
+   ai_lod_time = 0.;
+}
+
+
+/**
+ * @brief Gets the AI level of detail counters of the last frame.
+ *
+ *    @param[out] stats Counters of the last frame.
+ */
+void ai_getStats( AIStats *stats )
+{
+   *stats = ai_stats_last;
+}
+
+
+/**
+ * @brief Checks to see if a pilot is fighting or fleeing a fight.
+ *
+ * The AI scripts don't flag combat themselves, so this goes by the tasks
+ *  they run and by whether the pilot is targeting an enemy.
+ *
+ *    @param pilot Pilot to check.
+ *    @param t Current task of the pilot.
+ *    @return 1 if the pilot is in combat.
+ */
+static int ai_inCombat( const Pilot *pilot, const Task *t )
+{
+   const Task *st;
+   const Pilot *target;
+
+   if (pilot_isFlag(pilot, PILOT_COMBAT))
+      return 1;
+
+   if (t != NULL) {
+      if ((strcmp(t->name, "attack") == 0) ||
+            (strcmp(t->name, "runaway") == 0) ||
+            (strcmp(t->name, "board") == 0) ||
+            (strncmp(t->name, "atk", 3) == 0))
+         return 1;
+      for (st=t->subtask; st!=NULL; st=st->next)
+         if (strncmp(st->name, "_atk", 4) == 0)
+            return 1;
+   }
+
+   if ((pilot->target != 0) && (pilot->target != pilot->id)) {
+      target = pilot_get( pilot->target );
+      if ((target != NULL) && areEnemies( pilot->faction, target->faction ))
+         return 1;
+   }
+
+   return 0;
+}
+
+
+/**
+ * @brief Gets the level of detail a pilot should think at.
+ *
+ * Pilots the player can see, pilots in combat and pilots under manual
+ *  control always think every frame. The rest think less often the
+ *  further they are from the player, and even less so when idling.
+ *
+ *    @param pilot Pilot to get level of detail of.
+ *    @param t Current task of the pilot.
+ *    @return Level of detail of the pilot.
+ */
+static AILod ai_lod( Pilot *pilot, Task *t )
+{
+   double d;
+
+   if (pilot_isFlag(pilot, PILOT_PLAYER) ||
+         pilot_isFlag(pilot, PILOT_MANUAL_CONTROL))
+      return AI_LOD_FULL;
+
+   /* Nobody to see anything while the system is simulated. */
+   if (space_isSimulation())
+      return AI_LOD_FAR;
+
+   if (ai_inCombat( pilot, t ))
+      return AI_LOD_FULL;
+
+   /* Without a player there's nobody to notice. */
+   if ((player.p == NULL) || pilot_isFlag(player.p, PILOT_DEAD))
+      return AI_LOD_FAR;
+
+   /* Anything interacting with the player stays accurate. */
+   if ((player.p->target == pilot->id) || (pilot->target == PLAYER_ID) ||
+         (pilot->parent == PLAYER_ID))
+      return AI_LOD_FULL;
+
+   d = 0.;
+   if (pilot_inRangePilot( player.p, pilot, &d ) != 0)
+      return AI_LOD_FULL;
+
+   /* Approaches need to brake in time. */
+   if ((t != NULL) && ((strcmp(t->name, "hyperspace") == 0) ||
+         (strcmp(t->name, "land") == 0)))
+      return AI_LOD_NEAR;
+
+   /* Idling or waiting. */
+   if ((t == NULL) ||
+         (strcmp(t->name, "idle") == 0) ||
+         (strcmp(t->name, "donothing") == 0) ||
+         (strcmp(t->name, "hold") == 0) ||
+         (strcmp(t->name, "enterdelay") == 0))
+      return AI_LOD_IDLE;
+
+   if (d * pilot->ew_evasion > AI_LOD_FAR_MOD * pilot_sensorRange() * player.p->ew_detect)
+      return AI_LOD_FAR;
+   return AI_LOD_NEAR;
+}
+
+
 /**
  * @brief Heart of the AI, brains of the pilot.
  *
+ * Pilots with a reduced level of detail skip thinking until their
+ *  interval elapses, keeping their last thrust and turn. Their thinks
+ *  share a per frame budget and are pushed to later frames when it runs
+ *  out, unless they have been waiting for too long.
+ *
  *    @param pilot Pilot that needs to think.
+ *    @param dt Current delta tick.
  */
 void ai_think( Pilot* pilot, const double dt )
 {
-   nlua_env env;
-   (void) dt;
-
-   Task *t;
+   AILod lod;
+   Uint64 t0;
+   double us;
 
    /* Must have AI. */
    if (pilot->ai == NULL)
       return;
 
+   /* See if it's time to think. */
+   lod = ai_lod( pilot, ai_curTask( pilot ) );
+   pilot->tthink -= dt;
+   if (lod != AI_LOD_FULL) {
+      if (pilot->tthink > 0.) {
+         ai_stats.skipped++;
+         return;
+      }
+      if ((ai_lod_time > AI_LOD_BUDGET) && (pilot->tthink > -AI_LOD_MAXDEFER)) {
+         ai_stats.deferred++;
+         return;
+      }
+   }
+   /* Jitter the interval so pilots don't end up thinking on the same frame. */
+   pilot->tthink = ai_lod_interval[lod] * (0.75 + 0.5*RNGF());
+
+   t0 = SDL_GetPerformanceCounter();
+   ai_thinkRun( pilot );
+   us = 1e6 * (double)(SDL_GetPerformanceCounter() - t0) /
+         (double)SDL_GetPerformanceFrequency();
+
+   ai_stats.thinks[lod]++;
+   ai_stats.time += us;
+   if (lod != AI_LOD_FULL)
+      ai_lod_time += us;
+}
+
+
+/**
+ * @brief Runs the AI of a pilot.
+ *
+ *    @param pilot Pilot that needs to think.
+ */
+static void ai_thinkRun( Pilot *pilot )
+{
+   nlua_env env;
+   Task *t;
+
    ai_setPilot(pilot);
    env = cur_pilot->ai->env; /* set the AI profile to the current pilot's */
 
@@ -813,7 +1002,9 @@ void ai_think( Pilot* pilot, const double dt )
    pilot_setTurn( cur_pilot, pilot_turn );
    pilot_setThrust( cur_pilot, pilot_acc );
 
-   /* fire weapons if needed */
+   /* fire weapons if needed, nothing to hit while simulating the system */
+   if (space_isSimulation())
+      pilot_flags &= ~(AI_PRIMARY | AI_SECONDARY);
    if (ai_isFlag(AI_PRIMARY))
       pilot_shoot(cur_pilot, 0); /* primary */
    if (ai_isFlag(AI_SECONDARY))
@@ -1310,30 +1501,118 @@ static int aiL_getrndpilot( lua_State *L )
  */
 static int aiL_getnearestpilot( lua_State *L )
 {
+   PilotGridQuery q;
+   Pilot *t;
 
-   /*dist will be initialized to a number*/
-   /*this will only seek out pilots closer than dist*/
-   int dist=1000;
-   int i;
-   int candidate_id = -1;
+   /* This will only seek out pilots closer than 1000. */
+   pilot_gridQueryInit( &q, cur_pilot, PILOT_GRID_ANY );
+   q.maxdist = 1000.;
+   if (pilot_gridNearest( &q, cur_pilot->solid->pos.x, cur_pilot->solid->pos.y,
+            1, &t, NULL ) == 0)
+      return 0;
+
+   /* Actually found a pilot. */
+   lua_pushpilot(L, t->id);
+   return 1;
+}
 
-   /*cycle through all the pilots and find the closest one that is not the pilot */
 
-   for (i = 0; i<pilot_nstack; i++)
-   {
-       if (pilot_stack[i]->id != cur_pilot->id && vect_dist(&pilot_stack[i]->solid->pos, &cur_pilot->solid->pos) < dist)
-       {
-            dist = vect_dist(&pilot_stack[i]->solid->pos, &cur_pilot->solid->pos);
-            candidate_id = i;
-       }
+/**
+ * @brief Spatial query filter for pilots the AI can see.
+ */
+static int ai_filterVisible( const Pilot *p, const Pilot *target, void *data )
+{
+   (void) data;
+   return pilot_validTarget( p, target );
+}
+
+
+/**
+ * @brief Gets the relation parameter of a spatial query from Lua.
+ */
+static PilotGridRel ai_checkrel( lua_State *L, int ind )
+{
+   PilotGridRel rel;
+   const char *str;
+
+   str = luaL_optstring(L, ind, "any");
+   if (pilot_gridRelFromString( str, &rel ) != 0) {
+      NLUA_ERROR(L, _("Invalid relation '%s'."), str);
+      return PILOT_GRID_ANY;
    }
+   return rel;
+}
 
-   /* Last check. */
-   if (candidate_id == -1)
-      return 0;
 
-   /* Actually found a pilot. */
-   lua_pushpilot(L, pilot_stack[candidate_id]->id);
+/**
+ * @brief Gets the nearest pilots to the current pilot that it can see.
+ *
+ *    @luatparam[opt=1] number n Maximum number of pilots to get.
+ *    @luatparam[opt="any"] string rel Relation the pilots must have with the
+ *       current pilot, one of "any", "enemy", "ally" or "neutral".
+ *    @luatparam[opt] number radius Maximum distance to look in.
+ *    @luatreturn {Pilot,...} Pilots sorted by distance, nearest first.
+ *    @luafunc nearestpilots( n, rel, radius )
+ */
+static int aiL_getnearestpilots( lua_State *L )
+{
+   PilotGridQuery q;
+   Pilot *buf[16], **t;
+   int i, n, k;
+
+   k = luaL_optinteger(L, 1, 1);
+   if (k < 0)
+      NLUA_INVALID_PARAMETER(L);
+   /* Can't find more pilots than there are. */
+   k = MIN( k, pilot_nstack );
+
+   pilot_gridQueryInit( &q, cur_pilot, ai_checkrel(L, 2) );
+   q.maxdist = luaL_optnumber(L, 3, -1.);
+   q.filter  = ai_filterVisible;
+
+   t = (k <= (int)(sizeof(buf)/sizeof(buf[0]))) ? buf : malloc( k*sizeof(Pilot*) );
+   n = pilot_gridNearest( &q, cur_pilot->solid->pos.x, cur_pilot->solid->pos.y,
+         k, t, NULL );
+
+   lua_createtable(L, n, 0);
+   for (i=0; i<n; i++) {
+      lua_pushpilot(L, t[i]->id);
+      lua_rawseti(L, -2, i+1);
+   }
+
+   if (t != buf)
+      free(t);
+   return 1;
+}
+
+
+/**
+ * @brief Gets all the pilots the current pilot can see within a radius.
+ *
+ *    @luatparam number radius Radius to look in.
+ *    @luatparam[opt="any"] string rel Relation the pilots must have with the
+ *       current pilot, one of "any", "enemy", "ally" or "neutral".
+ *    @luatreturn {Pilot,...} Pilots in the radius, in no particular order.
+ *    @luafunc pilotsinradius( radius, rel )
+ */
+static int aiL_getpilotsinradius( lua_State *L )
+{
+   PilotGridQuery q;
+   Pilot **found;
+   double r;
+   int i, n;
+
+   r = luaL_checknumber(L, 1);
+   pilot_gridQueryInit( &q, cur_pilot, ai_checkrel(L, 2) );
+   q.filter = ai_filterVisible;
+   n = pilot_gridRadius( &q, cur_pilot->solid->pos.x, cur_pilot->solid->pos.y,
+         r, &found );
+
+   lua_createtable(L, n, 0);
+   for (i=0; i<n; i++) {
+      lua_pushpilot(L, found[i]->id);
+      lua_rawseti(L, -2, i+1);
+   }
    return 1;
 }
 
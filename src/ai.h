@@ -31,6 +31,29 @@ typedef struct Pilot_ Pilot;
 #define MAX_AI_TIMERS   2 /**< Max amount of AI timers. */
 
 
+/**
+ * @brief AI level of detail, decides how often a pilot thinks.
+ */
+typedef enum AILod_ {
+   AI_LOD_FULL,   /**< Thinks every frame: player, combat or near the player. */
+   AI_LOD_NEAR,   /**< Outside of the player's sensor range. */
+   AI_LOD_FAR,    /**< Far outside of the player's sensor range. */
+   AI_LOD_IDLE,   /**< Outside of sensor range and idling or leaving. */
+   AI_LOD_MAX     /**< Number of levels of detail. */
+} AILod;
+
+
+/**
+ * @brief Counters of the AI level of detail scheduler for a frame.
+ */
+typedef struct AIStats_ {
+   unsigned int thinks[AI_LOD_MAX]; /**< Thinks run per level of detail. */
+   unsigned int skipped; /**< Thinks skipped as the pilot's interval hasn't elapsed. */
+   unsigned int deferred; /**< Thinks pushed to the next frame by the budget. */
+   double time; /**< Microseconds spent thinking. */
+} AIStats;
+
+
 /**
  * @struct Task
  *
@@ -91,6 +114,8 @@ void ai_attacked( Pilot* attacked, const unsigned int attacker, double dmg );
 void ai_refuel( Pilot* refueler, unsigned int target );
 void ai_getDistress( Pilot *p, const Pilot *distressed, const Pilot *attacker );
 void ai_think( Pilot* pilot, const double dt );
+void ai_lodFrame (void);
+void ai_getStats( AIStats *stats );
 void ai_setPilot( Pilot *p );
 
 
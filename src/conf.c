@@ -215,6 +215,8 @@ void conf_setGameplayDefaults (void)
    conf.compression_velocity  = TIME_COMPRESSION_DEFAULT_MAX;
    conf.compression_mult      = TIME_COMPRESSION_DEFAULT_MULT;
    conf.save_compress         = SAVE_COMPRESSION_DEFAULT;
+   conf.semi_implicit         = SEMI_IMPLICIT_DEFAULT;
+   conf.fast_forward          = FAST_FORWARD_DEFAULT;
    conf.mouse_thrust          = MOUSE_THRUST_DEFAULT;
    conf.mouse_doubleclick     = MOUSE_DOUBLECLICK_TIME;
    conf.autonav_reset_speed   = AUTONAV_RESET_SPEED_DEFAULT;
@@ -236,6 +238,7 @@ void conf_setAudioDefaults (void)
    conf.sound_backend = strdup(BACKEND_DEFAULT);
    conf.snd_voices   = VOICES_DEFAULT;
    conf.snd_pilotrel = PILOT_RELATIVE_DEFAULT;
+   conf.snd_cache    = SOUND_CACHE_DEFAULT;
    conf.al_efx       = USE_EFX_DEFAULT;
    conf.al_bufsize   = BUFFER_SIZE_DEFAULT;
    conf.nosound      = MUTE_SOUND_DEFAULT;
@@ -411,6 +414,8 @@ int conf_loadConfig ( const char* file )
       conf_loadInt( lEnv, "snd_voices", conf.snd_voices );
       conf.snd_voices = MAX( 16, conf.snd_voices ); /* Must be at least 16. */
       conf_loadBool( lEnv, "snd_pilotrel", conf.snd_pilotrel );
+      conf_loadInt( lEnv, "snd_cache", conf.snd_cache );
+      conf.snd_cache = MAX( 0, conf.snd_cache );
       conf_loadBool( lEnv, "al_efx", conf.al_efx );
       conf_loadInt( lEnv, "al_bufsize", conf.al_bufsize );
       conf_loadBool( lEnv, "nosound", conf.nosound );
@@ -454,6 +459,8 @@ int conf_loadConfig ( const char* file )
       conf_loadFloat( lEnv, "compression_mult", conf.compression_mult );
       conf_loadBool( lEnv, "redirect_file", conf.redirect_file );
       conf_loadBool( lEnv, "save_compress", conf.save_compress );
+      conf_loadBool( lEnv, "semi_implicit", conf.semi_implicit );
+      conf_loadBool( lEnv, "fast_forward", conf.fast_forward );
       conf_loadInt( lEnv, "afterburn_sensitivity", conf.afterburn_sens );
       conf_loadInt( lEnv, "mouse_thrust", conf.mouse_thrust );
       conf_loadFloat( lEnv, "mouse_doubleclick", conf.mouse_doubleclick );
@@ -1001,6 +1008,10 @@ int conf_saveConfig ( const char* file )
    conf_saveBool("snd_pilotrel",conf.snd_pilotrel);
    conf_saveEmptyLine();
 
+   conf_saveComment(_("Memory budget of loaded sound effects (in mebibytes), 0 is unlimited."));
+   conf_saveInt("snd_cache",conf.snd_cache);
+   conf_saveEmptyLine();
+
    conf_saveComment(_("Enables EFX extension for OpenAL backend."));
    conf_saveBool("al_efx",conf.al_efx);
    conf_saveEmptyLine();
@@ -1105,6 +1116,14 @@ int conf_saveConfig ( const char* file )
    conf_saveBool("save_compress",conf.save_compress);
    conf_saveEmptyLine();
 
+   conf_saveComment(_("Uses a faster semi-implicit integrator for ship movement instead of RK4"));
+   conf_saveBool("semi_implicit",conf.semi_implicit);
+   conf_saveEmptyLine();
+
+   conf_saveComment(_("Skips rendering and effects and uses coarser steps under high time compression"));
+   conf_saveBool("fast_forward",conf.fast_forward);
+   conf_saveEmptyLine();
+
    conf_saveComment(_("Afterburner sensitivity"));
    conf_saveInt("afterburn_sensitivity",conf.afterburn_sens);
    conf_saveEmptyLine();
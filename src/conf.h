@@ -38,11 +38,14 @@
 #define SHOW_PAUSE_DEFAULT                   1     /**< Whether to display pause status. */
 #define ENGINE_GLOWS_DEFAULT                 1     /**< Whether to display engine glows. */
 #define MINIMIZE_DEFAULT                     1     /**< Whether to minimize on focus loss. */
+#define SEMI_IMPLICIT_DEFAULT                0     /**< Whether to use the semi-implicit integrator for ships. */
+#define FAST_FORWARD_DEFAULT                 1     /**< Whether autonav may fast-forward under high time compression. */
 /* Audio options */
 #define VOICES_DEFAULT                       128   /**< Amount of voices to use. */
 #define PILOT_RELATIVE_DEFAULT               1     /**< Whether the sound is relative to the pilot (as opposed to the camera). */
 #define USE_EFX_DEFAULT                      1     /**< Whether or not to use EFX (if using OpenAL). */
 #define BUFFER_SIZE_DEFAULT                  128   /**< Default buffer size (if using OpenAL). */
+#define SOUND_CACHE_DEFAULT                  64    /**< Default sound effect memory budget (in MiB). */
 #define MUTE_SOUND_DEFAULT                   0     /**< Whether sound should be disabled. */
 #define SOUND_VOLUME_DEFAULT                 0.6   /**< Default sound volume. */
 #define MUSIC_VOLUME_DEFAULT                 0.8   /**< Default music volume. */
@@ -95,6 +98,7 @@ typedef struct PlayerConf_s {
    char *sound_backend; /**< Sound backend to use. */
    int snd_voices; /**< Number of sound voices to use. */
    int snd_pilotrel; /**< Sound is relative to pilot when following. */
+   int snd_cache; /**< Memory budget for sound effect buffers (in mebibytes), 0 is unlimited. */
    int al_efx; /**< Should EFX extension be used? (only applicable for OpenAL) */
    int al_bufsize; /**< Size of the buffer (in kilobytes) to use for music. */
    int nosound; /**< Whether or not sound is on. */
@@ -139,6 +143,8 @@ typedef struct PlayerConf_s {
    double compression_mult; /**< Maximum time multiplier. */
    int redirect_file; /**< Redirect output to files. */
    int save_compress; /**< Compress savegame. */
+   int semi_implicit; /**< Use the semi-implicit integrator instead of RK4. */
+   int fast_forward; /**< Fast-forward under high time compression. */
    unsigned int afterburn_sens; /**< Afterburn sensibility. */
    int mouse_thrust; /**< Whether mouse flying controls thrust. */
    double mouse_doubleclick; /**< How long to consider double-clicks for. */
@@ -77,6 +77,7 @@ static void equipment_getDim( unsigned int wid, int *w, int *h,
       int *ew, int *eh,
       int *cw, int *ch, int *bw, int *bh );
 static void equipment_genShipList( unsigned int wid );
+static char *equipment_shipAltText( const char *name );
 static void equipment_genOutfitList( unsigned int wid );
 /* Widget. */
 static void equipment_genLists( unsigned int wid );
@@ -1319,18 +1320,43 @@ static void equipment_genLists( unsigned int wid )
 }
 
 
+/**
+ * @brief Generates the alt text of a player ship for the ship list.
+ *    @param name Name of the ship (image array caption).
+ *    @return Newly allocated alt text or NULL if there is none.
+ */
+static char *equipment_shipAltText( const char *name )
+{
+   int l;
+   char *alt;
+   Pilot *s;
+
+   s = player_getShip( (char*)name );
+   if (s == NULL)
+      return NULL;
+
+   alt = malloc( SHIP_ALT_MAX );
+   l   = nsnprintf( &alt[0], SHIP_ALT_MAX, _("Ship Stats\n") );
+   l   = equipment_shipStats( &alt[0], SHIP_ALT_MAX-l, s, 1 );
+   if (l == 0) {
+      free( alt );
+      return NULL;
+   }
+   return alt;
+}
+
+
 /**
  * @brief Generates the ship list.
  *    @param wid Window to generate list on.
  */
 static void equipment_genShipList( unsigned int wid )
 {
-   int i, l, n;
+   int i, n;
    ImageArrayCell *cships;
    int nships;
    int w, h;
    int sw, sh;
-   Pilot *s;
    const PlayerShip_t *ps;
    char r[PATH_MAX];
    glTexture *t;
@@ -1370,21 +1396,12 @@ static void equipment_genShipList( unsigned int wid )
             }
          }
       }
-      /* Ship stats in alt text. */
-      for (i=0; i<nships; i++) {
-         s        = player_getShip( cships[i].caption );
-         cships[i].alt = malloc( SHIP_ALT_MAX );
-         l        = nsnprintf( &cships[i].alt[0], SHIP_ALT_MAX, _("Ship Stats\n") );
-         l        = equipment_shipStats( &cships[i].alt[0], SHIP_ALT_MAX-l, s, 1 );
-         if (l == 0) {
-            free( cships[i].alt );
-            cships[i].alt = NULL;
-         }
-      }
-
       window_addImageArray( wid, 20, -40,
             sw, sh, EQUIPMENT_SHIPS, 96., 96.,
             cships, nships, equipment_updateShips, NULL );
+
+      /* Ship stats in alt text, generated when hovered. */
+      toolkit_setImageArrayAltCallback( wid, EQUIPMENT_SHIPS, equipment_shipAltText );
    }
 }
 
@@ -1486,6 +1503,7 @@ static void equipment_genOutfitList( unsigned int wid )
          coutfits, noutfits,
          equipment_updateOutfits,
          equipment_rightClickOutfits );
+   toolkit_setImageArrayAltCallback( wid, EQUIPMENT_OUTFITS, outfits_altText );
 }
 
 
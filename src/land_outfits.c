@@ -31,6 +31,7 @@
 #include "dialogue.h"
 #include "map_find.h"
 #include "land_takeoff.h"
+#include "array.h"
 
 
 #define  OUTFITS_IAR    "iarOutfits"
@@ -42,10 +43,12 @@
 typedef struct LandOutfitData_ {
    Outfit *outfits;
    int noutfits;
+   Outfit **shown; /**< Outfits in the image array, in order (array.h). */
 } LandOutfitData;
 
 
 static iar_data_t *iar_data = NULL; /**< Stored image array positions. */
+static Outfit **outfits_shown = NULL; /**< Outfits in the landed image array (array.h). */
 
 /* Modifier for buying and selling quantity. */
 static int outfits_mod = 1;
@@ -64,6 +67,8 @@ static void outfits_rmouse( unsigned int wid, char* widget_name );
 static void outfits_find( unsigned int wid, char* str );
 static credits_t outfit_getPrice( Outfit *outfit );
 static void outfits_genList( unsigned int wid );
+static Outfit ***outfits_getShown( unsigned int wid );
+static void outfits_updateQuantities( unsigned int wid );
 static void outfits_changeTab( unsigned int wid, char *wgt, int old, int tab );
 static void outfits_onClose( unsigned int wid, char *str );
 
@@ -106,6 +111,7 @@ static void outfits_onClose( unsigned int wid, char *str )
    if (data==NULL)
       return;
    free( data->outfits );
+   array_free( data->shown );
    free( data );
 }
 
@@ -295,6 +301,7 @@ static void outfits_genList( unsigned int wid )
    int w, h, iw, ih;
    char *filtertext;
    LandOutfitData *data;
+   Outfit ***shown;
 
    /* Get dimensions. */
    outfits_getSize( wid, &w, &h, &iw, &ih, NULL, NULL );
@@ -332,6 +339,11 @@ static void outfits_genList( unsigned int wid )
          filtertext = NULL;
    }
 
+#ifdef DEBUGGING
+   /* Make sure the owned outfit counts haven't drifted. */
+   player_outfitCountsCheck();
+#endif /* DEBUGGING */
+
    /* Set up the outfits to buy/sell */
    data = window_getData( wid );
    if (data == NULL) {
@@ -346,12 +358,22 @@ static void outfits_genList( unsigned int wid )
    }
    noutfits = outfits_filter( outfits, noutfits,
          tabfilters[active], filtertext );
+
+   /* Remember what is shown so quantities can be updated in place. */
+   shown = outfits_getShown( wid );
+   if (*shown == NULL)
+      *shown = array_create_size( Outfit*, MAX(1,noutfits) );
+   array_resize( shown, noutfits );
+   if (noutfits > 0)
+      memcpy( *shown, outfits, sizeof(Outfit*) * noutfits );
+
    coutfits = outfits_imageArrayCells( outfits, &noutfits );
    free(outfits);
 
    window_addImageArray( wid, 20, 20,
          iw, ih - 31, OUTFITS_IAR, 64, 64,
          coutfits, noutfits, outfits_update, outfits_rmouse );
+   toolkit_setImageArrayAltCallback( wid, OUTFITS_IAR, outfits_altText );
 
    /* write the outfits stuff */
    outfits_update( wid, NULL );
@@ -468,6 +490,53 @@ void outfits_update( unsigned int wid, char* str )
 }
 
 
+/**
+ * @brief Gets the list of outfits shown in an outfitter window.
+ *
+ *    @param wid Outfitter window.
+ *    @return Pointer to the array of outfits shown, in image array order.
+ */
+static Outfit ***outfits_getShown( unsigned int wid )
+{
+   LandOutfitData *data;
+
+   data = window_getData( wid );
+   if (data == NULL)
+      return &outfits_shown;
+   return &data->shown;
+}
+
+
+/**
+ * @brief Updates the quantities shown in the outfitter without rebuilding it.
+ *
+ * The set of outfits for sale doesn't change while landed, so when the player
+ * gains or loses outfits only the owned counts need refreshing.
+ *
+ *    @param wid Outfitter window.
+ */
+static void outfits_updateQuantities( unsigned int wid )
+{
+   int i;
+   Outfit **shown;
+   LandOutfitData *data;
+
+   /* Must exist. */
+   data = window_getData( wid );
+   if ((data==NULL) && (land_getWid( LAND_WINDOW_OUTFITS ) == 0))
+      return;
+   if (!widget_exists( wid, OUTFITS_IAR ))
+      return;
+
+   shown = *outfits_getShown( wid );
+   for (i=0; i<array_size(shown); i++)
+      toolkit_setImageArrayQuantity( wid, OUTFITS_IAR, i,
+            player_outfitOwned( shown[i] ) );
+
+   outfits_update( wid, NULL );
+}
+
+
 /**
  * @brief Updates the outfitter and equipment outfit image arrays.
  */
@@ -478,7 +547,7 @@ void outfits_updateEquipmentOutfits( void )
    if (landed && land_doneLoading()) {
       if (planet_hasService(land_planet, PLANET_SERVICE_OUTFITS)) {
          ow = land_getWid( LAND_WINDOW_OUTFITS );
-         outfits_regenList( ow, NULL );
+         outfits_updateQuantities( ow );
       }
       else if (!planet_hasService(land_planet, PLANET_SERVICE_SHIPYARD))
          return;
@@ -585,14 +654,57 @@ static credits_t outfit_getPrice( Outfit *outfit )
 }
 
 
+/**
+ * @brief Generates the alt text of an outfit for image arrays.
+ *
+ *    @param name Name of the outfit (image array caption).
+ *    @return Newly allocated alt text or NULL if there is none.
+ */
+char *outfits_altText( const char *name )
+{
+   int l, p;
+   double mass;
+   char *alt;
+   const Outfit *o;
+
+   o = outfit_getW( name );
+   if ((o == NULL) || (o->desc_short == NULL))
+      return NULL;
+
+   mass = o->mass;
+   if ((outfit_isLauncher(o) || outfit_isFighterBay(o)) &&
+         (outfit_ammo(o) != NULL)) {
+      mass += outfit_amount(o) * outfit_ammo(o)->mass;
+   }
+
+   l = strlen(o->desc_short) + 128;
+   alt = malloc( l );
+   p  = snprintf( &alt[0], l, "%s\n", o->name );
+   if (outfit_isProp(o, OUTFIT_PROP_UNIQUE))
+      p += snprintf( &alt[p], l-p, _("\aRUnique\a0\n") );
+   if ((o->slot.spid!=0) && (p < l))
+      p += snprintf( &alt[p], l-p, _("\aRSlot %s\a0\n"),
+            sp_display( o->slot.spid ) );
+   if (p < l)
+      p += snprintf( &alt[p], l-p, "\n%s", o->desc_short );
+   if ((o->mass > 0.) && (p < l))
+      snprintf( &alt[p], l-p,
+            _("\n%.0f Tonnes"),
+            mass );
+
+   return alt;
+}
+
+
 /**
  * @brief Generates image array cells corresponding to outfits.
+ *
+ * Alt text is not generated, set outfits_altText() as the image array's alt
+ * callback instead.
  */
 ImageArrayCell *outfits_imageArrayCells( Outfit **outfits, int *noutfits )
 {
    int i;
-   int l, p;
-   double mass;
    const glColour *c;
    ImageArrayCell *coutfits;
    Outfit *o;
@@ -608,7 +720,7 @@ ImageArrayCell *outfits_imageArrayCells( Outfit **outfits, int *noutfits )
       coutfits[0].caption = strdup( _("None") );
    }
    else {
-      /* Set alt text. */
+      /* Set up the cells. */
       for (i=0; i<*noutfits; i++) {
          o = outfits[i];
 
@@ -622,31 +734,8 @@ ImageArrayCell *outfits_imageArrayCells( Outfit **outfits, int *noutfits )
             c = &cBlack;
          col_blend( &coutfits[i].bg, c, &cGrey70, 0.4 );
 
-         /* Short description. */
-         if (o->desc_short == NULL)
-            coutfits[i].alt = NULL;
-         else {
-            mass = o->mass;
-            if ((outfit_isLauncher(o) || outfit_isFighterBay(o)) &&
-                  (outfit_ammo(o) != NULL)) {
-               mass += outfit_amount(o) * outfit_ammo(o)->mass;
-            }
-
-            l = strlen(o->desc_short) + 128;
-            coutfits[i].alt = malloc( l );
-            p  = snprintf( &coutfits[i].alt[0], l, "%s\n", o->name );
-            if (outfit_isProp(o, OUTFIT_PROP_UNIQUE))
-               p += snprintf( &coutfits[i].alt[p], l-p, _("\aRUnique\a0\n") );
-            if ((o->slot.spid!=0) && (p < l))
-               p += snprintf( &coutfits[i].alt[p], l-p, _("\aRSlot %s\a0\n"),
-                     sp_display( o->slot.spid ) );
-            if (p < l)
-               p += snprintf( &coutfits[i].alt[p], l-p, "\n%s", o->desc_short );
-            if ((o->mass > 0.) && (p < l))
-               snprintf( &coutfits[i].alt[p], l-p,
-                     _("\n%.0f Tonnes"),
-                     mass );
-         }
+         /* Alt text is generated lazily by outfits_altText(). */
+         coutfits[i].alt = NULL;
 
          /* Slot type. */
          if ( (strcmp(outfit_slotName(o), "N/A") != 0)
@@ -778,8 +867,8 @@ static void outfits_buy( unsigned int wid, char* str )
       takeoff(1);
    free(outfitname);
 
-   /* Regenerate list. */
-   outfits_regenList( wid, NULL );
+   /* Update owned quantities. */
+   outfits_updateQuantities( wid );
 }
 /**
  * @brief Checks to see if the player can sell the selected outfit.
@@ -862,8 +951,8 @@ static void outfits_sell( unsigned int wid, char* str )
       takeoff(1);
    free(outfitname);
 
-   /* Regenerate list. */
-   outfits_regenList( wid, NULL );
+   /* Update owned quantities. */
+   outfits_updateQuantities( wid );
 }
 /**
  * @brief Gets the current modifier status.
@@ -919,4 +1008,8 @@ void outfits_cleanup( void )
       free(iar_data);
       iar_data = NULL;
    }
+
+   /* Free shown outfits. */
+   array_free( outfits_shown );
+   outfits_shown = NULL;
 }
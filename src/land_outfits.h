@@ -20,6 +20,7 @@ void outfits_updateEquipmentOutfits( void );
 int outfits_filter( Outfit **outfits, int n,
       int(*filter)( const Outfit *o ), char *name );
 ImageArrayCell *outfits_imageArrayCells( Outfit **outfits, int *n );
+char *outfits_altText( const char *name );
 int outfit_canBuy( char *outfit, Planet *planet );
 int outfit_canSell( char *outfit );
 void outfits_cleanup( void );
@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <math.h>
 #include <float.h>
+#include <string.h>
 
 #include "log.h"
 #include "toolkit.h"
@@ -61,7 +62,22 @@ static int listMapModeVisible = 0; /**< Whether the map mode list widget is visi
 static double commod_av_gal_price = 0; /**< Average price across the galaxy. */
 /* VBO. */
 static gl_vbo *map_vbo = NULL; /**< Map VBO. */
-static gl_vbo *marker_vbo = NULL;
+
+/* Cached map geometry, in world coordinates. */
+static int map_geometry_dirty = 1; /**< Whether the cached geometry must be rebuilt. */
+static gl_vbo *map_jumps_vbo  = NULL; /**< Static VBO with the known jump routes. */
+static int map_jumps_nvertex  = 0; /**< Number of vertices in the jump VBO. */
+static gl_vbo *map_shapes_vbo = NULL; /**< Static VBO with the disks, system circles and markers. */
+static int map_shapes_ndisks  = 0; /**< Number of faction disk vertices, at the start. */
+static int map_shapes_nsystems = 0; /**< Number of system circle vertices, after the disks. */
+static int map_shapes_nmarkers = 0; /**< Number of marker vertices, after the systems. */
+
+/* Styles of the map_shape shader. */
+#define MAP_SHAPE_RING     0. /**< Circle outline. */
+#define MAP_SHAPE_FILLED   1. /**< Filled circle. */
+#define MAP_SHAPE_DISK     2. /**< Faction disk fading out towards the edge. */
+#define MAP_SHAPE_SOLID    3. /**< Solid polygon. */
+#define MAP_SHAPE_FLOATS   (4+4+4) /**< Floats per vertex: vertex, colour and shape. */
 
 /*
  * extern
@@ -83,11 +99,21 @@ static void map_update( unsigned int wid );
 /* Render. */
 static void map_render( double bx, double by, double w, double h, void *data );
 static void map_renderPath( double x, double y, double a );
+static void map_jumpColours( StarSystem *sys, int j,
+      const glColour **col, const glColour **cole );
+static void map_genJumps (void);
+static void map_shapeVertex( GLfloat **buf, const GLfloat shape[4],
+      const Vector2d *pos, double ox, double oy, const glColour *c, double a );
+static void map_shapeQuad( GLfloat **buf, const GLfloat shape[4],
+      const Vector2d *pos, const glColour *c, double a );
+static double map_markerAngle( int num, int cur );
+static void map_genShapes (void);
+static void map_updateGeometry (void);
+static void map_renderShapes( double x, double y, double r,
+      int first, int n, double a );
 static void map_renderMarkers( double x, double y, double r, double a );
 static void map_renderCommod( double bx, double by, double x, double y,
                               double w, double h, double r, int editor);
-static void map_drawMarker( double x, double y, double r, double a,
-      int num, int cur, int type );
 /* Mouse. */
 static int map_mouse( unsigned int wid, SDL_Event* event, double mx, double my,
       double w, double h, void *data );
@@ -109,20 +135,9 @@ static void map_window_close( unsigned int wid, char *str );
  */
 int map_init (void)
 {
-   const double beta = M_PI / 9;
-   GLfloat vertex[6];
-
    /* Create the VBO. */
    map_vbo = gl_vboCreateStream( sizeof(GLfloat) * 3*(2+4), NULL );
 
-   vertex[0] = 1;
-   vertex[1] = 0;
-   vertex[2] = 1 + 3 * cos(beta);
-   vertex[3] = 3 * sin(beta);
-   vertex[4] = 1 + 3 * cos(beta);
-   vertex[5] = -3 * sin(beta);
-   marker_vbo = gl_vboCreateStatic( sizeof(GLfloat) * 6, vertex );
-
    gl_faction_disk = gl_genFactionDisk( 150. );
    return 0;
 }
@@ -140,6 +155,19 @@ void map_exit (void)
       gl_vboDestroy(map_vbo);
       map_vbo = NULL;
    }
+   if (map_jumps_vbo != NULL) {
+      gl_vboDestroy(map_jumps_vbo);
+      map_jumps_vbo = NULL;
+   }
+   if (map_shapes_vbo != NULL) {
+      gl_vboDestroy(map_shapes_vbo);
+      map_shapes_vbo = NULL;
+   }
+   map_jumps_nvertex   = 0;
+   map_shapes_ndisks   = 0;
+   map_shapes_nsystems = 0;
+   map_shapes_nmarkers = 0;
+   map_geometry_dirty  = 1;
 
    if (gl_faction_disk != NULL)
       gl_freeTexture( gl_faction_disk );
@@ -200,6 +228,9 @@ void map_open (void)
    /* mark systems as needed */
    mission_sysMark();
 
+   /* Reachability and faction colours depend on the current state. */
+   map_invalidateGeometry();
+
    /* Attempt to select current map if none is selected */
    if (map_selected == -1)
       map_selectCur();
@@ -712,28 +743,16 @@ int map_isOpen (void)
 
 
 /**
- * @brief Draws a mission marker on the map.
+ * @brief Gets the angle a mission marker is drawn at around its system.
  *
- * @param x X position to draw at.
- * @param y Y position to draw at.
- * @param r Radius of system.
- * @param a Colour alpha to use.
  * @param num Total number of markers.
  * @param cur Current marker to draw.
- * @param type Type to draw.
+ * @return Angle of the marker.
  */
-static void map_drawMarker( double x, double y, double r, double a,
-      int num, int cur, int type )
+static double map_markerAngle( int num, int cur )
 {
-   static const glColour* colours[] = {
-      &cGreen, &cBlue, &cRed, &cOrange, &cYellow
-   };
-
    double alpha;
-   glColour col;
-   gl_Matrix4 projection;
 
-   /* Calculate the angle. */
    if ((num == 1) || (num == 2) || (num == 4))
       alpha = M_PI/4.;
    else if (num == 3)
@@ -743,20 +762,7 @@ static void map_drawMarker( double x, double y, double r, double a,
    else
       alpha = M_PI/2.;
 
-   alpha += M_PI*2. * (double)cur/(double)num;
-
-   /* Draw the marking triangle. */
-   glEnable(GL_POLYGON_SMOOTH);
-   col = *colours[type];
-   col.a *= a;
-   projection = gl_Matrix4_Translate(gl_view_matrix, x, y, 0);
-   projection = gl_Matrix4_Scale(projection, r, r, 1);
-   projection = gl_Matrix4_Rotate2d(projection, alpha);
-   gl_beginSolidProgram(projection, &col);
-   gl_vboActivateAttribOffset( marker_vbo, shaders.solid.vertex, 0, 2, GL_FLOAT, 0 );
-   glDrawArrays( GL_TRIANGLES, 0, 3 );
-   gl_endSolidProgram();
-   glDisable(GL_POLYGON_SMOOTH);
+   return alpha + M_PI*2. * (double)cur/(double)num;
 }
 
 /**
@@ -973,11 +979,18 @@ void map_renderFactionDisks( double x, double y, int editor)
    /* Fade in the disks to allow toggling between commodity and nothing */
    double cc = cos ( commod_counter / 200. * M_PI );
 
+   /* Regular map uses the cached geometry. */
+   if (!editor) {
+      map_updateGeometry();
+      map_renderShapes( x, y, 0., 0, map_shapes_ndisks, cc );
+      return;
+   }
+
    for (i=0; i<systems_nstack; i++) {
       sys = system_getIndex( i );
 
-      /* System has no faction, or isn't known and we aren't in the editor. */
-      if (sys->faction == -1 || (!sys_isKnown(sys) && !editor))
+      /* System has no faction. */
+      if (sys->faction == -1)
          continue;
 
       tx = x + sys->pos.x*map_zoom;
@@ -1005,25 +1018,388 @@ void map_renderFactionDisks( double x, double y, int editor)
 }
 
 
+/**
+ * @brief Marks the cached map geometry as needing to be rebuilt.
+ *
+ * Called by the known state setters, when markers or the player's faction
+ * standings change, and whenever the universe is modified, for example when
+ * applying or removing a diff.
+ */
+void map_invalidateGeometry (void)
+{
+   map_geometry_dirty = 1;
+}
+
+
+/**
+ * @brief Chooses the colours of both ends of a jump route.
+ *
+ *    @param sys System the jump starts at.
+ *    @param j Index of the jump in the system.
+ *    @param[out] col Colour at the start of the route.
+ *    @param[out] cole Colour at the end of the route.
+ */
+static void map_jumpColours( StarSystem *sys, int j,
+      const glColour **col, const glColour **cole )
+{
+   int k;
+   StarSystem *jsys;
+
+   jsys = sys->jumps[j].target;
+   *cole = &cLightBlue;
+   for (k = 0; k < jsys->njumps; k++) {
+      if (jsys->jumps[k].target == sys) {
+         if (jp_isFlag(&jsys->jumps[k], JP_EXITONLY))
+            *cole = &cWhite;
+         else if (jp_isFlag(&jsys->jumps[k], JP_HIDDEN))
+            *cole = &cRed;
+         break;
+      }
+   }
+   if (jp_isFlag(&sys->jumps[j], JP_EXITONLY))
+      *col = &cWhite;
+   else if (jp_isFlag(&sys->jumps[j], JP_HIDDEN))
+      *col = &cRed;
+   else
+      *col = &cLightBlue;
+}
+
+
+/**
+ * @brief Regenerates the static jump route geometry.
+ *
+ * Routes are stored as pairs of line segments in world coordinates, so that
+ * panning and zooming only change the transform used to draw them.
+ */
+static void map_genJumps (void)
+{
+   int i, j, n, nalloc;
+   const glColour *col, *cole;
+   GLfloat *pos, *colour;
+   GLfloat *vertex;
+   StarSystem *sys, *jsys;
+
+   /* Count the segments first. */
+   nalloc = 0;
+   for (i=0; i<systems_nstack; i++)
+      nalloc += system_getIndex( i )->njumps;
+   nalloc *= 4;
+
+   vertex = malloc( sizeof(GLfloat) * (2+4) * MAX(nalloc,1) );
+   pos    = vertex;
+   colour = &vertex[ 2*nalloc ];
+
+   n = 0;
+   for (i=0; i<systems_nstack; i++) {
+      sys = system_getIndex( i );
+      if (!sys_isKnown(sys))
+         continue; /* we don't draw hyperspace lines */
+
+      for (j = 0; j < sys->njumps; j++) {
+         jsys = sys->jumps[j].target;
+         if (!space_sysReachableFromSys(jsys,sys))
+            continue;
+
+         map_jumpColours( sys, j, &col, &cole );
+
+         /* Start to middle. */
+         pos[2*n+0] = sys->pos.x;
+         pos[2*n+1] = sys->pos.y;
+         pos[2*n+2] = (sys->pos.x + jsys->pos.x) / 2.;
+         pos[2*n+3] = (sys->pos.y + jsys->pos.y) / 2.;
+         /* Middle to end. */
+         pos[2*n+4] = pos[2*n+2];
+         pos[2*n+5] = pos[2*n+3];
+         pos[2*n+6] = jsys->pos.x;
+         pos[2*n+7] = jsys->pos.y;
+
+         colour[4*n+0]  = col->r;
+         colour[4*n+1]  = col->g;
+         colour[4*n+2]  = col->b;
+         colour[4*n+3]  = 0.2;
+         colour[4*n+4]  = (col->r + cole->r)/2.;
+         colour[4*n+5]  = (col->g + cole->g)/2.;
+         colour[4*n+6]  = (col->b + cole->b)/2.;
+         colour[4*n+7]  = 0.8;
+         memcpy( &colour[4*n+8], &colour[4*n+4], sizeof(GLfloat)*4 );
+         colour[4*n+12] = cole->r;
+         colour[4*n+13] = cole->g;
+         colour[4*n+14] = cole->b;
+         colour[4*n+15] = 0.2;
+
+         n += 4;
+      }
+   }
+
+   /* Pack the colours right after the used positions. */
+   if (n < nalloc)
+      memmove( &vertex[2*n], colour, sizeof(GLfloat) * 4*n );
+
+   if (map_jumps_vbo != NULL)
+      gl_vboDestroy( map_jumps_vbo );
+   map_jumps_vbo = gl_vboCreateStatic( sizeof(GLfloat) * (2+4) * MAX(n,1), vertex );
+   map_jumps_nvertex = n;
+   free( vertex );
+}
+
+
+/**
+ * @brief Adds a vertex to the shape geometry.
+ *
+ *    @param buf Array (array.h) to add the vertex to.
+ *    @param shape Shape parameters, see map_shape.vert.
+ *    @param pos Centre of the shape in world coordinates.
+ *    @param ox X offset of the vertex, in shape radii.
+ *    @param oy Y offset of the vertex, in shape radii.
+ *    @param c Colour of the shape.
+ *    @param a Alpha to multiply the colour by.
+ */
+static void map_shapeVertex( GLfloat **buf, const GLfloat shape[4],
+      const Vector2d *pos, double ox, double oy, const glColour *c, double a )
+{
+   GLfloat *v;
+   int n;
+
+   n = array_size( *buf );
+   array_resize( buf, n + MAP_SHAPE_FLOATS );
+   v = &(*buf)[n];
+   v[0] = pos->x;
+   v[1] = pos->y;
+   v[2] = ox;
+   v[3] = oy;
+   v[4] = c->r;
+   v[5] = c->g;
+   v[6] = c->b;
+   v[7] = c->a * a;
+   memcpy( &v[8], shape, sizeof(GLfloat) * 4 );
+}
+
+
+/**
+ * @brief Adds a quad covering a circular shape to the shape geometry.
+ *
+ *    @param buf Array (array.h) to add the quad to.
+ *    @param shape Shape parameters, see map_shape.vert.
+ *    @param pos Centre of the shape in world coordinates.
+ *    @param c Colour of the shape.
+ *    @param a Alpha to multiply the colour by.
+ */
+static void map_shapeQuad( GLfloat **buf, const GLfloat shape[4],
+      const Vector2d *pos, const glColour *c, double a )
+{
+   map_shapeVertex( buf, shape, pos, -1., -1., c, a );
+   map_shapeVertex( buf, shape, pos,  1., -1., c, a );
+   map_shapeVertex( buf, shape, pos, -1.,  1., c, a );
+   map_shapeVertex( buf, shape, pos, -1.,  1., c, a );
+   map_shapeVertex( buf, shape, pos,  1., -1., c, a );
+   map_shapeVertex( buf, shape, pos,  1.,  1., c, a );
+}
+
+
+/**
+ * @brief Regenerates the static faction disk, system circle and marker geometry.
+ *
+ * Shapes are stored as their centre in world coordinates and offsets in radii.
+ *  Disks scale with the zoom while systems and markers use the system radius,
+ *  so both are uniforms of the map_shape shader.
+ */
+static void map_genShapes (void)
+{
+   static const glColour* colours[] = {
+      &cGreen, &cBlue, &cRed, &cOrange, &cYellow
+   };
+   const double beta = M_PI / 9;
+   const GLfloat ring[4]   = { 0., 1., 1., MAP_SHAPE_RING };
+   const GLfloat filled[4] = { 0., 0.65, 0., MAP_SHAPE_FILLED };
+   const GLfloat marker[4] = { 0., 1., 0., MAP_SHAPE_SOLID };
+   GLfloat disk[4] = { 0., 0., 0., MAP_SHAPE_DISK };
+   double tri[6], presence, alpha, c, s;
+   int i, j, k, m, n, type, count[5];
+   StarSystem *sys;
+   GLfloat *buf;
+
+   /* Marker triangle, pointing at the system. */
+   tri[0] = 1.;
+   tri[1] = 0.;
+   tri[2] = 1. + 3. * cos(beta);
+   tri[3] = 3. * sin(beta);
+   tri[4] = 1. + 3. * cos(beta);
+   tri[5] = -3. * sin(beta);
+
+   buf = array_create( GLfloat );
+
+   /* Faction disks. */
+   for (i=0; i<systems_nstack; i++) {
+      sys = system_getIndex( i );
+      if ((sys->faction == -1) || !sys_isKnown(sys))
+         continue;
+
+      /* Cache to avoid repeated sqrt() */
+      presence = sqrt(sys->ownerpresence);
+      disk[0]  = (60. + presence * 3.) / 2.;
+      map_shapeQuad( &buf, disk, &sys->pos, faction_colour(sys->faction),
+            CLAMP( .4, .5, 13.3 / presence ) );
+   }
+   map_shapes_ndisks = array_size(buf) / MAP_SHAPE_FLOATS;
+
+   /* Systems that are known, reachable or marked. */
+   for (i=0; i<systems_nstack; i++) {
+      sys = system_getIndex( i );
+      if (!sys_isKnown(sys) && !sys_isFlag(sys, SYSTEM_MARKED | SYSTEM_CMARKED)
+            && !space_sysReachable(sys))
+         continue;
+
+      map_shapeQuad( &buf, ring, &sys->pos, &cInert, 1. );
+
+      /* If system is known fill it. */
+      if (sys_isKnown(sys) && system_hasPlanet(sys))
+         map_shapeQuad( &buf, filled, &sys->pos,
+               faction_getColour( sys->faction ), 1. );
+   }
+   map_shapes_nsystems = array_size(buf) / MAP_SHAPE_FLOATS - map_shapes_ndisks;
+
+   /* Mission markers. */
+   for (i=0; i<systems_nstack; i++) {
+      sys = system_getIndex( i );
+      if (!sys_isFlag(sys, SYSTEM_MARKED | SYSTEM_CMARKED))
+         continue;
+
+      count[0] = (sys_isFlag(sys, SYSTEM_CMARKED)) ? 1 : 0;
+      count[1] = sys->markers_plot;
+      count[2] = sys->markers_high;
+      count[3] = sys->markers_low;
+      count[4] = sys->markers_computer;
+      n = count[0] + count[1] + count[2] + count[3] + count[4];
+
+      j = 0;
+      for (type=0; type<5; type++) {
+         for (m=0; m<count[type]; m++) {
+            alpha = map_markerAngle( n, j );
+            c     = cos(alpha);
+            s     = sin(alpha);
+            for (k=0; k<3; k++)
+               map_shapeVertex( &buf, marker, &sys->pos,
+                     c*tri[2*k] - s*tri[2*k+1], s*tri[2*k] + c*tri[2*k+1],
+                     colours[type], 1. );
+            j++;
+         }
+      }
+   }
+   n = array_size(buf) / MAP_SHAPE_FLOATS;
+   map_shapes_nmarkers = n - map_shapes_ndisks - map_shapes_nsystems;
+
+   if (map_shapes_vbo != NULL)
+      gl_vboDestroy( map_shapes_vbo );
+   map_shapes_vbo = gl_vboCreateStatic( sizeof(GLfloat) * MAP_SHAPE_FLOATS * MAX(n,1), buf );
+   array_free( buf );
+}
+
+
+/**
+ * @brief Rebuilds the cached map geometry if it was invalidated.
+ */
+static void map_updateGeometry (void)
+{
+   if (!map_geometry_dirty)
+      return;
+   map_genJumps();
+   map_genShapes();
+   map_geometry_dirty = 0;
+}
+
+
+/**
+ * @brief Renders a range of the cached shape geometry.
+ *
+ *    @param x X position of the map origin on screen.
+ *    @param y Y position of the map origin on screen.
+ *    @param r Radius of the systems on screen.
+ *    @param first First vertex to render.
+ *    @param n Number of vertices to render.
+ *    @param a Alpha to render with.
+ */
+static void map_renderShapes( double x, double y, double r,
+      int first, int n, double a )
+{
+   gl_Matrix4 projection;
+
+   if (n <= 0)
+      return;
+
+   glUseProgram( shaders.map_shape.program );
+
+   /* Set the vertex. */
+   glEnableVertexAttribArray( shaders.map_shape.vertex );
+   glEnableVertexAttribArray( shaders.map_shape.vertex_color );
+   glEnableVertexAttribArray( shaders.map_shape.shape );
+   gl_vboActivateAttribOffset( map_shapes_vbo, shaders.map_shape.vertex,
+         0, 4, GL_FLOAT, sizeof(GLfloat) * MAP_SHAPE_FLOATS );
+   gl_vboActivateAttribOffset( map_shapes_vbo, shaders.map_shape.vertex_color,
+         sizeof(GLfloat) * 4, 4, GL_FLOAT, sizeof(GLfloat) * MAP_SHAPE_FLOATS );
+   gl_vboActivateAttribOffset( map_shapes_vbo, shaders.map_shape.shape,
+         sizeof(GLfloat) * 8, 4, GL_FLOAT, sizeof(GLfloat) * MAP_SHAPE_FLOATS );
+
+   /* Set shader uniforms. */
+   projection = gl_Matrix4_Translate( gl_view_matrix, x, y, 0 );
+   gl_Matrix4_Uniform( shaders.map_shape.projection, projection );
+   glUniform1f( shaders.map_shape.zoom, map_zoom );
+   glUniform1f( shaders.map_shape.radius, r );
+   glUniform1f( shaders.map_shape.alpha, a );
+
+   /* Draw. */
+   glDrawArrays( GL_TRIANGLES, first, n );
+
+   /* Clear state. */
+   glDisableVertexAttribArray( shaders.map_shape.vertex );
+   glDisableVertexAttribArray( shaders.map_shape.vertex_color );
+   glDisableVertexAttribArray( shaders.map_shape.shape );
+   glUseProgram(0);
+
+   /* Check errors. */
+   gl_checkErr();
+}
+
+
 /**
  * @brief Renders the jump routes between systems.
  */
 void map_renderJumps( double x, double y, int editor)
 {
-   int i, j, k;
+   int i, j;
    const glColour *col, *cole;
    GLfloat vertex[8*(2+4)];
    StarSystem *sys, *jsys;
+   gl_Matrix4 projection;
 
    /* Generate smooth lines. */
    glLineWidth( CLAMP(1., 4., 2. * map_zoom)*gl_screen.scale );
 
+   /* Regular map uses the cached geometry, drawn with a single call. */
+   if (!editor) {
+      map_updateGeometry();
+
+      if (map_jumps_nvertex > 0) {
+         projection = gl_Matrix4_Translate( gl_view_matrix, x, y, 0 );
+         projection = gl_Matrix4_Scale( projection, map_zoom, map_zoom, 1 );
+         gl_beginSmoothProgram( projection );
+         gl_vboActivateAttribOffset( map_jumps_vbo, shaders.smooth.vertex,
+               0, 2, GL_FLOAT, 0 );
+         gl_vboActivateAttribOffset( map_jumps_vbo, shaders.smooth.vertex_color,
+               sizeof(GLfloat) * 2*map_jumps_nvertex, 4, GL_FLOAT, 0 );
+         glDrawArrays( GL_LINES, 0, map_jumps_nvertex );
+         gl_endSmoothProgram();
+      }
+
+      /* Reset render parameters. */
+      glLineWidth( 1. );
+      return;
+   }
+
+   /* The editor moves systems around, so it generates lines every frame. */
+   map_geometry_dirty = 1;
    for (i=0; i<systems_nstack; i++) {
       sys = system_getIndex( i );
 
-      if (!sys_isKnown(sys) && !editor)
-         continue; /* we don't draw hyperspace lines */
-
       /* first we draw all of the paths. */
       gl_beginSmoothProgram(gl_view_matrix);
       gl_vboActivateAttribOffset( map_vbo, shaders.smooth.vertex, 0, 2, GL_FLOAT, 0 );
@@ -1031,26 +1407,9 @@ void map_renderJumps( double x, double y, int editor)
             sizeof(GLfloat) * 2*3, 4, GL_FLOAT, 0 );
       for (j = 0; j < sys->njumps; j++) {
          jsys = sys->jumps[j].target;
-         if (!space_sysReachableFromSys(jsys,sys) && !editor)
-            continue;
 
          /* Choose colours. */
-         cole = &cLightBlue;
-         for (k = 0; k < jsys->njumps; k++) {
-            if (jsys->jumps[k].target == sys) {
-               if (jp_isFlag(&jsys->jumps[k], JP_EXITONLY))
-                  cole = &cWhite;
-               else if (jp_isFlag(&jsys->jumps[k], JP_HIDDEN))
-                  cole = &cRed;
-               break;
-            }
-         }
-         if (jp_isFlag(&sys->jumps[j], JP_EXITONLY))
-            col = &cWhite;
-         else if (jp_isFlag(&sys->jumps[j], JP_HIDDEN))
-            col = &cRed;
-         else
-            col = &cLightBlue;
+         map_jumpColours( sys, j, &col, &cole );
 
          /* Draw the lines. */
          vertex[0]  = x + sys->pos.x * map_zoom;
@@ -1093,14 +1452,16 @@ void map_renderSystems( double bx, double by, double x, double y,
    StarSystem *sys;
    double tx, ty;
 
+   /* Regular map uses the cached geometry. */
+   if (!editor) {
+      map_updateGeometry();
+      map_renderShapes( x, y, r, map_shapes_ndisks, map_shapes_nsystems, 1. );
+      return;
+   }
+
    for (i=0; i<systems_nstack; i++) {
       sys = system_getIndex( i );
 
-      /* if system is not known, reachable, or marked. and we are not in the editor */
-      if ((!sys_isKnown(sys) && !sys_isFlag(sys, SYSTEM_MARKED | SYSTEM_CMARKED)
-           && !space_sysReachable(sys)) && !editor)
-         continue;
-
       tx = x + sys->pos.x*map_zoom;
       ty = y + sys->pos.y*map_zoom;
 
@@ -1111,22 +1472,11 @@ void map_renderSystems( double bx, double by, double x, double y,
       /* Draw an outer ring. */
       gl_drawCircle( tx, ty, r, &cInert, 0 );
 
-      /* If system is known fill it. */
-      if ((editor || sys_isKnown(sys)) && (system_hasPlanet(sys))) {
-         /* Planet colours */
-         if (!editor && !sys_isKnown(sys)) col = &cInert;
-         else if (sys->faction < 0) col = &cInert;
-         else if (editor) col = &cNeutral;
-         else col = faction_getColour( sys->faction );
-
-         if (editor) {
-            /* Radius slightly shorter. */
-            gl_drawCircle( tx, ty, 0.5 * r, col, 1 );
-         }
-         else
-            gl_drawCircle( tx, ty, 0.65 * r, col, 1 );
+      /* Fill systems with planets, radius slightly shorter than the map. */
+      if (system_hasPlanet(sys)) {
+         col = (sys->faction < 0) ? &cInert : &cNeutral;
+         gl_drawCircle( tx, ty, 0.5 * r, col, 1 );
       }
-
    }
 }
 
@@ -1266,51 +1616,11 @@ void map_renderNames( double bx, double by, double x, double y,
  */
 static void map_renderMarkers( double x, double y, double r, double a )
 {
-   double tx, ty;
-   int i, j, n, m;
-   StarSystem *sys;
-
-   for (i=0; i<systems_nstack; i++) {
-      sys = system_getIndex( i );
-
-      /* We only care about marked now. */
-      if (!sys_isFlag(sys, SYSTEM_MARKED | SYSTEM_CMARKED))
-         continue;
-
-      /* Get the position. */
-      tx = x + sys->pos.x*map_zoom;
-      ty = y + sys->pos.y*map_zoom;
-
-      /* Count markers. */
-      n  = (sys_isFlag(sys, SYSTEM_CMARKED)) ? 1 : 0;
-      n += sys->markers_plot;
-      n += sys->markers_high;
-      n += sys->markers_low;
-      n += sys->markers_computer;
-
-      /* Draw the markers. */
-      j = 0;
-      if (sys_isFlag(sys, SYSTEM_CMARKED)) {
-         map_drawMarker( tx, ty, r, a, n, j, 0 );
-         j++;
-      }
-      for (m=0; m<sys->markers_plot; m++) {
-         map_drawMarker( tx, ty, r, a, n, j, 1 );
-         j++;
-      }
-      for (m=0; m<sys->markers_high; m++) {
-         map_drawMarker( tx, ty, r, a, n, j, 2 );
-         j++;
-      }
-      for (m=0; m<sys->markers_low; m++) {
-         map_drawMarker( tx, ty, r, a, n, j, 3 );
-         j++;
-      }
-      for (m=0; m<sys->markers_computer; m++) {
-         map_drawMarker( tx, ty, r, a, n, j, 4 );
-         j++;
-      }
-   }
+   map_updateGeometry();
+   glEnable(GL_POLYGON_SMOOTH);
+   map_renderShapes( x, y, r, map_shapes_ndisks + map_shapes_nsystems,
+         map_shapes_nmarkers, a );
+   glDisable(GL_POLYGON_SMOOTH);
 }
 
 #define setcolour(R,G,B) ({ccol.r=(R);ccol.g=(G);ccol.b=(B);ccol.a=1;})
@@ -2325,13 +2635,13 @@ int map_map( const Outfit *map )
    int i;
 
    for (i=0; i<array_size(map->u.map->systems);i++)
-      sys_setFlag(map->u.map->systems[i], SYSTEM_KNOWN);
+      sys_setKnown(map->u.map->systems[i]);
 
    for (i=0; i<array_size(map->u.map->assets);i++)
       planet_setKnown(map->u.map->assets[i]);
 
    for (i=0; i<array_size(map->u.map->jumps);i++)
-      jp_setFlag(map->u.map->jumps[i], JP_KNOWN);
+      jp_setKnown(map->u.map->jumps[i]);
 
    return 1;
 }
@@ -2346,17 +2656,26 @@ int map_map( const Outfit *map )
 int map_isMapped( const Outfit* map )
 {
    int i;
+   const OutfitMapData_t *data;
 
-   for (i=0; i<array_size(map->u.map->systems);i++)
-      if (!sys_isKnown(map->u.map->systems[i]))
-         return 0;
+   data = map->u.map;
 
-   for (i=0; i<array_size(map->u.map->assets);i++)
-      if (!planet_isKnown(map->u.map->assets[i]))
-         return 0;
+   if (!space_knownSubset( SPACE_KNOWN_SYSTEM,
+            data->sys_mask.bits, data->sys_mask.nwords ))
+      return 0;
 
-   for (i=0; i<array_size(map->u.map->jumps);i++)
-      if (!jp_isKnown(map->u.map->jumps[i]))
+   if (!space_knownSubset( SPACE_KNOWN_JUMP,
+            data->jump_mask.bits, data->jump_mask.nwords ))
+      return 0;
+
+   if (space_knownSubset( SPACE_KNOWN_PLANET,
+            data->asset_mask.bits, data->asset_mask.nwords ))
+      return 1;
+
+   /* Assets that no longer belong to a system count as known, so fall back
+    * to checking them individually. */
+   for (i=0; i<array_size(data->assets);i++)
+      if (!planet_isKnown(data->assets[i]))
          return 0;
 
    return 1;
@@ -2384,7 +2703,7 @@ int localmap_map( const Outfit *lmap )
       if (jp_isFlag(jp, JP_EXITONLY) || jp_isFlag(jp, JP_HIDDEN))
          continue;
       if (mod*jp->hide <= detect)
-         jp_setFlag( jp, JP_KNOWN );
+         jp_setKnown( jp );
    }
 
    detect = lmap->u.lmap.asset_detect;
@@ -2451,6 +2770,9 @@ void map_show( int wid, int x, int y, int w, int h, double zoom )
    /* mark systems as needed */
    mission_sysMark();
 
+   /* Reachability and faction colours depend on the current state. */
+   map_invalidateGeometry();
+
    /* Set position to focus on current system. */
    map_xpos = cur_system->pos.x * zoom;
    map_ypos = cur_system->pos.y * zoom;
@@ -35,6 +35,7 @@ void map_select( StarSystem *sys, char shifted );
 void map_cleanup (void);
 void map_clear (void);
 void map_jump (void);
+void map_invalidateGeometry (void);
 
 /* manipulate universe stuff */
 StarSystem** map_getJumpPath( int* njumps, const char* sysstart,
@@ -19,6 +19,9 @@ struct OutfitMapData_s {
    StarSystem **systems; /**< systems to mark as known. */
    JumpPoint **jumps; /**< jump points to mark as known. */
    Planet **assets; /**< assets to mark as known. */
+   SpaceKnownSet sys_mask; /**< Bitset of the systems, by system ID. */
+   SpaceKnownSet jump_mask; /**< Bitset of the jump points, by jump point ID. */
+   SpaceKnownSet asset_mask; /**< Bitset of the assets, by planet ID. */
 };
 
 #endif /* MAPDATA_H */
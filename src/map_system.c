@@ -883,6 +883,7 @@ static void map_system_genOutfitsList( unsigned int wid, float goodsSpace, float
       window_addImageArray( wid, xpos, ypos,
                             xw, yh, MAPSYS_OUTFITS, 64, 64,
                             coutfits, noutfits, map_system_array_update, map_system_array_rmouse );
+      toolkit_setImageArrayAltCallback( wid, MAPSYS_OUTFITS, outfits_altText );
       toolkit_unsetSelection( wid, MAPSYS_OUTFITS );
    }
 }
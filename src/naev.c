@@ -131,6 +131,20 @@ static double real_dt   = 0.; /**< Real deltatick. */
 const double fps_min    = 1./30.; /**< Minimum fps to run at. */
 static double fps_x     =  15.; /**< FPS X position. */
 static double fps_y     = -15.; /**< FPS Y position. */
+static double render_dt = 0.; /**< Real time since the last render. */
+
+
+/*
+ * Fast-forward.
+ */
+#define FF_COMPRESSION  4.   /**< Time compression autonav starts fast-forwarding at. */
+#define FF_STEP_MOD     2.   /**< Multiplier of the minimum step while fast-forwarding. */
+#define FF_BUDGET       0.75 /**< Fraction of a display frame updates may use. */
+#define FF_DEBT_MAX     8.   /**< Maximum steps of game time carried to later frames. */
+static int ff_active    = 0; /**< Currently fast-forwarding. */
+static double ff_debt   = 0.; /**< Game time still to be simulated. */
+static double ff_rate   = 60.; /**< Display rate to render at while fast-forwarding. */
+static int ff_starved   = 0; /**< Last fast-forward pass ran out of game time to simulate. */
 
 #if HAS_LINUX && HAS_BFD && defined(DEBUGGING)
 static bfd *abfd      = NULL;
@@ -154,7 +168,10 @@ static void debug_sigClose (void);
 static void fps_init (void);
 static double fps_elapsed (void);
 static void fps_control (void);
+static void fps_delay( double delay );
 static void update_all (void);
+static int update_canFastForward (void);
+static void update_fastForward (void);
 static void render_all (void);
 /* Misc. */
 void loadscreen_render( double done, const char *msg ); /* nebula.c */
@@ -180,6 +197,8 @@ void naev_quit (void)
 int main( int argc, char** argv )
 {
    char buf[PATH_MAX], langbuf[PATH_MAX], *lang;
+   int ntex;
+   size_t texmem;
 
    env_detect( argc, argv );
 
@@ -405,6 +424,8 @@ int main( int argc, char** argv )
 
    /* Data loading */
    load_all();
+   texmem = gl_texMemory( &ntex, NULL );
+   DEBUG( _("Loaded %d textures (%.1f MiB)"), ntex, (double)texmem / (1024.*1024.) );
 
    /* Detect size changes that occurred during load. */
    naev_resize( -1., -1. );
@@ -756,6 +777,10 @@ void main_loop( int update )
    /*
     * Handle render.
     */
+   /* Fast-forwarding only renders at the display rate. */
+   render_dt += real_dt;
+   if (ff_active && !paused && update && (render_dt < 1./ff_rate))
+      return;
    /* Clear buffer. */
    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
    render_all();
@@ -765,6 +790,7 @@ void main_loop( int update )
    gl_checkErr(); /* check error every loop */
    /* Draw buffer. */
    SDL_GL_SwapWindow( gl_screen.window );
+   render_dt = 0.;
 }
 
 
@@ -918,29 +944,49 @@ static void fps_control (void)
 {
    double delay;
    double fps_max;
-#if HAS_POSIX
-   struct timespec ts;
-#endif /* HAS_POSIX */
 
    /* dt in s */
    real_dt  = fps_elapsed();
    game_dt  = real_dt * dt_mod; /* Apply the modifier. */
 
+   /* Fast-forwarding runs updates as fast as it can, but waits when it has
+    * simulated all the game time there is until a step or render is due. */
+   if (ff_active) {
+      if (ff_starved) {
+         delay = MIN( (FF_STEP_MOD*fps_min - ff_debt - game_dt) / dt_mod,
+               1./ff_rate - render_dt - real_dt );
+         if (delay > 0.)
+            fps_delay( delay );
+      }
+      return;
+   }
+
    /* if fps is limited */
    if (!conf.vsync && conf.fps_max != 0) {
       fps_max = 1./(double)conf.fps_max;
-      if (real_dt < fps_max) {
-         delay    = fps_max - real_dt;
+      if (real_dt < fps_max)
+         fps_delay( fps_max - real_dt );
+   }
+}
+
+
+/**
+ * @brief Sleeps for a while.
+ *
+ *    @param delay Time to sleep (in seconds).
+ */
+static void fps_delay( double delay )
+{
 #if HAS_POSIX
-         ts.tv_sec  = floor( delay );
-         ts.tv_nsec = fmod( delay, 1. ) * 1e9;
-         nanosleep( &ts, NULL );
+   struct timespec ts;
+
+   ts.tv_sec  = floor( delay );
+   ts.tv_nsec = fmod( delay, 1. ) * 1e9;
+   nanosleep( &ts, NULL );
 #else /* HAS_POSIX */
-         SDL_Delay( (unsigned int)(delay * 1000) );
+   SDL_Delay( (unsigned int)(delay * 1000) );
 #endif /* HAS_POSIX */
-         fps_dt  += delay; /* makes sure it displays the proper fps */
-      }
-   }
+   fps_dt  += delay; /* makes sure it displays the proper fps */
 }
 
 
@@ -958,7 +1004,17 @@ static void update_all (void)
       fps_skipped = 1;
       return;
    }
-   else if (game_dt > fps_min) { /* we'll force a minimum FPS for physics to work alright. */
+
+   /* Fast-forward when autonav compresses time enough. */
+   if (update_canFastForward()) {
+      update_fastForward();
+      fps_skipped = 0;
+      return;
+   }
+   ff_active = 0;
+   ff_debt   = 0.;
+
+   if (game_dt > fps_min) { /* we'll force a minimum FPS for physics to work alright. */
 
       /* Number of frames. */
       nf = ceil( game_dt / fps_min );
@@ -989,6 +1045,89 @@ static void update_all (void)
 }
 
 
+/**
+ * @brief Checks to see if the game can fast-forward.
+ *
+ *    @return 1 if autonav is compressing time enough to fast-forward.
+ */
+static int update_canFastForward (void)
+{
+   if (!conf.fast_forward)
+      return 0;
+   if ((player.p == NULL) || player_isFlag(PLAYER_DESTROYED) ||
+         pilot_isFlag(player.p, PILOT_DEAD))
+      return 0;
+   if (!player_isFlag(PLAYER_AUTONAV))
+      return 0;
+   return (dt_mod >= FF_COMPRESSION * player_dt_default());
+}
+
+
+/**
+ * @brief Fast-forwards the game.
+ *
+ * Game time is simulated in coarse fixed steps for as long as the frame
+ *  budget allows, with whatever is left over carried to the next frame.
+ *  Special effects are skipped and rendering is only done at the display
+ *  rate. Anything that makes autonav reset the time compression, like
+ *  hostiles showing up or taking damage, stops it immediately.
+ */
+static void update_fastForward (void)
+{
+   SDL_DisplayMode mode;
+   Uint64 t0, budget;
+   double step;
+
+   /* Starting up. */
+   if (!ff_active) {
+      ff_active = 1;
+      ff_debt   = 0.;
+      ff_rate   = (conf.fps_max > 0) ? conf.fps_max : 60.;
+      if ((SDL_GetWindowDisplayMode( gl_screen.window, &mode ) == 0) &&
+            (mode.refresh_rate > 0))
+         ff_rate = mode.refresh_rate;
+   }
+
+   step     = FF_STEP_MOD * fps_min;
+   ff_debt += game_dt;
+   t0       = SDL_GetPerformanceCounter();
+   budget   = (Uint64)(FF_BUDGET / ff_rate * SDL_GetPerformanceFrequency());
+   ff_starved = 1;
+   while (ff_debt >= step) {
+      update_routine( step, 0 );
+      ff_debt -= step;
+
+      /* Autonav slowed down, go back to normal updates. */
+      if (!update_canFastForward()) {
+         ff_active = 0;
+         ff_debt   = 0.;
+         return;
+      }
+
+      if (SDL_GetPerformanceCounter() - t0 > budget) {
+         ff_starved = 0;
+         break;
+      }
+   }
+
+   /* Don't try to catch up on more than we can handle. */
+   ff_debt = MIN( ff_debt, FF_DEBT_MAX * step );
+}
+
+
+/**
+ * @brief Checks to see if the game is fast-forwarding.
+ *
+ * Purely cosmetic work can be skipped while fast-forwarding.
+ *
+ *    @return 1 if the game is fast-forwarding.
+ */
+int naev_isFastForward (void)
+{
+   return ff_active;
+}
+
+
 /**
  * @brief Actually runs the updates
  *
@@ -1039,10 +1178,10 @@ static void render_all (void)
 {
    double dt;
 
-   dt = (paused) ? 0. : game_dt;
+   dt = (paused) ? 0. : render_dt * dt_mod;
 
    /* setup */
-   spfx_begin(dt, real_dt);
+   spfx_begin(dt, render_dt);
    /* BG */
    space_render(dt);
    planets_render();
@@ -1060,7 +1199,7 @@ static void render_all (void)
    spfx_end();
    gui_render(dt);
    ovr_render(dt);
-   display_fps( real_dt ); /* Exception. */
+   display_fps( render_dt ); /* Exception. */
 }
 
 
@@ -1075,6 +1214,12 @@ static void display_fps( const double dt )
 {
    double x,y;
    double dt_mod_base = 1.;
+#ifdef DEBUGGING
+   SoundStats sstats;
+   AIStats astats;
+   unsigned int nthink;
+   int i;
+#endif /* DEBUGGING */
 
    fps_dt  += dt;
    fps_cur += 1.;
@@ -1088,6 +1233,21 @@ static void display_fps( const double dt )
    if (conf.fps_show) {
       gl_print( NULL, x, y, NULL, "%3.2f", fps );
       y -= gl_defFont.h + 5.;
+#ifdef DEBUGGING
+      sound_getStats( &sstats );
+      gl_print( NULL, x, y, NULL, _("Sounds: %u played, %u culled, %u stolen"),
+            sstats.played, sstats.culled_range + sstats.culled_limit, sstats.stolen );
+      y -= gl_defFont.h + 5.;
+      ai_getStats( &astats );
+      nthink = 0;
+      for (i=0; i<AI_LOD_MAX; i++)
+         nthink += astats.thinks[i];
+      gl_print( NULL, x, y, NULL, _("AI: %u thinks (%u/%u/%u/%u), %u skipped, %u deferred, %.0f us"),
+            nthink, astats.thinks[AI_LOD_FULL], astats.thinks[AI_LOD_NEAR],
+            astats.thinks[AI_LOD_FAR], astats.thinks[AI_LOD_IDLE],
+            astats.skipped, astats.deferred, astats.time );
+      y -= gl_defFont.h + 5.;
+#endif /* DEBUGGING */
    }
 
    if ((player.p != NULL) && !player_isFlag(PLAYER_DESTROYED) &&
@@ -97,6 +97,7 @@ void fps_setPos( double x, double y );
 void naev_resize( int w, int h );
 void naev_toggleFullscreen (void);
 void update_routine( double dt, int enter_sys );
+int naev_isFastForward (void);
 int naev_versionString( char *str, size_t slen, int major, int minor, int rev );
 char *naev_version( int long_version );
 int naev_versionParse( int version[3], char *buf, int nbuf );
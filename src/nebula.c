@@ -29,15 +29,29 @@
 #include "camera.h"
 #include "nstring.h"
 #include "ndata.h"
+#include "threadpool.h"
 
 
 #define NEBULA_Z             16 /**< Z plane */
 #define NEBULA_PUFFS         32 /**< Amount of puffs to generate */
-#define NEBULA_PATH_BG       "nebu_bg_%dx%d_%02d.png" /**< Nebula path format. */
+#define NEBULA_VERSION       2 /**< Version of the nebula cache, bump when generation changes. */
+#define NEBULA_PATH_BG       "nebu_bg_v%d_%dx%d_%02d.png" /**< Nebula path format. */
 
 #define NEBULA_PUFF_BUFFER   300 /**< Nebula buffer */
 
 
+/**
+ * @brief Arguments for saving a nebula layer in a worker thread.
+ */
+typedef struct NebulaSaveArgs_ {
+   float *map;          /**< Nebula layer to save. */
+   int w;               /**< Width of the layer. */
+   int h;               /**< Height of the layer. */
+   char file[PATH_MAX]; /**< File to save to. */
+   int ret;             /**< Return value of saveNebula(). */
+} NebulaSaveArgs;
+
+
 /* Externs */
 extern void loadscreen_render( double done, const char *msg ); /**< from naev.c */
 
@@ -92,6 +106,7 @@ static int nebu_checkCompat( const char* file );
 static int nebu_loadTexture( SDL_Surface *sur, int w, int h, glTexture **tex );
 static int nebu_generate (void);
 static int saveNebula( float *map, const uint32_t w, const uint32_t h, const char* file );
+static int saveNebula_thread( void *data );
 static SDL_Surface* loadNebula( const char* file );
 static SDL_Surface* nebu_surfaceFromNebulaMap( float* map, const int w, const int h );
 /* Puffs. */
@@ -149,7 +164,7 @@ static int nebu_init_recursive( int iter )
 
    /* Load each, checking for compatibility and padding */
    for (i=0; i<NEBULA_Z; i++) {
-      nsnprintf( nebu_file, PATH_MAX, NEBULA_PATH_BG, nebu_w, nebu_h, i );
+      nsnprintf( nebu_file, PATH_MAX, NEBULA_PATH_BG, NEBULA_VERSION, nebu_w, nebu_h, i );
 
       /* Check compatibility. */
       if (nebu_checkCompat( nebu_file ))
@@ -508,7 +523,8 @@ static int nebu_generate (void)
    int i;
    float *nebu;
    const char *cache;
-   char nebu_file[PATH_MAX];
+   NebulaSaveArgs args[NEBULA_Z];
+   ThreadQueue *vpool;
    int w,h;
    int ret;
 
@@ -526,16 +542,30 @@ static int nebu_generate (void)
 
    /* Generate all the nebula backgrounds */
    nebu = noise_genNebulaMap( w, h, NEBULA_Z, 5. );
+   if (nebu == NULL)
+      return -1;
 
    /* Start saving - compression can take a bit. */
    loadscreen_render( 0.05, _("Compressing Nebula layers...") );
 
-   /* Save each nebula as an image */
+   /* Save each nebula as an image, compressing them in parallel. */
+   vpool = vpool_create();
    for (i=0; i<NEBULA_Z; i++) {
-      nsnprintf( nebu_file, PATH_MAX, NEBULA_PATH_BG, w, h, i );
-      ret = saveNebula( &nebu[ i*w*h ], w, h, nebu_file );
-      if (ret != 0)
-         break; /* An error has happened */
+      args[i].map  = &nebu[ i*w*h ];
+      args[i].w    = w;
+      args[i].h    = h;
+      args[i].ret  = 0;
+      nsnprintf( args[i].file, PATH_MAX, NEBULA_PATH_BG, NEBULA_VERSION, w, h, i );
+      vpool_enqueue( vpool, saveNebula_thread, &args[i] );
+   }
+   vpool_wait( vpool );
+
+   ret = 0;
+   for (i=0; i<NEBULA_Z; i++) {
+      if (args[i].ret != 0) {
+         ret = args[i].ret; /* An error has happened */
+         break;
+      }
    }
 
    /* Cleanup */
@@ -616,6 +646,20 @@ static int saveNebula( float *map, const uint32_t w, const uint32_t h, const cha
 }
 
 
+/**
+ * @brief Thread worker for saving a nebula layer.
+ *
+ *    @param data Arguments of type NebulaSaveArgs.
+ *    @return 0 on success.
+ */
+static int saveNebula_thread( void *data )
+{
+   NebulaSaveArgs *args = (NebulaSaveArgs*) data;
+   args->ret = saveNebula( args->map, args->w, args->h, args->file );
+   return 0;
+}
+
+
 /**
  * @brief Loads the nebulae from file.
  *
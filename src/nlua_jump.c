@@ -447,9 +447,9 @@ static int jumpL_setKnown( lua_State *L )
    changed = (b != (int)jp_isKnown(jp));
 
    if (b)
-      jp_setFlag( jp, JP_KNOWN );
+      jp_setKnown( jp );
    else
-      jp_rmFlag( jp, JP_KNOWN );
+      jp_rmKnown( jp );
 
    /* Update outfits image array. */
    if (changed)
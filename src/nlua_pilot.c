@@ -58,17 +58,24 @@ extern Pilot *cur_pilot;
  * Prototypes.
  */
 static Task *pilotL_newtask( lua_State *L, Pilot* p, const char *task );
+static void pilotL_spawnOrigin( lua_State *L, int ind, const char *name,
+      LuaFaction lf, Vector2d *vp, Vector2d *vv, double *a, PilotFlags flags );
 static int pilotL_addFleetFrom( lua_State *L, int from_ship );
 static int outfit_compareActive( const void *slot1, const void *slot2 );
+static int pilotL_filterQuery( const Pilot *ref, const Pilot *p, void *data );
+static void pilotL_pushPilotList( lua_State *L, Pilot **pilots, int n, int ind );
 
 
 /* Pilot metatable methods. */
 static int pilotL_addFleetRaw( lua_State *L );
 static int pilotL_addFleet( lua_State *L );
+static int pilotL_addBatch( lua_State *L );
 static int pilotL_remove( lua_State *L );
 static int pilotL_clear( lua_State *L );
 static int pilotL_toggleSpawn( lua_State *L );
 static int pilotL_getPilots( lua_State *L );
+static int pilotL_getInRadius( lua_State *L );
+static int pilotL_getHostiles( lua_State *L );
 static int pilotL_eq( lua_State *L );
 static int pilotL_name( lua_State *L );
 static int pilotL_id( lua_State *L );
@@ -156,8 +163,11 @@ static const luaL_Reg pilotL_methods[] = {
    /* General. */
    { "addRaw", pilotL_addFleetRaw },
    { "add", pilotL_addFleet },
+   { "addBatch", pilotL_addBatch },
    { "rm", pilotL_remove },
    { "get", pilotL_getPilots },
+   { "getInRadius", pilotL_getInRadius },
+   { "getHostiles", pilotL_getHostiles },
    { "__eq", pilotL_eq },
    /* Info. */
    { "name", pilotL_name },
@@ -414,6 +424,108 @@ static int pilotL_choosePoint( lua_State *L )
 }
 
 
+/**
+ * @brief Gets where to create a pilot from a Lua spawn parameter.
+ *
+ * See pilot.add for the parameters that are accepted.
+ *
+ *    @param L Lua state.
+ *    @param ind Index of the parameter.
+ *    @param name Name of what is being spawned, for warnings.
+ *    @param lf Faction of what is being spawned.
+ *    @param[out] vp Position to create at.
+ *    @param[out] vv Velocity to create with.
+ *    @param[out] a Direction to face.
+ *    @param[out] flags Flags to add to the created pilots.
+ */
+static void pilotL_spawnOrigin( lua_State *L, int ind, const char *name,
+      LuaFaction lf, Vector2d *vp, Vector2d *vv, double *a, PilotFlags flags )
+{
+   int i, ignore_rules;
+   double r;
+   StarSystem *ss;
+   Planet *planet;
+   JumpPoint *jump;
+
+   jump = NULL;
+   *a   = 0.;
+   vectnull( vv );
+
+   if (lua_isvector(L,ind)) {
+      *vp = *lua_tovector(L,ind);
+      *a = RNGF() * 2.*M_PI;
+      vectnull( vv );
+   }
+   else if (lua_issystem(L,ind)) {
+      ss = system_getIndex( lua_tosystem(L,ind) );
+      for (i=0; i<cur_system->njumps; i++) {
+         if ((cur_system->jumps[i].target == ss)
+               && !jp_isFlag( cur_system->jumps[i].returnJump, JP_EXITONLY )) {
+            jump = cur_system->jumps[i].returnJump;
+            break;
+         }
+      }
+      if (jump == NULL) {
+         if (cur_system->njumps > 0) {
+            WARN(_("Fleet '%s' jumping in from non-adjacent system '%s' to '%s'."),
+                  name, ss->name, cur_system->name );
+            jump = cur_system->jumps[RNG_BASE(0,cur_system->njumps-1)].returnJump;
+         }
+         else
+            WARN(_("Fleet '%s' attempting to jump in from '%s', but '%s' has no jump points."),
+                  name, ss->name, cur_system->name );
+      }
+   }
+   else if (lua_isplanet(L,ind)) {
+      planet  = luaL_validplanet(L,ind);
+      pilot_setFlagRaw( flags, PILOT_TAKEOFF );
+      *a = RNGF() * 2. * M_PI;
+      r = RNGF() * planet->radius;
+      vect_cset( vp,
+            planet->pos.x + r * cos(*a),
+            planet->pos.y + r * sin(*a) );
+      *a = RNGF() * 2.*M_PI;
+      vectnull( vv );
+   }
+   /* Random. */
+   else {
+      /* Check if we should ignore the strict rules. */
+      ignore_rules = 0;
+      if (lua_isboolean(L,ind) && lua_toboolean(L,ind))
+         ignore_rules = 1;
+
+      /* Choose the spawn point and act in consequence.*/
+      pilot_choosePoint( vp, &planet, &jump, lf, ignore_rules, 0 );
+
+      if (planet != NULL) {
+         pilot_setFlagRaw( flags, PILOT_TAKEOFF );
+         *a = RNGF() * 2. * M_PI;
+         r = RNGF() * planet->radius;
+         vect_cset( vp,
+               planet->pos.x + r * cos(*a),
+               planet->pos.y + r * sin(*a) );
+         *a = RNGF() * 2.*M_PI;
+         vectnull( vv );
+      }
+      else {
+         *a = RNGF() * 2.*M_PI;
+         vectnull( vv );
+      }
+   }
+
+   /* Set up velocities and such. */
+   if (jump != NULL) {
+      space_calcJumpInPos( cur_system, jump->from, vp, vv, a );
+      pilot_setFlagRaw( flags, PILOT_HYP_END );
+   }
+
+   /* Make sure angle is valid. */
+   *a = fmod( *a, 2.*M_PI );
+   if (*a < 0.)
+      *a += 2.*M_PI;
+}
+
+
 /**
  * @brief Wrapper with common code for pilotL_addFleet and pilotL_addFleetRaw.
  */
@@ -424,21 +536,15 @@ static int pilotL_addFleetFrom( lua_State *L, int from_ship )
    const char *fltname, *fltai, *faction;
    int i, first;
    unsigned int p;
-   double a, r;
+   double a;
    Vector2d vv, vp, vn;
    FleetPilot *plt;
    LuaFaction lf;
-   StarSystem *ss;
-   Planet *planet;
-   JumpPoint *jump;
    PilotFlags flags;
-   int ignore_rules;
 
    /* Default values. */
    pilot_clearFlagsRaw( flags );
    vectnull(&vn); /* Need to determine angle. */
-   jump = NULL;
-   a    = 0.;
 
    /* Parse first argument - Fleet Name */
    fltname = luaL_checkstring(L,1);
@@ -475,78 +581,7 @@ static int pilotL_addFleetFrom( lua_State *L, int from_ship )
       fltai = luaL_checkstring(L,2);
 
    /* Handle third argument. */
-   if (lua_isvector(L,3)) {
-      vp = *lua_tovector(L,3);
-      a = RNGF() * 2.*M_PI;
-      vectnull( &vv );
-   }
-   else if (lua_issystem(L,3)) {
-      ss = system_getIndex( lua_tosystem(L,3) );
-      for (i=0; i<cur_system->njumps; i++) {
-         if ((cur_system->jumps[i].target == ss)
-               && !jp_isFlag( cur_system->jumps[i].returnJump, JP_EXITONLY )) {
-            jump = cur_system->jumps[i].returnJump;
-            break;
-         }
-      }
-      if (jump == NULL) {
-         if (cur_system->njumps > 0) {
-            WARN(_("Fleet '%s' jumping in from non-adjacent system '%s' to '%s'."),
-                  fltname, ss->name, cur_system->name );
-            jump = cur_system->jumps[RNG_BASE(0,cur_system->njumps-1)].returnJump;
-         }
-         else
-            WARN(_("Fleet '%s' attempting to jump in from '%s', but '%s' has no jump points."),
-                  fltname, ss->name, cur_system->name );
-      }
-   }
-   else if (lua_isplanet(L,3)) {
-      planet  = luaL_validplanet(L,3);
-      pilot_setFlagRaw( flags, PILOT_TAKEOFF );
-      a = RNGF() * 2. * M_PI;
-      r = RNGF() * planet->radius;
-      vect_cset( &vp,
-            planet->pos.x + r * cos(a),
-            planet->pos.y + r * sin(a) );
-      a = RNGF() * 2.*M_PI;
-      vectnull( &vv );
-   }
-   /* Random. */
-   else {
-      /* Check if we should ignore the strict rules. */
-      ignore_rules = 0;
-      if (lua_isboolean(L,3) && lua_toboolean(L,3))
-         ignore_rules = 1;
-
-      /* Choose the spawn point and act in consequence.*/
-      pilot_choosePoint( &vp, &planet, &jump, lf, ignore_rules, 0 );
-
-      if (planet != NULL) {
-         pilot_setFlagRaw( flags, PILOT_TAKEOFF );
-         a = RNGF() * 2. * M_PI;
-         r = RNGF() * planet->radius;
-         vect_cset( &vp,
-               planet->pos.x + r * cos(a),
-               planet->pos.y + r * sin(a) );
-         a = RNGF() * 2.*M_PI;
-         vectnull( &vv );
-      }
-      else {
-         a = RNGF() * 2.*M_PI;
-         vectnull( &vv );
-      }
-   }
-
-   /* Set up velocities and such. */
-   if (jump != NULL) {
-      space_calcJumpInPos( cur_system, jump->from, &vp, &vv, &a );
-      pilot_setFlagRaw( flags, PILOT_HYP_END );
-   }
-
-   /* Make sure angle is valid. */
-   a = fmod( a, 2.*M_PI );
-   if (a < 0.)
-      a += 2.*M_PI;
+   pilotL_spawnOrigin( L, 3, fltname, lf, &vp, &vv, &a, flags );
 
    if (from_ship) {
       /* Create the pilot. */
@@ -636,6 +671,94 @@ static int pilotL_addFleetRaw(lua_State *L )
 }
 
 
+/**
+ * @brief Adds a batch of fleets to the system, meant for the faction spawn scripts.
+ *
+ * The whole template is validated before anything is created. When called
+ *  from a spawn script, each pilot of a fleet gets an equal share of the
+ *  fleet's presence, which is accounted to the faction being spawned, so the
+ *  created pilots don't have to be returned to the scheduler. Elsewhere the
+ *  presence is ignored.
+ *
+ * @usage p = pilot.addBatch( { { pilot="Empire Shark", presence=20 }, { pilot="Empire Lancelot", presence=25 } } )
+ *
+ *    @luatparam table template Array of tables with the name of the fleet as "pilot" and its presence as "presence".
+ *    @luatparam System|Planet param Position to create the fleets at. See pilot.add for further information.
+ *    @luatreturn {Pilot,...} Array with all the pilots created, in the order of the template.
+ * @luafunc addBatch( template, param )
+ */
+static int pilotL_addBatch( lua_State *L )
+{
+   int i, j, n, k, first;
+   Fleet **flts;
+   double *pres;
+   unsigned int p;
+   double a;
+   Vector2d vv, vp;
+   PilotFlags flags;
+   Pilot *pilot;
+
+   NLUA_CHECKRW(L);
+   luaL_checktype( L, 1, LUA_TTABLE );
+
+   /* Resolve the whole template first so bad data doesn't spawn half a fleet. */
+   n    = (int) lua_objlen(L,1);
+   flts = malloc( n * sizeof(Fleet*) );
+   pres = malloc( n * sizeof(double) );
+   for (i=0; i<n; i++) {
+      lua_rawgeti( L, 1, i+1 ); /* t */
+      if (lua_istable(L,-1)) {
+         lua_getfield( L, -1, "pilot" ); /* t, f */
+         lua_getfield( L, -2, "presence" ); /* t, f, p */
+         flts[i] = (lua_type(L,-2) == LUA_TSTRING) ? fleet_get( lua_tostring(L,-2) ) : NULL;
+         pres[i] = lua_tonumber(L,-1);
+         j       = lua_isnumber(L,-1);
+         lua_pop(L,3);
+      }
+      else {
+         flts[i] = NULL;
+         j       = 0;
+         lua_pop(L,1);
+      }
+      if ((flts[i] == NULL) || !j) {
+         free(flts);
+         free(pres);
+         NLUA_ERROR(L,_("Invalid fleet in spawn template entry %d."), i+1);
+         return 0;
+      }
+   }
+
+   /* Create the fleets. */
+   lua_newtable(L);
+   k = 0;
+   for (i=0; i<n; i++) {
+      pilot_clearFlagsRaw( flags );
+      pilotL_spawnOrigin( L, 2, flts[i]->name, flts[i]->faction, &vp, &vv, &a, flags );
+
+      first = 1;
+      for (j=0; j<flts[i]->npilots; j++) {
+         /* Fleet displacement - first ship is exact. */
+         if (!first)
+            vect_cadd(&vp, RNG(75,150) * (RNG(0,1) ? 1 : -1),
+                  RNG(75,150) * (RNG(0,1) ? 1 : -1));
+         first = 0;
+
+         p = fleet_createPilot( flts[i], &flts[i]->pilots[j], a, &vp, &vv, NULL, flags );
+         pilot = pilot_get( p );
+         if (pilot != NULL)
+            system_addSpawnedPilot( pilot, pres[i] / flts[i]->npilots );
+
+         lua_pushpilot(L,p);
+         lua_rawseti(L,-2,++k);
+      }
+   }
+
+   free(flts);
+   free(pres);
+   return 1;
+}
+
+
 /**
  * @brief Removes a pilot without explosions or anything.
  *
@@ -815,6 +938,204 @@ static int pilotL_getPilots( lua_State *L )
    return 1;
 }
 
+
+/**
+ * @brief Filter data for pilot spatial queries.
+ */
+typedef struct PilotLQuery_ {
+   int disabled;  /**< Whether or not to get disabled pilots. */
+   int hostile;   /**< Only get pilots hostile to the player. */
+   int noplayer;  /**< Don't get the player. */
+} PilotLQuery;
+
+
+/**
+ * @brief Spatial query filter used by the pilot library.
+ */
+static int pilotL_filterQuery( const Pilot *ref, const Pilot *p, void *data )
+{
+   const PilotLQuery *lq = (const PilotLQuery*) data;
+   (void) ref;
+
+   if (!lq->disabled && pilot_isDisabled(p))
+      return 0;
+   if (lq->noplayer && pilot_isPlayer(p))
+      return 0;
+   if (lq->hostile && !pilot_isHostile(p))
+      return 0;
+   return 1;
+}
+
+
+/**
+ * @brief Pushes a list of pilots as a table.
+ *
+ *    @param L Lua state.
+ *    @param pilots Pilots to push.
+ *    @param n Number of pilots.
+ *    @param ind Index of a table to reuse, a new one is created if it isn't a
+ *           table. Leftover array elements are cleared.
+ */
+static void pilotL_pushPilotList( lua_State *L, Pilot **pilots, int n, int ind )
+{
+   int i, len;
+
+   if (lua_istable(L,ind)) {
+      lua_pushvalue(L,ind);
+      len = (int) lua_objlen(L,-1);
+   }
+   else {
+      lua_createtable(L,n,0);
+      len = 0;
+   }
+
+   for (i=0; i<n; i++) {
+      lua_pushpilot(L, pilots[i]->id); /* t, p */
+      lua_rawseti(L, -2, i+1); /* t */
+   }
+   for (i=n+1; i<=len; i++) {
+      lua_pushnil(L); /* t, nil */
+      lua_rawseti(L, -2, i); /* t */
+   }
+}
+
+
+/**
+ * @brief Gets the pilots within a radius matching a filter.
+ *
+ * Unlike pilot.get() the filtering is done with the pilot spatial index, so
+ *  only matching pilots are ever pushed to Lua. Passing a table to fill
+ *  avoids creating a new one every call.
+ *
+ * The filter table can have the following fields:<br/>
+ *  - "faction": Faction relations are checked against (defaults to the
+ *    faction of the reference pilot).<br/>
+ *  - "rel": Relation pilots must have with the faction, one of "any",
+ *    "enemy", "ally" or "neutral" (defaults to "any").<br/>
+ *  - "disabled": Whether or not to get disabled pilots (defaults to false).<br/>
+ *
+ * The player is never matched by a relation other than "any", since the
+ *  player's relations come from standing and not from a faction.
+ *
+ * @usage p = pilot.getInRadius( player.pilot(), 5000 ) -- Pilots within 5000 of the player
+ * @usage p = pilot.getInRadius( vec2.new(), 3000, { faction="Empire", rel="enemy" } ) -- Empire enemies near the origin
+ * @usage t = pilot.getInRadius( pos, r, nil, t ) -- Reuses the table t
+ *
+ *    @luatparam Pilot|Vec2 pos Position to search from. If it is a pilot, it
+ *       is the reference pilot and is not included in the results.
+ *    @luatparam number r Radius to search in.
+ *    @luatparam[opt] table filter Filter to apply to the pilots.
+ *    @luatparam[opt] table t Table to fill with the results.
+ *    @luatreturn {Pilot,...} Pilots matching the filter, in no particular order.
+ * @luafunc getInRadius( pos, r, filter, t )
+ */
+static int pilotL_getInRadius( lua_State *L )
+{
+   PilotGridQuery q;
+   PilotLQuery lq;
+   Pilot **found;
+   PilotGridRel rel;
+   const Pilot *ref;
+   const Vector2d *pos;
+   const char *str;
+   double r;
+   int n;
+
+   /* Reference. */
+   if (lua_ispilot(L,1)) {
+      ref = luaL_validpilot(L,1);
+      pos = &ref->solid->pos;
+   }
+   else {
+      ref = NULL;
+      pos = luaL_checkvector(L,1);
+   }
+   r = luaL_checknumber(L,2);
+
+   /* Filter. */
+   pilot_gridQueryInit( &q, ref, PILOT_GRID_ANY );
+   lq.disabled = 0;
+   lq.hostile  = 0;
+   lq.noplayer = 0;
+   if (lua_istable(L,3)) {
+      lua_getfield(L,3,"faction");
+      if (!lua_isnil(L,-1))
+         q.faction = luaL_validfaction(L,-1);
+      lua_pop(L,1);
+
+      lua_getfield(L,3,"rel");
+      if (!lua_isnil(L,-1)) {
+         str = luaL_checkstring(L,-1);
+         if (pilot_gridRelFromString( str, &rel ) != 0)
+            NLUA_ERROR(L, _("Invalid relation '%s'."), str);
+         q.rel = rel;
+      }
+      lua_pop(L,1);
+
+      lua_getfield(L,3,"disabled");
+      lq.disabled = lua_toboolean(L,-1);
+      lua_pop(L,1);
+   }
+   else if (!lua_isnoneornil(L,3))
+      NLUA_INVALID_PARAMETER(L);
+   if ((q.rel != PILOT_GRID_ANY) && !faction_isFaction(q.faction))
+      NLUA_ERROR(L, _("Relation filter needs a faction or reference pilot."));
+   lq.noplayer = (q.rel != PILOT_GRID_ANY);
+   q.filter = pilotL_filterQuery;
+   q.data   = &lq;
+
+   n = pilot_gridRadius( &q, pos->x, pos->y, r, &found );
+   pilotL_pushPilotList( L, found, n, 4 );
+   return 1;
+}
+
+
+/**
+ * @brief Gets the pilots hostile to a pilot.
+ *
+ * Hostility is checked with the faction standings, and for the player also
+ *  with pilots that were made hostile individually. Disabled pilots are not
+ *  included.
+ *
+ * @usage hostiles = pilot.getHostiles( p, 5000 ) -- Hostiles within 5000 of p
+ *
+ *    @luatparam Pilot p Pilot to get the hostiles of.
+ *    @luatparam[opt] number r Radius to search in, defaults to the whole system.
+ *    @luatparam[opt] table t Table to fill with the results.
+ *    @luatreturn {Pilot,...} Pilots hostile to p, in no particular order.
+ * @luafunc getHostiles( p, r, t )
+ */
+static int pilotL_getHostiles( lua_State *L )
+{
+   PilotGridQuery q;
+   PilotLQuery lq;
+   Pilot **found;
+   Pilot *p;
+   double r;
+   int n;
+
+   p = luaL_validpilot(L,1);
+   r = luaL_optnumber(L,2,-1.);
+
+   lq.disabled = 0;
+   lq.hostile  = 0;
+   lq.noplayer = 0;
+   /* Pilots can be hostile to the player regardless of faction. */
+   if (pilot_isPlayer(p)) {
+      pilot_gridQueryInit( &q, p, PILOT_GRID_ANY );
+      lq.hostile = 1;
+   }
+   else
+      pilot_gridQueryInit( &q, p, PILOT_GRID_ENEMY );
+   q.filter = pilotL_filterQuery;
+   q.data   = &lq;
+
+   n = pilot_gridRadius( &q, p->solid->pos.x, p->solid->pos.y, r, &found );
+   pilotL_pushPilotList( L, found, n, 3 );
+   return 1;
+}
+
+
 /**
  * @brief Checks to see if pilot and p are the same.
  *
@@ -1810,6 +2131,7 @@ static int pilotL_setPosition( lua_State *L )
 
    /* Warp pilot to new position. */
    p->solid->pos = *vec;
+   pilot_gridInvalidate();
 
    /* Update if necessary. */
    if (pilot_isPlayer(p))
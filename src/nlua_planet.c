@@ -868,7 +868,7 @@ static int planetL_setKnown( lua_State *L )
    if (b)
       planet_setKnown( p );
    else
-      planet_rmFlag( p, PLANET_KNOWN );
+      planet_rmKnown( p );
 
    /* Update outfits image array. */
    if (changed)
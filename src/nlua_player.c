@@ -1319,8 +1319,10 @@ static int playerL_teleport( lua_State *L )
    missions_run( MIS_AVAIL_SPACE, -1, NULL, NULL );
 
    /* Move to planet. */
-   if (pnt != NULL)
+   if (pnt != NULL) {
       player.p->solid->pos = pnt->pos;
+      pilot_gridInvalidate();
+   }
 
    return 0;
 }
@@ -943,22 +943,22 @@ static int systemL_setknown( lua_State *L )
       r   = lua_toboolean(L, 3);
 
    if (b)
-      sys_setFlag( sys, SYSTEM_KNOWN );
+      sys_setKnown( sys );
    else
-      sys_rmFlag( sys, SYSTEM_KNOWN );
+      sys_rmKnown( sys );
 
    if (r) {
       if (b) {
          for (i=0; i < sys->nplanets; i++)
             planet_setKnown( sys->planets[i] );
          for (i=0; i < sys->njumps; i++)
-            jp_setFlag( &sys->jumps[i], JP_KNOWN );
+            jp_setKnown( &sys->jumps[i] );
      }
      else {
          for (i=0; i < sys->nplanets; i++)
-            planet_rmFlag( sys->planets[i], PLANET_KNOWN );
+            planet_rmKnown( sys->planets[i] );
          for (i=0; i < sys->njumps; i++)
-            jp_rmFlag( &sys->jumps[i], JP_KNOWN );
+            jp_rmKnown( &sys->jumps[i] );
      }
    }
 
@@ -39,6 +39,7 @@
  */
 typedef struct misn_var_ {
    char* name; /**< Name of the variable. */
+   unsigned int hash; /**< Hash of the name. */
    char type; /**< Type of the variable. */
    union {
       double num; /**< Used if type is number. */
@@ -54,6 +55,9 @@ typedef struct misn_var_ {
 static misn_var* var_stack = NULL; /**< Stack of mission variables. */
 static int var_nstack      = 0; /**< Number of mission variables. */
 static int var_mstack      = 0; /**< Memory size of the mission variable stack. */
+static int *var_hash       = NULL; /**< Open addressing index into the stack, stores index+1. */
+static int var_nhash       = 0; /**< Size of the index, always a power of two. */
+static int var_ndead       = 0; /**< Popped variables still taking up room in the stack. */
 
 
 /*
@@ -62,6 +66,13 @@ static int var_mstack      = 0; /**< Memory size of the mission variable stack.
 /* static */
 static int var_add( misn_var *var );
 static void var_free( misn_var* var );
+static unsigned int var_hashStr( const char *str );
+static int var_findSlot( const char *str );
+static int var_find( const char *str );
+static void var_index (void);
+static void var_unindex( int slot );
+static void var_compact (void);
+static void var_pushValue( lua_State *L, const misn_var *var );
 /* externed */
 int var_save( xmlTextWriterPtr writer );
 int var_load( xmlNodePtr parent );
@@ -69,10 +80,12 @@ int var_load( xmlNodePtr parent );
 
 /* var */
 static int var_peek( lua_State *L );
+static int var_peekMany( lua_State *L );
 static int var_pop( lua_State *L );
 static int var_push( lua_State *L );
 static const luaL_Reg var_methods[] = {
    { "peek", var_peek },
+   { "peekMany", var_peekMany },
    { "pop", var_pop },
    { "push", var_push },
    {0,0}
@@ -104,6 +117,10 @@ int var_save( xmlTextWriterPtr writer )
    xmlw_startElem(writer,"vars");
 
    for (i=0; i<var_nstack; i++) {
+      /* Popped. */
+      if (var_stack[i].name == NULL)
+         continue;
+
       xmlw_startElem(writer,"var");
 
       xmlw_attr(writer,"name","%s",var_stack[i].name);
@@ -189,9 +206,139 @@ int var_load( xmlNodePtr parent )
 }
 
 
+/**
+ * @brief Hashes a variable name (djb2).
+ *
+ *    @param str Name to hash.
+ *    @return Hash of the name.
+ */
+static unsigned int var_hashStr( const char *str )
+{
+   unsigned int hash;
+   const unsigned char *c;
+
+   hash = 5381;
+   for (c=(const unsigned char*)str; *c != '\0'; c++)
+      hash = hash * 33 + *c;
+   return hash;
+}
+
+
+/**
+ * @brief Finds the slot of a variable in the index.
+ *
+ *    @param str Name of the variable.
+ *    @return Slot of the variable in the index or -1 if not found.
+ */
+static int var_findSlot( const char *str )
+{
+   int i, j;
+   unsigned int hash;
+
+   if (var_nhash == 0)
+      return -1;
+
+   hash = var_hashStr( str );
+   for (i=hash & (var_nhash-1); var_hash[i] != 0; i=(i+1) & (var_nhash-1)) {
+      j = var_hash[i]-1;
+      if ((var_stack[j].hash == hash) && (strcmp(str,var_stack[j].name)==0))
+         return i;
+   }
+   return -1;
+}
+
+
+/**
+ * @brief Finds a variable in the stack.
+ *
+ *    @param str Name of the variable.
+ *    @return Index of the variable in the stack or -1 if not found.
+ */
+static int var_find( const char *str )
+{
+   int i;
+
+   i = var_findSlot( str );
+   if (i < 0)
+      return -1;
+   return var_hash[i]-1;
+}
+
+
+/**
+ * @brief Rebuilds the index of the variable stack.
+ */
+static void var_index (void)
+{
+   int i, j, n;
+
+   /* Keep the load factor under a half. */
+   n = 64;
+   while (n < 2*var_mstack)
+      n *= 2;
+   if (n != var_nhash) {
+      var_nhash = n;
+      var_hash  = realloc( var_hash, var_nhash * sizeof(int) );
+   }
+   memset( var_hash, 0, var_nhash * sizeof(int) );
+
+   for (i=0; i<var_nstack; i++) {
+      if (var_stack[i].name == NULL)
+         continue;
+      for (j=var_stack[i].hash & (var_nhash-1); var_hash[j] != 0; j=(j+1) & (var_nhash-1));
+      var_hash[j] = i+1;
+   }
+}
+
+
+/**
+ * @brief Removes a slot from the index.
+ *
+ * Entries further along the probe sequence are shifted back so lookups
+ *  don't stop at the hole.
+ *
+ *    @param slot Slot to remove.
+ */
+static void var_unindex( int slot )
+{
+   int i, j, k, mask;
+
+   mask = var_nhash-1;
+   i    = slot;
+   for (j=(i+1) & mask; var_hash[j] != 0; j=(j+1) & mask) {
+      /* Entries whose home is cyclically in (i,j] can stay. */
+      k = var_stack[ var_hash[j]-1 ].hash & mask;
+      if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+         continue;
+      var_hash[i] = var_hash[j];
+      i = j;
+   }
+   var_hash[i] = 0;
+}
+
+
+/**
+ * @brief Removes popped variables from the stack, keeping the order.
+ */
+static void var_compact (void)
+{
+   int i, n;
+
+   n = 0;
+   for (i=0; i<var_nstack; i++)
+      if (var_stack[i].name != NULL)
+         var_stack[n++] = var_stack[i];
+   var_nstack = n;
+   var_ndead  = 0;
+   var_index();
+}
+
+
 /**
  * @brief Adds a var to the stack, strings will be SHARED, don't free.
  *
+ * Variables keep their insertion order in the stack so saves are stable.
+ *
  *    @param new_var Variable to add.
  *    @return 0 on success.
  */
@@ -199,22 +346,31 @@ static int var_add( misn_var *new_var )
 {
    int i;
 
+   /* check if already exists */
+   new_var->hash = var_hashStr( new_var->name );
+   i = var_find( new_var->name );
+   if (i >= 0) { /* overwrite */
+      var_free( &var_stack[i] );
+      var_stack[i] = *new_var;
+      return 0;
+   }
+
    if (var_nstack+1 > var_mstack) { /* more memory */
       var_mstack += 64; /* overkill ftw */
       var_stack = realloc( var_stack, var_mstack * sizeof(misn_var) );
    }
 
-   /* check if already exists */
-   for (i=0; i<var_nstack; i++)
-      if (strcmp(new_var->name,var_stack[i].name)==0) { /* overwrite */
-         var_free( &var_stack[i] );
-         var_stack[i] = *new_var;
-         return 0;
-      }
-
    var_stack[var_nstack] = *new_var;
    var_nstack++;
 
+   /* Index the new variable, growing the index along with the stack. */
+   if (var_nhash < 2*var_mstack)
+      var_index();
+   else {
+      for (i=new_var->hash & (var_nhash-1); var_hash[i] != 0; i=(i+1) & (var_nhash-1));
+      var_hash[i] = var_nstack;
+   }
+
    return 0;
 }
 
@@ -246,12 +402,32 @@ static int var_add( misn_var *new_var )
  */
 int var_checkflag( char* str )
 {
-   int i;
+   return (var_find( str ) >= 0);
+}
 
-   for (i=0; i<var_nstack; i++)
-      if (strcmp(var_stack[i].name,str)==0)
-         return 1;
-   return 0;
+
+/**
+ * @brief Pushes the value of a mission variable.
+ *
+ *    @param L Lua state to push onto.
+ *    @param var Variable to push.
+ */
+static void var_pushValue( lua_State *L, const misn_var *var )
+{
+   switch (var->type) {
+      case MISN_VAR_NIL:
+         lua_pushnil(L);
+         break;
+      case MISN_VAR_NUM:
+         lua_pushnumber(L,var->d.num);
+         break;
+      case MISN_VAR_BOOL:
+         lua_pushboolean(L,var->d.b);
+         break;
+      case MISN_VAR_STR:
+         lua_pushstring(L,var->d.str);
+         break;
+   }
 }
 /**
  * @brief Gets the mission variable value of a certain name.
@@ -269,26 +445,39 @@ static int var_peek( lua_State *L )
    /* Get the parameter. */
    str = luaL_checkstring(L,1);
 
-   for (i=0; i<var_nstack; i++)
-      if (strcmp(str,var_stack[i].name)==0) {
-         switch (var_stack[i].type) {
-            case MISN_VAR_NIL:
-               lua_pushnil(L);
-               break;
-            case MISN_VAR_NUM:
-               lua_pushnumber(L,var_stack[i].d.num);
-               break;
-            case MISN_VAR_BOOL:
-               lua_pushboolean(L,var_stack[i].d.b);
-               break;
-            case MISN_VAR_STR:
-               lua_pushstring(L,var_stack[i].d.str);
-               break;
-         }
-         return 1;
-      }
+   i = var_find( str );
+   if (i < 0)
+      return 0;
 
-   return 0;
+   var_pushValue( L, &var_stack[i] );
+   return 1;
+}
+/**
+ * @brief Gets the values of many mission variables at once.
+ *
+ * @usage a, b, c = var.peekMany( "a", "b", "c" )
+ *
+ *    @luatparam string ... Names of the mission variables to get.
+ *    @luareturn The values of the mission variables in the same order, nil
+ *             for those that do not exist.
+ * @luafunc peekMany( ... )
+ */
+static int var_peekMany( lua_State *L )
+{
+   int i, j, n;
+   const char *str;
+
+   n = lua_gettop(L);
+   luaL_checkstack(L, n, NULL);
+   for (i=1; i<=n; i++) {
+      str = luaL_checkstring(L,i);
+      j   = var_find( str );
+      if (j < 0)
+         lua_pushnil(L);
+      else
+         var_pushValue( L, &var_stack[j] );
+   }
+   return n;
 }
 /**
  * @brief Pops a mission variable off the stack, destroying it.
@@ -300,20 +489,27 @@ static int var_peek( lua_State *L )
  */
 static int var_pop( lua_State *L )
 {
-   int i;
+   int i, j;
    const char* str;
 
    NLUA_CHECKRW(L);
 
    str = luaL_checkstring(L,1);
 
-   for (i=0; i<var_nstack; i++)
-      if (strcmp(str,var_stack[i].name)==0) {
-         var_free( &var_stack[i] );
-         memmove( &var_stack[i], &var_stack[i+1], sizeof(misn_var)*(var_nstack-i-1) );
-         var_nstack--;
-         return 0;
-      }
+   /* Leave a hole in the stack so nothing has to be reindexed. */
+   j = var_findSlot( str );
+   if (j >= 0) {
+      i = var_hash[j]-1;
+      var_unindex( j );
+      var_free( &var_stack[i] );
+      var_stack[i].type = MISN_VAR_NIL;
+      var_ndead++;
+
+      /* Holes are cleared in bulk once they take up half the stack. */
+      if (2*var_ndead > var_nstack)
+         var_compact();
+      return 0;
+   }
 
    /*NLUA_DEBUG("Var '%s' not found in stack", str);*/
    return 0;
@@ -402,5 +598,10 @@ void var_cleanup (void)
    var_stack   = NULL;
    var_nstack  = 0;
    var_mstack  = 0;
+   var_ndead   = 0;
+
+   free( var_hash );
+   var_hash    = NULL;
+   var_nhash   = 0;
 }
 
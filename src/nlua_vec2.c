@@ -478,7 +478,9 @@ static int vectorL_get( lua_State *L )
 /**
  * @brief Gets polar coordinates of a vector.
  *
- * The angle is in degrees, not radians.
+ * The angle is in degrees, not radians. The coordinates are computed from the
+ *  cartesian ones, so the modulus is never negative and the angle is in
+ *  (-180,180].
  *
  * @usage modulus, angle = my_vec:polar()
  *
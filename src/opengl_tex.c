@@ -31,14 +31,20 @@
  * graphic list
  */
 /**
- * @brief Represents a node in the texture list.
+ * @brief Represents a node in the texture hash table.
  */
 typedef struct glTexList_ {
-   struct glTexList_ *next; /**< Next in linked list */
+   struct glTexList_ *next; /**< Next in the bucket chain */
    glTexture *tex; /**< associated texture */
+   uint32_t hash; /**< Hash of the texture name. */
    int used; /**< counts how many times texture is being used */
 } glTexList;
-static glTexList* texture_list = NULL; /**< Texture list. */
+#define TEXTURE_HASH_MIN   256 /**< Initial number of buckets, must be a power of two. */
+static glTexList** texture_hash = NULL; /**< Texture hash table buckets, keyed by name. */
+static int texture_nhash = 0; /**< Number of buckets in the texture hash table. */
+static int texture_nlist = 0; /**< Number of textures in the hash table. */
+static size_t texture_mem = 0; /**< Estimated memory used by all live textures. */
+static int texture_nmem = 0; /**< Number of live textures, named or not. */
 
 
 /*
@@ -56,11 +62,15 @@ static int SDL_IsTrans( SDL_Surface* s, int x, int y );
 static uint8_t* SDL_MapTrans( SDL_Surface* s, int w, int h );
 static size_t gl_transSize( const int w, const int h );
 /* glTexture */
-static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned int flags, int freesur );
+static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, size_t *mem,
+      unsigned int flags, int freesur );
 static glTexture* gl_loadNewImage( const char* path, unsigned int flags );
 /* List. */
+static uint32_t gl_texHash( const char* path );
+static glTexList** gl_texFind( const char* path, uint32_t hash );
 static glTexture* gl_texExists( const char* path );
 static int gl_texAdd( glTexture *tex );
+static void gl_texDelete( glTexture *texture );
 
 
 /**
@@ -290,12 +300,16 @@ int gl_texHasCompress (void)
  *    @param flags Flags to use.
  *    @param[out] rw Real width of the texture.
  *    @param[out] rh Real height of the texture.
+ *    @param[out] mem Estimated memory used by the texture.
  *    @return The opengl texture id.
  */
-static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned int flags, int freesur )
+static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, size_t *mem,
+      unsigned int flags, int freesur )
 {
    GLuint texture;
    GLfloat param;
+   GLint csize;
+   size_t size;
 
    /* Prepare the surface. */
    surface = gl_prepareSurface( surface );
@@ -329,10 +343,15 @@ static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned i
       glTexImage2D( GL_TEXTURE_2D, 0, GL_COMPRESSED_RGBA,
             surface->w, surface->h, 0, GL_RGBA,
             GL_UNSIGNED_BYTE, surface->pixels );
+      csize = 0;
+      glGetTexLevelParameteriv( GL_TEXTURE_2D, 0,
+            GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &csize );
+      size = (csize > 0) ? (size_t)csize : (size_t)surface->w * surface->h;
    }
    else {
       glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
             surface->w, surface->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels );
+      size = (size_t)surface->w * surface->h * 4;
    }
    SDL_UnlockSurface( surface );
 
@@ -348,7 +367,12 @@ static GLuint gl_loadSurface( SDL_Surface* surface, int *rw, int *rh, unsigned i
 
       /* Now generate the mipmaps. */
       glGenerateMipmap(GL_TEXTURE_2D);
+
+      /* The whole mipmap chain adds about a third. */
+      size += size / 3;
    }
+   if (mem != NULL)
+      (*mem) = size;
 
    /* cleanup */
    if (freesur)
@@ -505,7 +529,9 @@ glTexture* gl_loadImagePad( const char *name, SDL_Surface* surface,
    texture->sx    = (double) sx;
    texture->sy    = (double) sy;
 
-   texture->texture = gl_loadSurface( surface, &rw, &rh, flags, freesur );
+   texture->texture = gl_loadSurface( surface, &rw, &rh, &texture->mem, flags, freesur );
+   texture_mem += texture->mem;
+   texture_nmem++;
 
    texture->rw    = (double) rw;
    texture->rh    = (double) rh;
@@ -538,6 +564,47 @@ glTexture* gl_loadImage( SDL_Surface* surface, unsigned int flags )
 }
 
 
+/**
+ * @brief Hashes a texture name (FNV-1a).
+ *
+ *    @param path Name of the texture.
+ *    @return Hash of the name.
+ */
+static uint32_t gl_texHash( const char* path )
+{
+   uint32_t hash;
+   const unsigned char *c;
+
+   hash = 2166136261u;
+   for (c=(const unsigned char*)path; *c != '\0'; c++) {
+      hash ^= *c;
+      hash *= 16777619u;
+   }
+   return hash;
+}
+
+
+/**
+ * @brief Finds the slot pointing to the node of a texture in the hash table.
+ *
+ *    @param path Name of the texture.
+ *    @param hash Hash of the name.
+ *    @return Pointer to the link referencing the node (which is NULL if not found).
+ */
+static glTexList** gl_texFind( const char* path, uint32_t hash )
+{
+   glTexList **cur;
+
+   cur = &texture_hash[ hash & (texture_nhash-1) ];
+   while (*cur != NULL) {
+      if (((*cur)->hash == hash) && (strcmp(path,(*cur)->tex->name)==0))
+         break;
+      cur = &(*cur)->next;
+   }
+   return cur;
+}
+
+
 /**
  * @brief Check to see if a texture matching a path already exists.
  *
@@ -549,44 +616,51 @@ static glTexture* gl_texExists( const char* path )
    glTexList *cur;
 
    /* Null does never exist. */
-   if (path==NULL)
+   if ((path==NULL) || (texture_hash==NULL))
       return NULL;
 
    /* check to see if it already exists */
-   if (texture_list != NULL) {
-      for (cur=texture_list; cur!=NULL; cur=cur->next) {
-         if (strcmp(path,cur->tex->name)==0) {
-            cur->used += 1;
-            return cur->tex;
-         }
-      }
-   }
+   cur = *gl_texFind( path, gl_texHash(path) );
+   if (cur == NULL)
+      return NULL;
 
-   return NULL;
+   cur->used += 1;
+   return cur->tex;
 }
 
 
 /**
- * @brief Adds a texture to the list under the name of path.
+ * @brief Adds a texture to the hash table under the name of path.
  */
 static int gl_texAdd( glTexture *tex )
 {
-   glTexList *new, *cur, *last;
+   int i, n;
+   glTexList *new, *cur, *next, **buckets;
+
+   /* Grow the table to keep chains short. */
+   if (texture_nlist >= texture_nhash) {
+      n = MAX( TEXTURE_HASH_MIN, 2*texture_nhash );
+      buckets = calloc( n, sizeof(glTexList*) );
+      for (i=0; i<texture_nhash; i++) {
+         for (cur=texture_hash[i]; cur!=NULL; cur=next) {
+            next = cur->next;
+            cur->next = buckets[ cur->hash & (n-1) ];
+            buckets[ cur->hash & (n-1) ] = cur;
+         }
+      }
+      free(texture_hash);
+      texture_hash  = buckets;
+      texture_nhash = n;
+   }
 
    /* Create the new node */
    new = malloc( sizeof(glTexList) );
-   new->next = NULL;
    new->used = 1;
    new->tex  = tex;
-
-   if (texture_list == NULL) /* special condition - creating new list */
-      texture_list = new;
-   else {
-      for (cur=texture_list; cur!=NULL; cur=cur->next)
-         last = cur;
-
-      last->next = new;
-   }
+   new->hash = gl_texHash( tex->name );
+   new->next = texture_hash[ new->hash & (texture_nhash-1) ];
+   texture_hash[ new->hash & (texture_nhash-1) ] = new;
+   texture_nlist++;
 
    return 0;
 }
@@ -713,7 +787,7 @@ glTexture* gl_newSprite( const char* path, const int sx, const int sy,
  */
 void gl_freeTexture( glTexture* texture )
 {
-   glTexList *cur, *last;
+   glTexList **link, *cur;
 
    /* Shouldn't be NULL (won't segfault though) */
    if (texture == NULL) {
@@ -721,34 +795,23 @@ void gl_freeTexture( glTexture* texture )
       return;
    }
 
-   /* see if we can find it in stack */
-   last = NULL;
-   for (cur=texture_list; cur!=NULL; cur=cur->next) {
-      if (cur->tex == texture) { /* found it */
+   /* see if we can find it in the table */
+   if ((texture->name != NULL) && (texture_hash != NULL)) {
+      link = gl_texFind( texture->name, gl_texHash(texture->name) );
+      cur  = *link;
+      if ((cur != NULL) && (cur->tex == texture)) { /* found it */
          cur->used--;
          if (cur->used <= 0) { /* not used anymore */
-            /* free the texture */
-            glDeleteTextures( 1, &texture->texture );
-            if (texture->trans != NULL)
-               free(texture->trans);
-            if (texture->name != NULL)
-               free(texture->name);
-            free(texture);
-
-            /* free the list node */
-            if (last == NULL) { /* case there's no texture before it */
-               if (cur->next != NULL)
-                  texture_list = cur->next;
-               else /* case it's the last texture */
-                  texture_list = NULL;
-            }
-            else
-               last->next = cur->next;
+            /* free the node */
+            *link = cur->next;
             free(cur);
+            texture_nlist--;
+
+            /* free the texture */
+            gl_texDelete( texture );
          }
          return; /* we already found it so we can exit */
       }
-      last = cur;
    }
 
    /* Not found */
@@ -756,6 +819,20 @@ void gl_freeTexture( glTexture* texture )
       WARN(_("Attempting to free texture '%s' not found in stack!"), texture->name);
 
    /* Free anyways */
+   gl_texDelete( texture );
+}
+
+
+/**
+ * @brief Actually releases a texture and its memory.
+ *
+ *    @param texture Texture to release.
+ */
+static void gl_texDelete( glTexture *texture )
+{
+   texture_mem -= texture->mem;
+   texture_nmem--;
+
    glDeleteTextures( 1, &texture->texture );
    if (texture->trans != NULL)
       free(texture->trans);
@@ -782,12 +859,11 @@ glTexture* gl_dupTexture( glTexture *texture )
       return NULL;
 
    /* check to see if it already exists */
-   if (texture_list != NULL) {
-      for (cur=texture_list; cur!=NULL; cur=cur->next) {
-         if (texture == cur->tex) {
-            cur->used += 1;
-            return cur->tex;
-         }
+   if ((texture->name != NULL) && (texture_hash != NULL)) {
+      cur = *gl_texFind( texture->name, gl_texHash(texture->name) );
+      if ((cur != NULL) && (cur->tex == texture)) {
+         cur->used += 1;
+         return cur->tex;
       }
    }
 
@@ -913,14 +989,38 @@ int gl_initTextures (void)
  */
 void gl_exitTextures (void)
 {
+   int i;
    glTexList *tex;
 
    /* Make sure there's no texture leak */
-   if (texture_list != NULL) {
+   if (texture_nlist > 0) {
       DEBUG(_("Texture leak detected!"));
-      for (tex=texture_list; tex!=NULL; tex=tex->next)
-         DEBUG(_("   '%s' opened %d times"), tex->tex->name, tex->used );
+      for (i=0; i<texture_nhash; i++)
+         for (tex=texture_hash[i]; tex!=NULL; tex=tex->next)
+            DEBUG(_("   '%s' opened %d times"), tex->tex->name, tex->used );
    }
+   else {
+      free(texture_hash);
+      texture_hash  = NULL;
+      texture_nhash = 0;
+   }
+}
+
+
+/**
+ * @brief Gets the estimated memory used by all the loaded textures.
+ *
+ *    @param[out] n Number of live textures (may be NULL).
+ *    @param[out] nnamed Number of those shared through the cache (may be NULL).
+ *    @return Estimated texture memory in bytes.
+ */
+size_t gl_texMemory( int *n, int *nnamed )
+{
+   if (n != NULL)
+      *n = texture_nmem;
+   if (nnamed != NULL)
+      *nnamed = texture_nlist;
+   return texture_mem;
 }
 
 
@@ -66,6 +66,7 @@ typedef struct glTexture_ {
 
    /* properties */
    uint8_t flags; /**< flags used for texture properties */
+   size_t mem; /**< Estimated memory used by the texture. */
 } glTexture;
 
 
@@ -105,6 +106,7 @@ void gl_freeTexture( glTexture* texture );
  */
 int gl_texHasMipmaps (void);
 int gl_texHasCompress (void);
+size_t gl_texMemory( int *n, int *nnamed );
 
 /*
  * Misc.
@@ -263,6 +263,20 @@ void gl_vboActivateAttribOffset( gl_vbo *vbo, GLuint index, GLuint offset,
 }
 
 
+/**
+ * @brief Gets the OpenGL buffer name of a VBO.
+ *
+ * Useful for attaching the VBO to other targets like texture buffers.
+ *
+ *    @param vbo VBO to get name of.
+ *    @return The OpenGL buffer name of the VBO.
+ */
+GLuint gl_vboID( const gl_vbo *vbo )
+{
+   return vbo->id;
+}
+
+
 /**
  * @brief Destroys a VBO.
  *
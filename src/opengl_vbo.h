@@ -41,6 +41,7 @@ void gl_vboActivateOffset( gl_vbo *vbo, GLuint class, GLuint offset,
       GLint size, GLenum type, GLsizei stride );
 void gl_vboActivateAttribOffset( gl_vbo *vbo, GLuint index, GLuint offset,
       GLint size, GLenum type, GLsizei stride );
+GLuint gl_vboID( const gl_vbo *vbo );
 
 
 /*
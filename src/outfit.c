@@ -1968,6 +1968,17 @@ static void outfit_parseSMap( Outfit *temp, const xmlNodePtr parent )
    array_shrink( &temp->u.map->assets  );
    array_shrink( &temp->u.map->jumps   );
 
+   /* Precompute the masks used to check if the map is already known. */
+   memset( &temp->u.map->sys_mask,   0, sizeof(SpaceKnownSet) );
+   memset( &temp->u.map->jump_mask,  0, sizeof(SpaceKnownSet) );
+   memset( &temp->u.map->asset_mask, 0, sizeof(SpaceKnownSet) );
+   for (i=0; i<array_size(temp->u.map->systems); i++)
+      space_knownMaskAdd( &temp->u.map->sys_mask, temp->u.map->systems[i]->id );
+   for (i=0; i<array_size(temp->u.map->jumps); i++)
+      space_knownMaskAdd( &temp->u.map->jump_mask, temp->u.map->jumps[i]->id );
+   for (i=0; i<array_size(temp->u.map->assets); i++)
+      space_knownMaskAdd( &temp->u.map->asset_mask, temp->u.map->assets[i]->id );
+
    if (temp->desc_short == NULL) {
       /* Set short description based on type. */
       temp->desc_short = malloc( OUTFIT_SHORTDESC_MAX );
@@ -2620,6 +2631,9 @@ void outfit_free (void)
          array_free( o->u.map->systems );
          array_free( o->u.map->assets );
          array_free( o->u.map->jumps );
+         free( o->u.map->sys_mask.bits );
+         free( o->u.map->jump_mask.bits );
+         free( o->u.map->asset_mask.bits );
          free( o->u.map );
       }
 
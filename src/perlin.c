@@ -38,6 +38,10 @@
  * @note Tried to optimize a while back with SSE and the works, but because
  *       of the nature of how it's implemented in non-linear fashion it just
  *       wound up complicating the code without actually making it faster.
+ *
+ * @note The nebula generation instead works on whole rows with
+ *       noise_turbulence3Row(), which lets the interpolation be vectorized
+ *       while leaving the lattice lookups scalar.
  */
 
 
@@ -60,6 +64,10 @@
 
 #define SIMPLEX_SCALE 0.5f
 
+#define NOISE_BATCH     8 /**< Points processed at once by the row kernel. */
+#define NEBULA_TILE_W   128 /**< Width of a nebula generation tile. */
+#define NEBULA_TILE_H   64 /**< Height of a nebula generation tile. */
+
 
 /**
  * @brief Linearly Interpolates x between a and b.
@@ -86,6 +94,10 @@ struct perlin_data_s {
  */
 typedef struct thread_args_ {
    int z; /**< Z level working on. */
+   int x0; /**< First column of the tile. */
+   int x1; /**< Column after the last of the tile. */
+   int y0; /**< First row of the tile. */
+   int y1; /**< Row after the last of the tile. */
    float zoom; /**< Zoom level of detail. */
    int n; /**< Number of layers to generate. */
    int h; /**< Height. */
@@ -108,6 +120,8 @@ static float lattice3( perlin_data_t *pdata, int ix, float fx,
       int iy, float fy, int iz, float fz );
 static float lattice2( perlin_data_t *pdata, int ix, float fx, int iy, float fy );
 static float lattice1( perlin_data_t *pdata, int ix, float fx );
+static void noise_turbulence3Row( perlin_data_t* pdata, float *tx, int len,
+      float fy, float fz, int octaves, float *out );
 /*Threading */
 static int noise_genNebulaMap_thread( void *data );
 
@@ -426,6 +440,97 @@ float noise_turbulence3( perlin_data_t* pdata, float f[3], int octaves )
 }
 
 
+/**
+ * @brief Gets 3d Turbulence noise for a row of positions.
+ *
+ * Same as calling noise_turbulence3() on each position, but everything that
+ * only depends on y and z is computed once per octave, and the points are
+ * processed in batches so the interpolation can be vectorized by the
+ * compiler. Only the lattice lookups remain scalar.
+ *
+ *    @param pdata Perlin data to generate noise from.
+ *    @param tx X positions of the row, gets overwritten.
+ *    @param len Number of positions in the row.
+ *    @param fy Y position of the row.
+ *    @param fz Z position of the row.
+ *    @param octaves Octaves to use.
+ *    @param[out] out Noise level at each position.
+ */
+static void noise_turbulence3Row( perlin_data_t* pdata, float *tx, int len,
+      float fy, float fz, int octaves, float *out )
+{
+   int i, j, k, b;
+   int ny, nz;
+   float ry, rz, wy, wz;
+   int n[NOISE_BATCH] __attribute__ ((aligned (32)));
+   float r[NOISE_BATCH] __attribute__ ((aligned (32)));
+   float w[NOISE_BATCH] __attribute__ ((aligned (32)));
+   float v[8][NOISE_BATCH] __attribute__ ((aligned (32)));
+   float value, e;
+
+   for (k=0; k<len; k++)
+      out[k] = 0.;
+
+   for (i=0; i<octaves; i++) {
+      /* Constant along the row. */
+      ny = (int)fy;
+      nz = (int)fz;
+      ry = fy - ny;
+      rz = fz - nz;
+      wy = CUBIC(ry);
+      wz = CUBIC(rz);
+      e  = pdata->exponent[i];
+
+      for (j=0; j<len; j+=NOISE_BATCH) {
+         b = MIN( NOISE_BATCH, len-j );
+
+         for (k=0; k<b; k++) {
+            n[k] = (int)tx[j+k];
+            r[k] = tx[j+k] - n[k];
+            w[k] = CUBIC(r[k]);
+         }
+
+         for (k=0; k<b; k++) {
+            v[0][k] = lattice3(pdata, n[k],   r[k],   ny,   ry,   nz,   rz);
+            v[1][k] = lattice3(pdata, n[k]+1, r[k]-1, ny,   ry,   nz,   rz);
+            v[2][k] = lattice3(pdata, n[k],   r[k],   ny+1, ry-1, nz,   rz);
+            v[3][k] = lattice3(pdata, n[k]+1, r[k]-1, ny+1, ry-1, nz,   rz);
+            v[4][k] = lattice3(pdata, n[k],   r[k],   ny,   ry,   nz+1, rz-1);
+            v[5][k] = lattice3(pdata, n[k]+1, r[k]-1, ny,   ry,   nz+1, rz-1);
+            v[6][k] = lattice3(pdata, n[k],   r[k],   ny+1, ry-1, nz+1, rz-1);
+            v[7][k] = lattice3(pdata, n[k]+1, r[k]-1, ny+1, ry-1, nz+1, rz-1);
+         }
+
+         for (k=0; k<b; k++) {
+            value = LERP(
+                  LERP(
+                     LERP(v[0][k], v[1][k], w[k]),
+                     LERP(v[2][k], v[3][k], w[k]),
+                     wy
+                     ),
+                  LERP(
+                     LERP(v[4][k], v[5][k], w[k]),
+                     LERP(v[6][k], v[7][k], w[k]),
+                     wy
+                     ),
+                  wz
+                  );
+            value = CLAMP(-0.99999f, 0.99999f, value);
+            out[j+k] += ABS(value) * e;
+         }
+      }
+
+      for (k=0; k<len; k++)
+         tx[k] *= pdata->lacunarity;
+      fy *= pdata->lacunarity;
+      fz *= pdata->lacunarity;
+   }
+
+   for (k=0; k<len; k++)
+      out[k] = CLAMP(-0.99999f, 0.99999f, out[k]);
+}
+
+
 /**
  * @brief Gets 2d Turbulence noise for a position.
  *
@@ -592,27 +697,28 @@ float* noise_genRadarInt( const int w, const int h, float rug )
 static int noise_genNebulaMap_thread( void *data )
 {
    thread_args *args = (thread_args*) data;
-   float f[3];
-   float value;
-   int y, x;
+   float fx[NEBULA_TILE_W];
+   float fy, fz;
+   float *row;
+   int y, x, len;
    float max;
 
-   /* Generate the layer. */
+   /* Generate the tile. */
    max = 0;
-   f[2] = args->zoom * (float)args->z / (float)args->n;
+   len = args->x1 - args->x0;
+   fz  = args->zoom * (float)args->z / (float)args->n;
 
-   for (y=0; y<args->h; y++) {
-      f[1] = args->zoom * (float)y / (float)args->h;
+   for (y=args->y0; y<args->y1; y++) {
+      fy = args->zoom * (float)y / (float)args->h;
+      for (x=0; x<len; x++)
+         fx[x] = args->zoom * (float)(args->x0+x) / (float)args->w;
 
-      for (x=0; x<args->w; x++) {
-         f[0] = args->zoom * (float)x / (float)args->w;
+      row = &args->nebula[args->z * args->w * args->h + y * args->w + args->x0];
+      noise_turbulence3Row( args->noise, fx, len, fy, fz, args->octaves, row );
 
-         value = noise_turbulence3( args->noise, f, args->octaves );
-         if (max < value)
-            max = value;
-
-         args->nebula[args->z * args->w * args->h + y * args->w + x] = value;
-       }
+      for (x=0; x<len; x++)
+         if (max < row[x])
+            max = row[x];
    }
 
    /* Set up output. */
@@ -636,6 +742,7 @@ static int noise_genNebulaMap_thread( void *data )
 float* noise_genNebulaMap( const int w, const int h, const int n, float rug )
 {
    int x, y, z, i;
+   int tx, ty, ntx, nty, ntiles;
    int octaves;
    float hurst;
    float lacunarity;
@@ -668,34 +775,47 @@ float* noise_genNebulaMap( const int w, const int h, const int n, float rug )
    s = SDL_GetTicks();
    DEBUG(_("Generating Nebula of size %dx%dx%d"), w, h, n);
 
-   /* Prepare for generation. */
-   _max        = malloc( sizeof(float) * n );
+   /* Prepare for generation, work is split into tiles in x, y and z so that
+    * all the workers stay busy regardless of the number of slices. */
+   ntx         = (w + NEBULA_TILE_W - 1) / NEBULA_TILE_W;
+   nty         = (h + NEBULA_TILE_H - 1) / NEBULA_TILE_H;
+   ntiles      = ntx * nty * n;
+   _max        = malloc( sizeof(float) * ntiles );
 
    /* Initialize vpool */
    vpool = vpool_create();
 
    /* Start to create the nebula */
+   i = 0;
    for (z=0; z<n; z++) {
-      /* Make ze arguments! */
-      args     = malloc( sizeof(thread_args) );
-      args->z  = z;
-      args->zoom = zoom;
-      args->n  = n;
-      args->h  = h;
-      args->w  = w;
-      args->noise = noise;
-      args->octaves = octaves;
-      args->max = &_max[z];
-      args->nebula = nebula;
-
-      /* Launch ze thread. */
-      vpool_enqueue( vpool, noise_genNebulaMap_thread, args );
+      for (ty=0; ty<nty; ty++) {
+         for (tx=0; tx<ntx; tx++) {
+            /* Make ze arguments! */
+            args     = malloc( sizeof(thread_args) );
+            args->z  = z;
+            args->x0 = tx * NEBULA_TILE_W;
+            args->x1 = MIN( w, args->x0 + NEBULA_TILE_W );
+            args->y0 = ty * NEBULA_TILE_H;
+            args->y1 = MIN( h, args->y0 + NEBULA_TILE_H );
+            args->zoom = zoom;
+            args->n  = n;
+            args->h  = h;
+            args->w  = w;
+            args->noise = noise;
+            args->octaves = octaves;
+            args->max = &_max[i++];
+            args->nebula = nebula;
+
+            /* Launch ze thread. */
+            vpool_enqueue( vpool, noise_genNebulaMap_thread, args );
+         }
+      }
    }
 
    /* Wait for threads to signal completion. */
    vpool_wait( vpool );
    max = 0.;
-   for (i=0; i<n; i++) {
+   for (i=0; i<ntiles; i++) {
       if (_max[i]>max)
          max = _max[i];
    }
@@ -13,8 +13,8 @@
 
 #define VX(v)     ((v).x) /**< Gets the X component of a vector. */
 #define VY(v)     ((v).y) /**< Gets the Y component of a vector. */
-#define VMOD(v)   ((v).mod) /**< Gets the modulus of a vector. */
-#define VANGLE(v) ((v).angle) /**< Gets the angle of a vector. */
+#define VMOD(v)   (MOD((v).x,(v).y)) /**< Gets the modulus of a vector. */
+#define VANGLE(v) (ANGLE((v).x,(v).y)) /**< Gets the angle of a vector. */
 
 #define MOD(x,y)  (sqrt((x)*(x)+(y)*(y))) /**< Gets the modulus of a vector by cartesian coordinates. */
 #define ANGLE(x,y) (atan2(y,x)) /**< Gets the angle of two cartesian coordinates. */
@@ -29,16 +29,19 @@
  */
 #define SOLID_UPDATE_RK4      0 /**< Default Runge-Kutta 3-4 update. */
 #define SOLID_UPDATE_EULER    1 /**< Simple Euler update. */
+#define SOLID_UPDATE_SEMI     2 /**< Semi-implicit Euler update with analytic speed limit. */
+#define SOLID_UPDATE_AUTO     3 /**< RK4 or semi-implicit depending on the configuration. */
 
 
 /**
  * @brief Represents a 2d vector.
+ *
+ * Only the cartesian components are stored, the polar ones are computed on
+ *  demand with VMOD() and VANGLE() as most vectors never need them.
  */
 typedef struct Vector2d_ {
    double x; /**< X cartesian position of the vector. */
    double y; /**< Y cartesian position of the vector. */
-   double mod; /**< Modulus of the vector. */
-   double angle; /**< Angle of the vector. */
 } Vector2d; /**< 2 dimensional vector. */
 
 
@@ -52,7 +55,7 @@ double angle_diff( const double ref, double a );
  * vector manipulation
  */
 void vect_cset( Vector2d* v, const double x, const double y );
-void vect_csetmin( Vector2d* v, const double x, const double y ); /* does not set mod nor angle */
+void vect_csetmin( Vector2d* v, const double x, const double y );
 void vect_pset( Vector2d* v, const double mod, const double angle );
 void vectnull( Vector2d* v );
 double vect_angle( const Vector2d* ref, const Vector2d* v );
@@ -62,6 +62,19 @@ int pilot_nstack = 0; /**< same */
 static int pilot_mstack = 0; /**< Memory allocated for pilot_stack. */
 
 
+/**
+ * @brief Slot of the ID lookup table.
+ */
+typedef struct PilotIdSlot_ {
+   unsigned int id; /**< Full ID of the pilot, the bits above the mask act as generation. */
+   Pilot *p; /**< Pilot in the slot or NULL if free. */
+} PilotIdSlot;
+#define PILOT_IDTABLE_MIN 256 /**< Minimum size of the ID lookup table. */
+static PilotIdSlot *pilot_idtable = NULL; /**< ID lookup table, indexed by the low bits of the ID. */
+static unsigned int pilot_idmask = 0; /**< Mask of the table, size is pilot_idmask+1. */
+static int pilot_idcollide = 0; /**< Pilots that didn't get a slot and need to be searched for. */
+
+
 /* misc */
 static double pilot_commTimeout  = 15.; /**< Time for text above pilot to time out. */
 static double pilot_commFade     = 5.; /**< Time for text above pilot to fade out. */
@@ -78,9 +91,16 @@ static void pilot_refuel( Pilot *p, double dt );
 static void pilot_dead( Pilot* p, unsigned int killer );
 /* Targetting. */
 static int pilot_validEnemy( const Pilot* p, const Pilot* target );
+static int pilot_filterEnemy( const Pilot* p, const Pilot* target, void *data );
+static int pilot_filterEnemySize( const Pilot* p, const Pilot* target, void *data );
+static int pilot_filterNearest( const Pilot* p, const Pilot* target, void *data );
 /* Misc. */
 static void pilot_setCommMsg( Pilot *p, const char *s );
+static int pilot_slotIdle( const Pilot *p, const PilotOutfitSlot *o );
 static int pilot_getStackPos( const unsigned int id );
+static void pilot_idRebuild (void);
+static void pilot_idAdd( Pilot *p );
+static void pilot_idRm( Pilot *p );
 
 
 /**
@@ -118,6 +138,83 @@ static int pilot_getStackPos( const unsigned int id )
 }
 
 
+/**
+ * @brief Rebuilds the ID lookup table from the pilot stack.
+ *
+ * The table is resized to have at least twice as many slots as the stack
+ *  can hold, so IDs rarely land on the same slot.
+ */
+static void pilot_idRebuild (void)
+{
+   int i;
+   unsigned int n;
+
+   n = PILOT_IDTABLE_MIN;
+   while ((int)n < 2*pilot_mstack)
+      n <<= 1;
+   if (n != pilot_idmask+1) {
+      free( pilot_idtable );
+      pilot_idtable = malloc( n * sizeof(PilotIdSlot) );
+      pilot_idmask  = n-1;
+   }
+   memset( pilot_idtable, 0, n * sizeof(PilotIdSlot) );
+   pilot_idcollide = 0;
+
+   for (i=0; i<pilot_nstack; i++)
+      pilot_idAdd( pilot_stack[i] );
+}
+
+
+/**
+ * @brief Adds a pilot to the ID lookup table.
+ *
+ *    @param p Pilot to add, must already be in the stack.
+ */
+static void pilot_idAdd( Pilot *p )
+{
+   PilotIdSlot *slot;
+
+   /* The player is looked up directly. */
+   if (p->id == PLAYER_ID)
+      return;
+
+   /* Grow with the stack, this adds the pilot too. */
+   if ((pilot_idtable == NULL) || (2*pilot_mstack > (int)pilot_idmask+1)) {
+      pilot_idRebuild();
+      return;
+   }
+
+   /* Slot taken by a pilot that lived long enough to be lapped. */
+   slot = &pilot_idtable[ p->id & pilot_idmask ];
+   if (slot->p != NULL) {
+      pilot_idcollide++;
+      return;
+   }
+   slot->id = p->id;
+   slot->p  = p;
+}
+
+
+/**
+ * @brief Removes a pilot from the ID lookup table.
+ *
+ *    @param p Pilot to remove.
+ */
+static void pilot_idRm( Pilot *p )
+{
+   PilotIdSlot *slot;
+
+   if ((p->id == PLAYER_ID) || (pilot_idtable == NULL))
+      return;
+
+   slot = &pilot_idtable[ p->id & pilot_idmask ];
+   if (slot->p == p)
+      slot->p = NULL;
+   else
+      pilot_idcollide--;
+}
+
+
 /**
  * @brief Gets the next pilot based on id.
  *
@@ -281,6 +378,30 @@ static int pilot_validEnemy( const Pilot* p, const Pilot* target )
 }
 
 
+/**
+ * @brief Spatial query filter for valid enemies.
+ */
+static int pilot_filterEnemy( const Pilot* p, const Pilot* target, void *data )
+{
+   (void) data;
+   return pilot_validEnemy( p, target );
+}
+
+
+/**
+ * @brief Spatial query filter for valid enemies within mass bounds.
+ *
+ * The data must point to the lower and upper mass bounds.
+ */
+static int pilot_filterEnemySize( const Pilot* p, const Pilot* target, void *data )
+{
+   const double *bounds = (const double*) data;
+   if ((target->solid->mass < bounds[0]) || (target->solid->mass > bounds[1]))
+      return 0;
+   return pilot_validEnemy( p, target );
+}
+
+
 /**
  * @brief Gets the nearest enemy to the pilot.
  *
@@ -289,25 +410,14 @@ static int pilot_validEnemy( const Pilot* p, const Pilot* target )
  */
 unsigned int pilot_getNearestEnemy( const Pilot* p )
 {
-   unsigned int tp;
-   int i;
-   double d, td;
-
-   tp = 0;
-   d  = 0.;
-   for (i=0; i<pilot_nstack; i++) {
-
-      if (!pilot_validEnemy( p, pilot_stack[i] ))
-         continue;
+   PilotGridQuery q;
+   Pilot *t;
 
-      /* Check distance. */
-      td = vect_dist2(&pilot_stack[i]->solid->pos, &p->solid->pos);
-      if (!tp || (td < d)) {
-         d  = td;
-         tp = pilot_stack[i]->id;
-      }
-   }
-   return tp;
+   pilot_gridQueryInit( &q, p, PILOT_GRID_ENEMY );
+   q.filter = pilot_filterEnemy;
+   if (pilot_gridNearest( &q, p->solid->pos.x, p->solid->pos.y, 1, &t, NULL ) == 0)
+      return 0;
+   return t->id;
 }
 
 /**
@@ -320,29 +430,18 @@ unsigned int pilot_getNearestEnemy( const Pilot* p )
  */
 unsigned int pilot_getNearestEnemy_size( const Pilot* p, double target_mass_LB, double target_mass_UB)
 {
-   unsigned int tp;
-   int i;
-   double d, td;
-
-   tp = 0;
-   d  = 0.;
-   for (i=0; i<pilot_nstack; i++) {
-
-      if (!pilot_validEnemy( p, pilot_stack[i] ))
-         continue;
-
-      if (pilot_stack[i]->solid->mass < target_mass_LB || pilot_stack[i]->solid->mass > target_mass_UB)
-         continue;
-
-      /* Check distance. */
-      td = vect_dist2(&pilot_stack[i]->solid->pos, &p->solid->pos);
-      if (!tp || (td < d)) {
-         d = td;
-         tp = pilot_stack[i]->id;
-      }
-   }
-
-   return tp;
+   PilotGridQuery q;
+   Pilot *t;
+   double bounds[2];
+
+   bounds[0] = target_mass_LB;
+   bounds[1] = target_mass_UB;
+   pilot_gridQueryInit( &q, p, PILOT_GRID_ENEMY );
+   q.filter = pilot_filterEnemySize;
+   q.data   = bounds;
+   if (pilot_gridNearest( &q, p->solid->pos.x, p->solid->pos.y, 1, &t, NULL ) == 0)
+      return 0;
+   return t->id;
 }
 
 /**
@@ -359,19 +458,23 @@ unsigned int pilot_getNearestEnemy_heuristic( const Pilot* p,
       double mass_factor, double health_factor,
       double damage_factor, double range_factor )
 {
+   PilotGridQuery q;
+   Pilot **enemies;
    unsigned int tp;
-   int i;
+   int i, n;
    double temp, current_heuristic_value;
    Pilot *target;
 
    current_heuristic_value = 10000.;
 
-   tp = 0;
-   for (i=0; i<pilot_nstack; i++) {
-      target = pilot_stack[i];
+   /* The heuristic isn't monotonic in distance, so check all the enemies. */
+   pilot_gridQueryInit( &q, p, PILOT_GRID_ENEMY );
+   q.filter = pilot_filterEnemy;
+   n = pilot_gridRadius( &q, p->solid->pos.x, p->solid->pos.y, -1., &enemies );
 
-      if (!pilot_validEnemy( p, target ))
-         continue;
+   tp = 0;
+   for (i=0; i<n; i++) {
+      target = enemies[i];
 
       /* Check distance. */
       temp = range_factor *
@@ -471,6 +574,29 @@ unsigned int pilot_getBoss( const Pilot* p )
    return t;
 }
 
+/**
+ * @brief Spatial query filter for pilot_getNearestPos.
+ *
+ * The data must point to the disabled parameter.
+ */
+static int pilot_filterNearest( const Pilot* p, const Pilot* target, void *data )
+{
+   int disabled = *(const int*) data;
+
+   /* Player doesn't select escorts (unless disabled is active). */
+   if (!disabled && (p->faction == FACTION_PLAYER) &&
+         (target->faction == FACTION_PLAYER))
+      return 0;
+
+   /* Shouldn't be disabled. */
+   if (!disabled && pilot_isDisabled(target))
+      return 0;
+
+   /* Must be a valid target. */
+   return pilot_validTarget( p, target );
+}
+
+
 /**
  * @brief Get the nearest pilot to a pilot from a certain position.
  *
@@ -479,41 +605,22 @@ unsigned int pilot_getBoss( const Pilot* p )
  *    @param x X position to calculate from.
  *    @param y Y position to calculate from.
  *    @param disabled Whether to return disabled pilots.
- *    @return The distance to the nearest pilot.
+ *    @return The squared distance to the nearest pilot.
  */
 double pilot_getNearestPos( const Pilot *p, unsigned int *tp, double x, double y, int disabled )
 {
-   int i;
-   double d, td;
-
-   *tp = PLAYER_ID;
-   d  = 0;
-   for (i=0; i<pilot_nstack; i++) {
-
-      /* Must not be self. */
-      if (pilot_stack[i] == p)
-         continue;
-
-      /* Player doesn't select escorts (unless disabled is active). */
-      if (!disabled && (p->faction == FACTION_PLAYER) &&
-            (pilot_stack[i]->faction == FACTION_PLAYER))
-         continue;
-
-      /* Shouldn't be disabled. */
-      if (!disabled && pilot_isDisabled(pilot_stack[i]))
-         continue;
-
-      /* Must be a valid target. */
-      if (!pilot_validTarget( p, pilot_stack[i] ))
-         continue;
+   PilotGridQuery q;
+   Pilot *t;
+   double d;
 
-      /* Minimum distance. */
-      td = pow2(x-pilot_stack[i]->solid->pos.x) + pow2(y-pilot_stack[i]->solid->pos.y);
-      if (((*tp==PLAYER_ID) || (td < d))) {
-         d = td;
-         *tp = pilot_stack[i]->id;
-      }
+   pilot_gridQueryInit( &q, p, PILOT_GRID_ANY );
+   q.filter = pilot_filterNearest;
+   q.data   = &disabled;
+   if (pilot_gridNearest( &q, x, y, 1, &t, &d ) == 0) {
+      *tp = PLAYER_ID;
+      return 0.;
    }
+   *tp = t->id;
    return d;
 }
 
@@ -576,9 +683,9 @@ double pilot_getNearestAng( const Pilot *p, unsigned int *tp, double ang, int di
 /**
  * @brief Pulls a pilot out of the pilot_stack based on ID.
  *
- * It's a binary search ( O(logn) ) therefore it's pretty fast and can be
- *  abused all the time.  Maximum iterations is 32 on a platform with 32 bit
- *  unsigned ints.
+ * The low bits of the ID index the lookup table directly and the stored ID
+ *  tells stale IDs apart, so it's O(1) and can be abused all the time. Only
+ *  pilots that didn't get their slot fall back to a binary search.
  *
  *    @param id ID of the pilot to get.
  *    @return The actual pilot who has matching ID or NULL if not found.
@@ -586,10 +693,20 @@ double pilot_getNearestAng( const Pilot *p, unsigned int *tp, double ang, int di
 Pilot* pilot_get( const unsigned int id )
 {
    int m;
+   PilotIdSlot *slot;
 
    if (id==PLAYER_ID)
       return player.p; /* special case player.p */
 
+   if (pilot_idtable != NULL) {
+      slot = &pilot_idtable[ id & pilot_idmask ];
+      if ((slot->p != NULL) && (slot->id == id))
+         return pilot_isFlag(slot->p, PILOT_DELETE) ? NULL : slot->p;
+      /* Stale or unknown ID. */
+      if (pilot_idcollide == 0)
+         return NULL;
+   }
+
    m = pilot_getStackPos(id);
 
    if ((m==-1) || (pilot_isFlag(pilot_stack[m], PILOT_DELETE)))
@@ -1002,16 +1119,16 @@ double pilot_aimAngle( Pilot *p, Pilot *target )
    /* Time for shots to reach that distance */
    /* t is the real positive solution of a 2nd order equation*/
    /* if the target is not hittable (i.e., fleeing faster than our shots can fly, determinant <= 0), just face the target */
-   if ( ((speed*speed - VMOD(approach_vector)*VMOD(approach_vector)) != 0) && (speed*speed - orthoradial_speed*orthoradial_speed) > 0)
+   if ( ((speed*speed - vect_odist2(&approach_vector)) != 0) && (speed*speed - orthoradial_speed*orthoradial_speed) > 0)
       t = dist * (sqrt( speed*speed - orthoradial_speed*orthoradial_speed ) - radial_speed) /
-            (speed*speed - VMOD(approach_vector)*VMOD(approach_vector));
+            (speed*speed - vect_odist2(&approach_vector));
    else
       t = 0;
 
    /* if t < 0, try the other solution*/
    if (t < 0)
       t = - dist * (sqrt( speed*speed - orthoradial_speed*orthoradial_speed ) + radial_speed) /
-            (speed*speed - VMOD(approach_vector)*VMOD(approach_vector));
+            (speed*speed - vect_odist2(&approach_vector));
 
    /* if t still < 0, no solution*/
    if (t < 0)
@@ -1553,7 +1670,7 @@ void pilot_updateDisable( Pilot* p, const unsigned int shooter )
 
       /* Disable active outfits. */
       if (pilot_outfitOffAll( p ) > 0)
-         pilot_calcStats( p );
+         pilot_calcStatsUpdate( p );
 
       pilot_setFlag( p,PILOT_DISABLED ); /* set as disabled */
       /* Run hook */
@@ -1792,6 +1909,26 @@ void pilot_renderOverlay( Pilot* p, const double dt )
 }
 
 
+/**
+ * @brief Checks to see if an outfit slot has nothing left to update.
+ *
+ * Launchers and fighter bays are always updated for reloading and lockons.
+ *
+ *    @param p Pilot whose slot it is.
+ *    @param o Slot to check.
+ *    @return 1 if the slot can be dropped from the update list.
+ */
+static int pilot_slotIdle( const Pilot *p, const PilotOutfitSlot *o )
+{
+   if ((o->timer > 0.) || (o->stimer >= 0.))
+      return 0;
+   if ((outfit_isLauncher( o->outfit ) || outfit_isFighterBay( o->outfit )) &&
+         (outfit_ammo( o->outfit ) != NULL))
+      return 0;
+   return pilot_heatIsEquilibrium( p, o );
+}
+
+
 /**
  * @brief Updates the pilot.
  *
@@ -1845,14 +1982,15 @@ void pilot_update( Pilot* pilot, const double dt )
    a = -1.;
    Q = 0.;
    nchg = 0; /* Number of outfits that change state, processed at the end. */
-   for (i=0; i<pilot->noutfits; i++) {
-      o = pilot->outfits[i];
+   for (i=0; i<pilot->noutfit_awake; i++) {
+      o = pilot->outfit_awake[i];
 
-      /* Picky about our outfits. */
-      if (o->outfit == NULL)
-         continue;
-      if (!o->active)
+      /* Picky about our outfits, idle ones go to sleep until woken up. */
+      if ((o->outfit == NULL) || !o->active) {
+         o->awake = 0;
+         pilot->outfit_awake[i--] = pilot->outfit_awake[ --pilot->noutfit_awake ];
          continue;
+      }
 
       /* Handle firerate timer. */
       if (o->timer > 0.)
@@ -1900,7 +2038,7 @@ void pilot_update( Pilot* pilot, const double dt )
                nchg++;
             }
             else if (o->state == PILOT_OUTFIT_COOLDOWN) {
-               o->state  = PILOT_OUTFIT_OFF;
+               pilot_outfitState( pilot, o, PILOT_OUTFIT_OFF );
                nchg++;
             }
          }
@@ -1912,6 +2050,12 @@ void pilot_update( Pilot* pilot, const double dt )
 
       /* Handle lockons. */
       pilot_lockUpdateSlot( pilot, o, target, &a, dt );
+
+      if (pilot_slotIdle( pilot, o )) {
+         o->awake = 0;
+         pilot->outfit_awake[i--] = pilot->outfit_awake[ --pilot->noutfit_awake ];
+         pilot->outfit_asleep = 1;
+      }
    }
 
    /* Global heat. */
@@ -1920,6 +2064,11 @@ void pilot_update( Pilot* pilot, const double dt )
    else
       pilot_heatUpdateCooldown( pilot );
 
+   /* Sleeping slots have to follow the ship once it leaves equilibrium. */
+   if (pilot->outfit_asleep &&
+         (fabs(pilot->heat_T - CONST_SPACE_STAR_TEMP) > HEAT_EQUILIBRIUM_DT))
+      pilot_outfitWakeAll( pilot );
+
    /* Update electronic warfare. */
    pilot_ewUpdateDynamic( pilot );
 
@@ -2109,9 +2258,9 @@ void pilot_update( Pilot* pilot, const double dt )
       nchg += pilot_outfitOffAll( pilot );
    }
 
-   /* Must recalculate stats because something changed state. */
+   /* Must update stats because something changed state. */
    if (nchg > 0)
-      pilot_calcStats( pilot );
+      pilot_calcStatsUpdate( pilot );
 
    /* Player damage decay. */
    if (pilot->player_damage > 0.)
@@ -2569,6 +2718,10 @@ void pilot_init( Pilot* pilot, Ship* ship, const char* name, int faction, const
    else
       pilot->id = ++pilot_id; /* new unique pilot id based on pilot_id, can't be 0 */
 
+   /* Must be found by ID before the AI and such are set up. */
+   if (!pilot_isFlagRaw( flags, PILOT_EMPTY ))
+      pilot_idAdd( pilot );
+
    /* Defaults. */
    pilot->autoweap = 1;
    pilot->aimLines = 0;
@@ -2583,7 +2736,7 @@ void pilot_init( Pilot* pilot, Ship* ship, const char* name, int faction, const
    pilot->faction = faction;
 
    /* solid */
-   pilot->solid = solid_create(ship->mass, dir, pos, vel, SOLID_UPDATE_RK4);
+   pilot->solid = solid_create(ship->mass, dir, pos, vel, SOLID_UPDATE_AUTO);
 
    /* First pass to make sure requirements make sense. */
    pilot->armour = pilot->armour_max = 1.; /* hack to have full armour */
@@ -2679,6 +2832,10 @@ void pilot_init( Pilot* pilot, Ship* ship, const char* name, int faction, const
    /* Copy pilot flags. */
    pilot_copyFlagsRaw(pilot->flags, flags);
 
+   /* Default outfits were added before the flags were set. */
+   if (pilot_isPlayer(pilot))
+      player_modPilotOutfits( pilot, 1 );
+
    /* Clear timers. */
    pilot_clearTimers(pilot);
 
@@ -2744,6 +2901,7 @@ unsigned int pilot_create( Ship* ship, const char* name, int faction, const char
    /* Set the pilot in the stack -- must be there before initializing */
    pilot_stack[pilot_nstack] = dyn;
    pilot_nstack++; /* there's a new pilot */
+   pilot_gridInvalidate();
 
    /* Initialize the pilot. */
    pilot_init( dyn, ship, name, faction, ai, dir, pos, vel, flags, dockpilot, dockslot );
@@ -2824,6 +2982,9 @@ Pilot* pilot_copy( Pilot* src )
    for (i=0; i<dest->outfit_nweapon; i++)
       dest->outfits[p++] = &dest->outfit_weapon[i];
    dest->afterburner = NULL;
+   dest->outfit_awake = NULL;
+   dest->noutfit_awake = 0;
+   pilot_outfitWakeAll( dest );
 
    /* Hooks get cleared. */
    dest->hooks           = NULL;
@@ -2948,6 +3109,10 @@ void pilot_free( Pilot* p )
    /* Clear up pilot hooks. */
    pilot_clearHooks(p);
 
+   /* The player no longer owns its outfits. */
+   if (pilot_isPlayer(p))
+      player_modPilotOutfits( p, -1 );
+
    /* If hostile, must remove counter. */
    pilot_rmHostile(p);
 
@@ -2957,6 +3122,7 @@ void pilot_free( Pilot* p )
    /* Free outfits. */
    if (p->outfits != NULL)
       free(p->outfits);
+   free(p->outfit_awake);
    if (p->outfit_structure != NULL)
       free(p->outfit_structure);
    if (p->outfit_utility != NULL)
@@ -3036,8 +3202,10 @@ void pilot_destroy(Pilot* p)
    }
 
    /* pilot is eliminated */
+   pilot_idRm(p);
    pilot_free(p);
    pilot_nstack--;
+   pilot_gridInvalidate();
 
    /* copy other pilots down */
    memmove(&pilot_stack[i], &pilot_stack[i+1], (pilot_nstack-i)*sizeof(Pilot*));
@@ -3060,6 +3228,11 @@ void pilots_free (void)
    pilot_stack = NULL;
    player.p = NULL;
    pilot_nstack = 0;
+   pilot_gridFree();
+   free(pilot_idtable);
+   pilot_idtable   = NULL;
+   pilot_idmask    = 0;
+   pilot_idcollide = 0;
 }
 
 
@@ -3091,6 +3264,8 @@ void pilots_clean (int persist)
    }
 
    pilot_nstack = persist_count;
+   pilot_gridInvalidate();
+   pilot_idRebuild();
 
    /* Clear global hooks. */
    pilots_clearGlobalHooks();
@@ -3120,6 +3295,8 @@ void pilots_cleanAll (void)
       player.p = NULL;
    }
    pilot_nstack = 0;
+   pilot_gridInvalidate();
+   pilot_idRebuild();
 }
 
 
@@ -3132,6 +3309,13 @@ void pilots_update( double dt )
 {
    int i;
    Pilot *p;
+   Vector2d pos;
+
+   /* Spatial queries this tick should see the current positions. */
+   pilot_gridInvalidate();
+
+   /* New AI think budget. */
+   ai_lodFrame();
 
    /* Now update all the pilots. */
    for (i=0; i<pilot_nstack; i++) {
@@ -3186,9 +3370,16 @@ void pilots_update( double dt )
          continue;
 
       /* Just update the pilot. */
-      if (p->update) /* update */
+      if (p->update) { /* update */
+         pos = p->solid->pos;
          p->update( p, dt );
+         /* Queries from the rest of the update see this pilot moved. */
+         pilot_gridMoved( vect_dist( &pos, &p->solid->pos ) );
+      }
    }
+
+   /* Pilots have moved. */
+   pilot_gridInvalidate();
 }
 
 
@@ -3244,6 +3435,7 @@ void pilot_clearTimers( Pilot *pilot )
 
    pilot->ptimer     = 0.; /* Pilot timer. */
    pilot->tcontrol   = 0.; /* AI control timer. */
+   pilot->tthink     = 0.; /* AI think timer. */
    pilot->stimer     = 0.; /* Shield timer. */
    pilot->dtimer     = 0.; /* Disable timer. */
    for (i=0; i<MAX_AI_TIMERS; i++)
@@ -3262,6 +3454,8 @@ void pilot_clearTimers( Pilot *pilot )
    /* Must recalculate stats. */
    if (n > 0)
       pilot_calcStats( pilot );
+   else
+      pilot_outfitWakeAll( pilot ); /* State timers were reset. */
 }
 
 
@@ -124,6 +124,7 @@ typedef struct PilotOutfitSlot_ {
    double rtimer;    /**< Used to store when a reload can happen. */
    int level;        /**< Level in current weapon set (-1 is none). */
    int weapset;      /**< First weapon set that uses the outfit (-1 is none). */
+   int awake;        /**< Slot is in the pilot's outfit_awake list. */
 
    /* Type-specific data. */
    union {
@@ -202,6 +203,36 @@ typedef struct Escort_s {
 } Escort_t;
 
 
+/**
+ * @brief Raw sums of everything the outfits add to a pilot.
+ *
+ * Kept around so that turning a single outfit on or off only has to add or
+ * remove its own contribution instead of walking all the outfits again.
+ */
+typedef struct PilotStatSums_ {
+   ShipStats stats;     /**< Unclamped stat sum, see ss_statsSumFromList(). */
+   ShipStats amount;    /**< Number of positive contributions to each stat. */
+   int cpu;             /**< CPU used by outfits. */
+   double base_mass;    /**< Ship mass plus core outfit mass. */
+   double mass_outfit;  /**< Mass added by outfits. */
+   double thrust;       /**< Base thrust. */
+   double turn;         /**< Base turn. */
+   double speed;        /**< Base speed. */
+   double crew;         /**< Crew. */
+   double cap_cargo;    /**< Cargo capacity. */
+   double absorb;       /**< Damage absorption. */
+   double armour;       /**< Maximum armour. */
+   double armour_regen; /**< Armour regeneration. */
+   double shield;       /**< Maximum shield. */
+   double shield_regen; /**< Shield regeneration. */
+   double energy;       /**< Maximum energy. */
+   double energy_regen; /**< Energy regeneration. */
+   double energy_loss;  /**< Linear energy loss. */
+   int fuel;            /**< Maximum fuel. */
+   int afterburners;    /**< Number of afterburners turned on. */
+} PilotStatSums;
+
+
 /**
  * @brief The representation of an in-game pilot.
  */
@@ -282,6 +313,8 @@ typedef struct Pilot_ {
 
    /* Ship statistics. */
    ShipStats stats;  /**< Pilot's copy of ship statistics. */
+   PilotStatSums stat_sums; /**< Outfit contributions the stats are built from. */
+   int stat_ndelta;  /**< Incremental updates since the last full recalculation. */
 
    /* Associated functions */
    void (*think)(struct Pilot_*, const double); /**< AI thinking for the pilot */
@@ -293,6 +326,9 @@ typedef struct Pilot_ {
    /* Global outfits. */
    int noutfits;     /**< Total amount of slots. */
    PilotOutfitSlot **outfits; /**< Total outfits. */
+   PilotOutfitSlot **outfit_awake; /**< Slots with timers or heat to update. */
+   int noutfit_awake; /**< Number of slots in outfit_awake. */
+   int outfit_asleep; /**< Slots have been dropped from outfit_awake. */
    /* Per slot types. */
    int outfit_nstructure; /**< Number of structure slots. */
    PilotOutfitSlot *outfit_structure; /**< The structure slots. */
@@ -346,6 +382,7 @@ typedef struct Pilot_ {
    /* AI */
    AI_Profile* ai;   /**< AI personality profile */
    double tcontrol;  /**< timer for control tick */
+   double tthink;    /**< timer for the next think, see ai_think */
    double timer[MAX_AI_TIMERS]; /**< timers for AI */
    Task* task;       /**< current action */
    unsigned int shoot_indicator; /**< Indicator to inform the AI if a seeker has been shot recently. */
@@ -380,6 +417,7 @@ typedef struct Pilot_ {
 #include "pilot_outfit.h"
 #include "pilot_weapon.h"
 #include "pilot_ew.h"
+#include "pilot_grid.h"
 
 
 /*
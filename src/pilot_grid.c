@@ -0,0 +1,694 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+/**
+ * @file pilot_grid.c
+ *
+ * @brief Spatial index of the pilot stack.
+ *
+ * Pilots are bucketed into a uniform grid whose cells are hashed, so it works
+ *  for any system size. The grid is rebuilt lazily the first time it is
+ *  queried after being invalidated. The pilot stack invalidates it every tick
+ *  and whenever pilots are added or removed, so the pilot pointers it holds
+ *  are always valid.
+ *
+ * Cells are assigned from the positions at build time, distances are always
+ *  computed from the current positions. Pilots that move while the grid is
+ *  built report how far they went so the cell bounds can be padded.
+ *
+ * @note Queries are not reentrant, filters must not run queries themselves.
+ */
+
+
+#include "pilot_grid.h"
+
+#include "naev.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "array.h"
+#include "nstring.h"
+#include "log.h"
+#include "faction.h"
+#include "player.h"
+
+
+#define GRID_CELL          1000. /**< Size of a grid cell. */
+#define GRID_COORD_MAX     (1<<20) /**< Maximum absolute cell coordinate. */
+#define GRID_BUCKETS_MIN   64 /**< Minimum number of hash buckets. */
+
+
+/**
+ * @brief A pilot in the grid.
+ */
+typedef struct GridEntry_ {
+   Pilot *p;   /**< Pilot. */
+   int cx;     /**< Cell X coordinate. */
+   int cy;     /**< Cell Y coordinate. */
+   int fidx;   /**< Index into grid_factions. */
+} GridEntry;
+
+
+/**
+ * @brief A faction present in the grid.
+ */
+typedef struct GridFaction_ {
+   int faction; /**< Faction ID. */
+   int n;      /**< Number of pilots of the faction. */
+   int match;  /**< Whether it matches the query being run. */
+} GridFaction;
+
+
+/**
+ * @brief Running k nearest neighbour search.
+ */
+typedef struct GridKNN_ {
+   const PilotGridQuery *q; /**< Query being run. */
+   double x;      /**< X position to search from. */
+   double y;      /**< Y position to search from. */
+   int k;         /**< Number of pilots wanted. */
+   int n;         /**< Number of pilots found so far. */
+   Pilot **out;   /**< Found pilots sorted by distance. */
+   double *d2;    /**< Squared distances of the found pilots. */
+   int seen;      /**< Relation matching pilots examined. */
+} GridKNN;
+
+
+/**
+ * @brief Running radius search.
+ */
+typedef struct GridRadius_ {
+   const PilotGridQuery *q; /**< Query being run. */
+   double x;      /**< X position to search from. */
+   double y;      /**< Y position to search from. */
+   double r2;     /**< Squared radius. */
+   Pilot **out;   /**< Found pilots (array.h). */
+} GridRadius;
+
+
+/**
+ * @brief Visits an entry of the grid.
+ */
+typedef void (*GridVisitor)( const GridEntry *e, void *data );
+
+
+/*
+ * extern pilot hacks
+ */
+extern Pilot** pilot_stack;
+extern int pilot_nstack;
+
+
+static int grid_dirty         = 1; /**< Grid must be rebuilt before use. */
+static GridEntry *grid_entries = NULL; /**< Entries sorted by bucket (array.h). */
+static GridEntry *grid_scratch = NULL; /**< Unsorted entries used while building (array.h). */
+static int *grid_bucket       = NULL; /**< Bucket start offsets, one more than buckets (array.h). */
+static int grid_nbuckets      = 0; /**< Number of hash buckets. */
+static GridFaction *grid_factions = NULL; /**< Factions in the grid (array.h). */
+static int grid_hostilePlayer = 0; /**< Player matches current query by being attacked. */
+static int grid_xmin = 0; /**< Minimum X cell in the grid. */
+static int grid_xmax = 0; /**< Maximum X cell in the grid. */
+static int grid_ymin = 0; /**< Minimum Y cell in the grid. */
+static int grid_ymax = 0; /**< Maximum Y cell in the grid. */
+static double grid_slack = 0.; /**< Furthest a pilot moved since the grid was built. */
+static Pilot **grid_found = NULL; /**< Results of the last radius query (array.h). */
+
+
+/*
+ * Prototypes.
+ */
+static int grid_coord( double x );
+static unsigned int grid_hash( int cx, int cy );
+static void grid_build (void);
+static int grid_prepare( const PilotGridQuery *q );
+static int grid_matches( const GridEntry *e );
+static int grid_visitCell( int cx, int cy, GridVisitor visit, void *data );
+static int grid_visitRing( int cx, int cy, int r, GridVisitor visit, void *data );
+static int grid_ringCells( int cx, int cy, int r );
+static void grid_knnVisit( const GridEntry *e, void *data );
+static void grid_radiusVisit( const GridEntry *e, void *data );
+
+
+/**
+ * @brief Gets the cell coordinate of a position.
+ */
+static int grid_coord( double x )
+{
+   double c = floor( x / GRID_CELL );
+   return (int) CLAMP( -GRID_COORD_MAX, GRID_COORD_MAX, c );
+}
+
+
+/**
+ * @brief Hashes a cell into a bucket.
+ */
+static unsigned int grid_hash( int cx, int cy )
+{
+   return (((unsigned int)cx * 73856093u) ^ ((unsigned int)cy * 19349663u)) &
+         (unsigned int)(grid_nbuckets-1);
+}
+
+
+/**
+ * @brief Marks the grid as needing to be rebuilt.
+ *
+ * Must be called whenever pilots are added to or removed from the stack, or
+ *  are moved further than they could travel in a tick.
+ */
+void pilot_gridInvalidate (void)
+{
+   grid_dirty = 1;
+}
+
+
+/**
+ * @brief Notes that a pilot moved without the grid being invalidated.
+ *
+ *    @param dist Distance the pilot moved.
+ */
+void pilot_gridMoved( double dist )
+{
+   if (!grid_dirty)
+      grid_slack = MAX( grid_slack, dist );
+}
+
+
+/**
+ * @brief Frees the grid.
+ */
+void pilot_gridFree (void)
+{
+   array_free( grid_entries );
+   array_free( grid_scratch );
+   array_free( grid_bucket );
+   array_free( grid_factions );
+   array_free( grid_found );
+   grid_entries   = NULL;
+   grid_scratch   = NULL;
+   grid_bucket    = NULL;
+   grid_factions  = NULL;
+   grid_found     = NULL;
+   grid_nbuckets  = 0;
+   grid_dirty     = 1;
+}
+
+
+/**
+ * @brief Rebuilds the grid from the pilot stack.
+ */
+static void grid_build (void)
+{
+   int i, j, n, b;
+   Pilot *p;
+   GridEntry *e;
+
+   if (grid_entries == NULL) {
+      grid_entries   = array_create( GridEntry );
+      grid_scratch   = array_create( GridEntry );
+      grid_bucket    = array_create( int );
+      grid_factions  = array_create( GridFaction );
+   }
+   array_resize( &grid_scratch, 0 );
+   array_resize( &grid_factions, 0 );
+
+   /* Compute the cells. */
+   for (i=0; i<pilot_nstack; i++) {
+      p = pilot_stack[i];
+      if (pilot_isFlag( p, PILOT_DELETE ))
+         continue;
+
+      e     = &array_grow( &grid_scratch );
+      e->p  = p;
+      e->cx = grid_coord( p->solid->pos.x );
+      e->cy = grid_coord( p->solid->pos.y );
+
+      /* There are only ever a handful of factions in a system. */
+      for (j=0; j<array_size(grid_factions); j++)
+         if (grid_factions[j].faction == p->faction)
+            break;
+      if (j >= array_size(grid_factions)) {
+         array_grow( &grid_factions ).faction = p->faction;
+         grid_factions[j].n = 0;
+      }
+      grid_factions[j].n++;
+      e->fidx = j;
+
+      /* Bounding box. */
+      if (array_size(grid_scratch) == 1) {
+         grid_xmin = grid_xmax = e->cx;
+         grid_ymin = grid_ymax = e->cy;
+      }
+      else {
+         grid_xmin = MIN( grid_xmin, e->cx );
+         grid_xmax = MAX( grid_xmax, e->cx );
+         grid_ymin = MIN( grid_ymin, e->cy );
+         grid_ymax = MAX( grid_ymax, e->cy );
+      }
+   }
+   n = array_size( grid_scratch );
+
+   /* Keep around twice as many buckets as pilots. */
+   grid_nbuckets = GRID_BUCKETS_MIN;
+   while (grid_nbuckets < 2*n)
+      grid_nbuckets <<= 1;
+   array_resize( &grid_bucket, grid_nbuckets+1 );
+   memset( grid_bucket, 0, (grid_nbuckets+1)*sizeof(int) );
+
+   /* Counting sort by bucket. */
+   for (i=0; i<n; i++)
+      grid_bucket[ grid_hash( grid_scratch[i].cx, grid_scratch[i].cy )+1 ]++;
+   for (i=0; i<grid_nbuckets; i++)
+      grid_bucket[i+1] += grid_bucket[i];
+   array_resize( &grid_entries, n );
+   for (i=0; i<n; i++) {
+      b = grid_hash( grid_scratch[i].cx, grid_scratch[i].cy );
+      grid_entries[ grid_bucket[b]++ ] = grid_scratch[i];
+   }
+   /* Placing shifted the offsets up by one bucket. */
+   memmove( &grid_bucket[1], &grid_bucket[0], grid_nbuckets*sizeof(int) );
+   grid_bucket[0] = 0;
+
+   grid_slack = 0.;
+   grid_dirty = 0;
+}
+
+
+/**
+ * @brief Sets up the faction matches of a query.
+ *
+ *    @param q Query to set up.
+ *    @return Upper bound on the number of pilots that can match the relation.
+ */
+static int grid_prepare( const PilotGridQuery *q )
+{
+   int i, n, f, t;
+   GridFaction *gf;
+
+   n = 0;
+   f = q->faction;
+   if ((q->rel != PILOT_GRID_ANY) && !faction_isFaction( f ))
+      return 0;
+   for (i=0; i<array_size(grid_factions); i++) {
+      gf = &grid_factions[i];
+      t  = gf->faction;
+      switch (q->rel) {
+         case PILOT_GRID_ENEMY:
+            gf->match = areEnemies( f, t );
+            break;
+         case PILOT_GRID_ALLY:
+            gf->match = (f == t) || areAllies( f, t );
+            break;
+         case PILOT_GRID_NEUTRAL:
+            gf->match = (f != t) && !areEnemies( f, t ) && !areAllies( f, t );
+            break;
+
+         default:
+            gf->match = 1;
+            break;
+      }
+      if (gf->match)
+         n += gf->n;
+   }
+
+   /* Pilots can also be enemies of the player on their own. */
+   grid_hostilePlayer = (q->rel == PILOT_GRID_ENEMY) && (q->ref != NULL) &&
+         (player.p != NULL) && pilot_isHostile( q->ref );
+   if (grid_hostilePlayer)
+      n++;
+
+   return n;
+}
+
+
+/**
+ * @brief Checks to see if an entry matches the relation of the query.
+ */
+static int grid_matches( const GridEntry *e )
+{
+   return grid_factions[ e->fidx ].match ||
+         (grid_hostilePlayer && (e->p == player.p));
+}
+
+
+/**
+ * @brief Visits all the entries in a cell.
+ *
+ *    @return Number of entries visited.
+ */
+static int grid_visitCell( int cx, int cy, GridVisitor visit, void *data )
+{
+   int i, b, n;
+   const GridEntry *e;
+
+   b = grid_hash( cx, cy );
+   n = 0;
+   for (i=grid_bucket[b]; i<grid_bucket[b+1]; i++) {
+      e = &grid_entries[i];
+      /* Buckets are shared by colliding cells. */
+      if ((e->cx != cx) || (e->cy != cy))
+         continue;
+      visit( e, data );
+      n++;
+   }
+   return n;
+}
+
+
+/**
+ * @brief Visits all the cells at Chebyshev distance r of a cell.
+ *
+ *    @return Number of entries visited.
+ */
+static int grid_visitRing( int cx, int cy, int r, GridVisitor visit, void *data )
+{
+   int x, y, x0, x1, y0, y1, n;
+
+   if (r == 0)
+      return grid_visitCell( cx, cy, visit, data );
+
+   n  = 0;
+   x0 = MAX( cx-r, grid_xmin );
+   x1 = MIN( cx+r, grid_xmax );
+   y0 = MAX( cy-r+1, grid_ymin );
+   y1 = MIN( cy+r-1, grid_ymax );
+
+   /* Top and bottom rows. */
+   if (cy-r >= grid_ymin)
+      for (x=x0; x<=x1; x++)
+         n += grid_visitCell( x, cy-r, visit, data );
+   if (cy+r <= grid_ymax)
+      for (x=x0; x<=x1; x++)
+         n += grid_visitCell( x, cy+r, visit, data );
+
+   /* Left and right columns. */
+   if (cx-r >= grid_xmin)
+      for (y=y0; y<=y1; y++)
+         n += grid_visitCell( cx-r, y, visit, data );
+   if (cx+r <= grid_xmax)
+      for (y=y0; y<=y1; y++)
+         n += grid_visitCell( cx+r, y, visit, data );
+
+   return n;
+}
+
+
+/**
+ * @brief Gets the number of cells of a ring that lie within the grid.
+ */
+static int grid_ringCells( int cx, int cy, int r )
+{
+   int w, h, n;
+
+   if (r == 0)
+      return 1;
+
+   w = MAX( 0, MIN( cx+r, grid_xmax ) - MAX( cx-r, grid_xmin ) + 1 );
+   h = MAX( 0, MIN( cy+r-1, grid_ymax ) - MAX( cy-r+1, grid_ymin ) + 1 );
+   n = 0;
+   if (cy-r >= grid_ymin)
+      n += w;
+   if (cy+r <= grid_ymax)
+      n += w;
+   if (cx-r >= grid_xmin)
+      n += h;
+   if (cx+r <= grid_xmax)
+      n += h;
+   return n;
+}
+
+
+/**
+ * @brief Initializes a query with default values.
+ *
+ *    @param q Query to initialize.
+ *    @param ref Reference pilot, its faction is used for relations (may be
+ *               NULL, in which case the faction must be set manually).
+ *    @param rel Relation pilots must have with the reference pilot.
+ */
+void pilot_gridQueryInit( PilotGridQuery *q, const Pilot *ref, PilotGridRel rel )
+{
+   q->ref      = ref;
+   q->faction  = (ref != NULL) ? ref->faction : -1;
+   q->rel      = rel;
+   q->maxdist  = -1.;
+   q->filter   = NULL;
+   q->data     = NULL;
+}
+
+
+/**
+ * @brief Tries to add an entry to a nearest neighbour search.
+ */
+static void grid_knnVisit( const GridEntry *e, void *data )
+{
+   GridKNN *knn;
+   const PilotGridQuery *q;
+   double d2;
+   int i;
+
+   knn = (GridKNN*) data;
+   q   = knn->q;
+
+   if (!grid_matches( e ))
+      return;
+   knn->seen++;
+
+   if (e->p == q->ref)
+      return;
+
+   d2 = pow2( e->p->solid->pos.x - knn->x ) + pow2( e->p->solid->pos.y - knn->y );
+   if ((q->maxdist >= 0.) && (d2 > pow2( q->maxdist )))
+      return;
+   if ((knn->n >= knn->k) && (d2 >= knn->d2[ knn->k-1 ]))
+      return;
+
+   /* Expensive checks go last. */
+   if ((q->filter != NULL) && !q->filter( q->ref, e->p, q->data ))
+      return;
+
+   /* Insertion sort, k is small. */
+   i = MIN( knn->n, knn->k-1 );
+   while ((i > 0) && (knn->d2[i-1] > d2)) {
+      knn->out[i] = knn->out[i-1];
+      knn->d2[i]  = knn->d2[i-1];
+      i--;
+   }
+   knn->out[i] = e->p;
+   knn->d2[i]  = d2;
+   if (knn->n < knn->k)
+      knn->n++;
+}
+
+
+/**
+ * @brief Gets the nearest pilots to a position.
+ *
+ * Searches rings of cells outwards from the position until no unvisited cell
+ *  can hold a closer pilot, all the pilots matching the relation have been
+ *  seen, or the remaining pilots are few enough to just check them all.
+ *
+ *    @param q Query to run.
+ *    @param x X position to search from.
+ *    @param y Y position to search from.
+ *    @param k Maximum number of pilots to get.
+ *    @param[out] out Pilots found sorted by distance, must fit k.
+ *    @param[out] dist2 Squared distances of the pilots found (may be NULL).
+ *    @return Number of pilots found.
+ */
+int pilot_gridNearest( const PilotGridQuery *q, double x, double y,
+      int k, Pilot **out, double *dist2 )
+{
+   GridKNN knn;
+   double buf[16];
+   double edge, ex, ey, bound;
+   int i, r, rmax, cx, cy, ncand, nvisited, nentries;
+   const GridEntry *e;
+
+   if (grid_dirty)
+      grid_build();
+
+   nentries = array_size( grid_entries );
+   if ((k <= 0) || (nentries == 0))
+      return 0;
+   k = MIN( k, nentries );
+
+   ncand = grid_prepare( q );
+   if (ncand == 0)
+      return 0;
+
+   knn.q    = q;
+   knn.x    = x;
+   knn.y    = y;
+   knn.k    = k;
+   knn.n    = 0;
+   knn.out  = out;
+   knn.seen = 0;
+   if (dist2 != NULL)
+      knn.d2 = dist2;
+   else if (k <= (int)(sizeof(buf)/sizeof(buf[0])))
+      knn.d2 = buf;
+   else
+      knn.d2 = malloc( k*sizeof(double) );
+
+   /* Distance from the position to the edge of its cell. */
+   cx    = grid_coord( x );
+   cy    = grid_coord( y );
+   ex    = x - cx*GRID_CELL;
+   ey    = y - cy*GRID_CELL;
+   edge  = MIN( MIN( ex, GRID_CELL-ex ), MIN( ey, GRID_CELL-ey ) );
+   edge  = MAX( 0., edge );
+   rmax  = MAX( MAX( ABS(cx-grid_xmin), ABS(grid_xmax-cx) ),
+         MAX( ABS(cy-grid_ymin), ABS(grid_ymax-cy) ) );
+
+   nvisited = 0;
+   for (r=0; r<=rmax; r++) {
+      if (knn.seen >= ncand)
+         break;
+
+      /* Cells in this ring can't be closer than this. */
+      if (r > 0) {
+         bound = MAX( 0., (r-1)*GRID_CELL + edge - grid_slack );
+         if ((knn.n >= k) && (pow2(bound) >= knn.d2[k-1]))
+            break;
+         if ((q->maxdist >= 0.) && (bound > q->maxdist))
+            break;
+      }
+
+      /* Sparse outskirts are cheaper to brute force. */
+      if (grid_ringCells( cx, cy, r ) > nentries - nvisited) {
+         for (i=0; i<nentries; i++) {
+            e = &grid_entries[i];
+            if (MAX( ABS(e->cx-cx), ABS(e->cy-cy) ) >= r)
+               grid_knnVisit( e, &knn );
+         }
+         break;
+      }
+
+      nvisited += grid_visitRing( cx, cy, r, grid_knnVisit, &knn );
+   }
+
+   if ((knn.d2 != dist2) && (knn.d2 != buf))
+      free( knn.d2 );
+   return knn.n;
+}
+
+
+/**
+ * @brief Tries to add an entry to a radius search.
+ */
+static void grid_radiusVisit( const GridEntry *e, void *data )
+{
+   GridRadius *rad;
+   const PilotGridQuery *q;
+   double d2;
+
+   rad = (GridRadius*) data;
+   q   = rad->q;
+
+   if ((e->p == q->ref) || !grid_matches( e ))
+      return;
+
+   d2 = pow2( e->p->solid->pos.x - rad->x ) + pow2( e->p->solid->pos.y - rad->y );
+   if (d2 > rad->r2)
+      return;
+
+   if ((q->filter != NULL) && !q->filter( q->ref, e->p, q->data ))
+      return;
+
+   array_push_back( &rad->out, e->p );
+}
+
+
+/**
+ * @brief Gets all the pilots within a radius of a position.
+ *
+ *    @param q Query to run, maxdist is ignored.
+ *    @param x X position to search from.
+ *    @param y Y position to search from.
+ *    @param r Radius to search in, negative is unlimited.
+ *    @param[out] out Pilots found (array.h). It belongs to the grid and is
+ *                only valid until the next query.
+ *    @return Number of pilots found.
+ */
+int pilot_gridRadius( const PilotGridQuery *q, double x, double y, double r,
+      Pilot ***out )
+{
+   GridRadius rad;
+   int i, cx, cy, x0, x1, y0, y1;
+   double pad;
+
+   if (grid_found == NULL)
+      grid_found = array_create( Pilot* );
+   else
+      array_resize( &grid_found, 0 );
+   *out = grid_found;
+
+   if (grid_dirty)
+      grid_build();
+
+   if (array_size(grid_entries) == 0)
+      return 0;
+
+   rad.q    = q;
+   rad.x    = x;
+   rad.y    = y;
+   rad.r2   = (r < 0.) ? HUGE_VAL : pow2( r );
+   rad.out  = grid_found;
+
+   if (r < 0.) {
+      x0 = grid_xmin;
+      x1 = grid_xmax;
+      y0 = grid_ymin;
+      y1 = grid_ymax;
+   }
+   else {
+      pad = r + grid_slack;
+      x0 = MAX( grid_coord( x-pad ), grid_xmin );
+      x1 = MIN( grid_coord( x+pad ), grid_xmax );
+      y0 = MAX( grid_coord( y-pad ), grid_ymin );
+      y1 = MIN( grid_coord( y+pad ), grid_ymax );
+   }
+   if ((x0 > x1) || (y0 > y1) || (grid_prepare( q ) == 0))
+      return 0;
+
+   /* Large radii cover more cells than there are pilots. */
+   if ((r < 0.) || ((double)(x1-x0+1) * (double)(y1-y0+1) > array_size(grid_entries))) {
+      for (i=0; i<array_size(grid_entries); i++)
+         grid_radiusVisit( &grid_entries[i], &rad );
+   }
+   else {
+      for (cx=x0; cx<=x1; cx++)
+         for (cy=y0; cy<=y1; cy++)
+            grid_visitCell( cx, cy, grid_radiusVisit, &rad );
+   }
+
+   grid_found = rad.out;
+   *out = grid_found;
+   return array_size( grid_found );
+}
+
+
+/**
+ * @brief Parses a relation name ("any", "enemy", "ally" or "neutral").
+ *
+ *    @param str Name of the relation.
+ *    @param[out] rel Parsed relation.
+ *    @return 0 on success.
+ */
+int pilot_gridRelFromString( const char *str, PilotGridRel *rel )
+{
+   if (strcmp(str,"any")==0)
+      *rel = PILOT_GRID_ANY;
+   else if (strcmp(str,"enemy")==0)
+      *rel = PILOT_GRID_ENEMY;
+   else if (strcmp(str,"ally")==0)
+      *rel = PILOT_GRID_ALLY;
+   else if (strcmp(str,"neutral")==0)
+      *rel = PILOT_GRID_NEUTRAL;
+   else
+      return -1;
+   return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * See Licensing and Copyright notice in naev.h
+ */
+
+
+#ifndef PILOT_GRID_H
+#  define PILOT_GRID_H
+
+
+#include "pilot.h"
+
+
+/**
+ * @brief Faction relation a pilot must have with the query faction to match.
+ */
+typedef enum PilotGridRel_ {
+   PILOT_GRID_ANY,      /**< Any pilot regardless of faction. */
+   PILOT_GRID_ENEMY,    /**< Pilots hostile to the query faction. */
+   PILOT_GRID_ALLY,     /**< Pilots of the query faction or allied to it. */
+   PILOT_GRID_NEUTRAL   /**< Pilots that are neither enemies nor allies. */
+} PilotGridRel;
+
+
+/**
+ * @brief Additional filter for spatial queries.
+ *
+ *    @param ref Reference pilot of the query (may be NULL).
+ *    @param p Pilot being tested.
+ *    @param data User data of the query.
+ *    @return 1 if the pilot should be returned, 0 otherwise.
+ */
+typedef int (*PilotGridFilter)( const Pilot *ref, const Pilot *p, void *data );
+
+
+/**
+ * @brief Parameters of a spatial pilot query.
+ */
+typedef struct PilotGridQuery_ {
+   const Pilot *ref; /**< Reference pilot, never returned (may be NULL). */
+   int faction;      /**< Faction relations are computed against. */
+   PilotGridRel rel; /**< Relation matching pilots must have. */
+   double maxdist;   /**< Maximum distance, negative is unlimited. */
+   PilotGridFilter filter; /**< Optional additional filter, run last. */
+   void *data;       /**< User data passed to the filter. */
+} PilotGridQuery;
+
+
+/*
+ * Queries.
+ */
+void pilot_gridQueryInit( PilotGridQuery *q, const Pilot *ref, PilotGridRel rel );
+int pilot_gridNearest( const PilotGridQuery *q, double x, double y,
+      int k, Pilot **out, double *dist2 );
+int pilot_gridRadius( const PilotGridQuery *q, double x, double y, double r,
+      Pilot ***out );
+int pilot_gridRelFromString( const char *str, PilotGridRel *rel );
+
+/*
+ * Maintenance.
+ */
+void pilot_gridInvalidate (void);
+void pilot_gridMoved( double dist );
+void pilot_gridFree (void);
+
+
+#endif /* PILOT_GRID_H */
@@ -129,6 +129,9 @@ void pilot_heatAddSlot( Pilot *p, PilotOutfitSlot *o )
 
    /* Enforce a minimum value as a safety measure. */
    o->heat_T = MAX( o->heat_T, CONST_SPACE_STAR_TEMP );
+
+   /* Must cool down again. */
+   pilot_outfitWake( p, o );
 }
 
 
@@ -141,7 +144,6 @@ void pilot_heatAddSlot( Pilot *p, PilotOutfitSlot *o )
  */
 void pilot_heatAddSlotTime( Pilot *p, PilotOutfitSlot *o, double dt )
 {
-   (void) p;
    double hmod;
 
    /* @todo Handle beam modifiers for ships here. */
@@ -150,6 +152,9 @@ void pilot_heatAddSlotTime( Pilot *p, PilotOutfitSlot *o, double dt )
 
    /* Enforce a minimum value as a safety measure. */
    o->heat_T = MAX( o->heat_T, CONST_SPACE_STAR_TEMP );
+
+   /* Must cool down again. */
+   pilot_outfitWake( p, o );
 }
 
 
@@ -175,6 +180,10 @@ double pilot_heatUpdateSlot( Pilot *p, PilotOutfitSlot *o, double dt )
 {
    double Q;
 
+   /* Nothing flows at equilibrium. */
+   if (o->heat_T == p->heat_T)
+      return 0.;
+
    /* Calculate energy leaving/entering ship chassis. */
    Q           = -p->heat_cond * (o->heat_T - p->heat_T) * o->heat_area * dt;
 
@@ -211,6 +220,10 @@ void pilot_heatUpdateShip( Pilot *p, double Q_cond, double dt )
 {
    double Q, Q_rad;
 
+   /* Cold ship with cold slots, nothing to radiate. */
+   if ((Q_cond == 0.) && (p->heat_T == CONST_SPACE_STAR_TEMP))
+      return;
+
    /* Calculate radiation. */
    Q_rad       = CONST_STEFAN_BOLTZMANN * p->heat_area * p->heat_emis *
          (CONST_SPACE_STAR_TEMP_4 - pow(p->heat_T,4.)) * dt;
@@ -223,6 +236,25 @@ void pilot_heatUpdateShip( Pilot *p, double Q_cond, double dt )
 }
 
 
+/**
+ * @brief Checks to see if a slot is at thermal equilibrium with space.
+ *
+ * The ship only radiates towards space, so a slot is only settled when both
+ *  it and the ship are back at ambient temperature. Such a slot doesn't need
+ *  heat updates until it gets heated again.
+ *
+ *    @param p Pilot whose slot it is.
+ *    @param o Slot to check.
+ *    @return 1 if the slot is at equilibrium.
+ */
+int pilot_heatIsEquilibrium( const Pilot *p, const PilotOutfitSlot *o )
+{
+   if (fabs(p->heat_T - CONST_SPACE_STAR_TEMP) > HEAT_EQUILIBRIUM_DT)
+      return 0;
+   return (fabs(o->heat_T - p->heat_T) <= HEAT_EQUILIBRIUM_DT);
+}
+
+
 /**
  * @brief Returns a 0:1 modifier representing efficiency (1. being normal).
  *
@@ -14,6 +14,7 @@
  * Fundamental heat properties.
  */
 #define HEAT_WORST_ACCURACY         (38./180.*M_PI) /**< Pretty bad accuracy, a 76 degree arc. */
+#define HEAT_EQUILIBRIUM_DT         (0.01) /**< Temperature difference considered to be equilibrium. [K] */
 
 
 /*
@@ -59,6 +60,7 @@ void pilot_heatAddSlotTime( Pilot *p, PilotOutfitSlot *o, double dt );
 double pilot_heatUpdateSlot( Pilot *p, PilotOutfitSlot *o, double dt );
 void pilot_heatUpdateShip( Pilot *p, double Q_cond, double dt );
 void pilot_heatUpdateCooldown( Pilot *p );
+int pilot_heatIsEquilibrium( const Pilot *p, const PilotOutfitSlot *o );
 
 /*
  * Modifiers.
@@ -25,10 +25,19 @@
 #include "outfit.h"
 
 
+#define PILOT_STATS_RESYNC    256 /**< Incremental stat updates between full recalculations. */
+
+
 /*
  * Prototypes.
  */
 static int pilot_hasOutfitLimit( Pilot *p, const char *limit );
+static void pilot_outfitPreloadSounds( const Outfit *o );
+static int pilot_slotContributes( const PilotOutfitSlot *slot );
+static void pilot_calcStatsMod( const Pilot *pilot, PilotStatSums *sums,
+      const Outfit *o, int sign );
+static void pilot_calcStatsSums( Pilot *pilot, PilotStatSums *sums );
+static void pilot_calcStatsApply( Pilot* pilot );
 
 
 /**
@@ -296,6 +305,10 @@ int pilot_addOutfitRaw( Pilot* pilot, Outfit* outfit, PilotOutfitSlot *s )
    /* Set the outfit. */
    s->outfit   = outfit;
 
+   /* Keep track of what the player owns. */
+   if (pilot_isPlayer(pilot))
+      player_modOutfitEquipped( outfit, 1 );
+
    /* Set some default parameters. */
    s->timer    = 0.;
 
@@ -329,10 +342,44 @@ int pilot_addOutfitRaw( Pilot* pilot, Outfit* outfit, PilotOutfitSlot *s )
    /* Update heat. */
    pilot_heatCalcSlot( s );
 
+   /* Have the sounds decoded before the outfit is first used. */
+   pilot_outfitPreloadSounds( o );
+
    return 0;
 }
 
 
+/**
+ * @brief Starts loading the sounds an outfit can play.
+ *
+ *    @param o Outfit to preload sounds of.
+ */
+static void pilot_outfitPreloadSounds( const Outfit *o )
+{
+   const Outfit *amm;
+
+   sound_preload( outfit_sound(o) );
+   sound_preload( outfit_soundHit(o) );
+   if (outfit_isBeam(o)) {
+      sound_preload( o->u.bem.sound_warmup );
+      sound_preload( o->u.bem.sound );
+      sound_preload( o->u.bem.sound_off );
+   }
+   else if (outfit_isAfterburner(o)) {
+      sound_preload( o->u.afb.sound_on );
+      sound_preload( o->u.afb.sound );
+      sound_preload( o->u.afb.sound_off );
+   }
+   else if (outfit_isLauncher(o)) {
+      amm = outfit_ammo(o);
+      if (amm != NULL) {
+         sound_preload( outfit_sound(amm) );
+         sound_preload( outfit_soundHit(amm) );
+      }
+   }
+}
+
+
 /**
  * @brief Tests to see if an outfit can be added.
  *
@@ -419,6 +466,10 @@ int pilot_rmOutfitRaw( Pilot* pilot, PilotOutfitSlot *s )
          pilot->ncannons--;
       if (outfit_isBeam(s->outfit))
          pilot->nbeams--;
+
+      /* Keep track of what the player owns. */
+      if (pilot_isPlayer(pilot))
+         player_modOutfitEquipped( s->outfit, -1 );
    }
 
    /* Remove the outfit. */
@@ -725,6 +776,7 @@ int pilot_addAmmo( Pilot* pilot, PilotOutfitSlot *s, Outfit* ammo, int quantity
    s->u.ammo.quantity  = MIN( max, s->u.ammo.quantity );
    q                   = s->u.ammo.quantity - q; /* Amount actually added. */
    pilot->mass_outfit += q * s->u.ammo.outfit->mass;
+   pilot->stat_sums.mass_outfit += q * s->u.ammo.outfit->mass;
    pilot_updateMass( pilot );
 
    return q;
@@ -763,6 +815,7 @@ int pilot_rmAmmo( Pilot* pilot, PilotOutfitSlot *s, int quantity )
    q                   = MIN( quantity, s->u.ammo.quantity );
    s->u.ammo.quantity -= q;
    pilot->mass_outfit -= q * s->u.ammo.outfit->mass;
+   pilot->stat_sums.mass_outfit -= q * s->u.ammo.outfit->mass;
    pilot_updateMass( pilot );
    /* We don't set the outfit to null so it "remembers" old ammo. */
 
@@ -907,60 +960,101 @@ char* pilot_getOutfits( const Pilot* pilot )
 
 
 /**
- * @brief Recalculates the pilot's stats based on his outfits.
+ * @brief Checks to see if an outfit slot currently contributes to the stats.
  *
- *    @param pilot Pilot to recalculate his stats.
+ *    @param slot Slot to check.
+ *    @return 1 if the outfit is affecting the pilot's stats.
  */
-void pilot_calcStats( Pilot* pilot )
+static int pilot_slotContributes( const PilotOutfitSlot *slot )
+{
+   if (slot->outfit == NULL)
+      return 0;
+   /* Active outfits must be on to affect stuff. */
+   return !slot->active || (slot->state==PILOT_OUTFIT_ON);
+}
+
+
+/**
+ * @brief Adds or removes the part of an outfit that depends on it being on.
+ *
+ *    @param pilot Pilot the outfit belongs to.
+ *    @param sums Sums to modify.
+ *    @param o Outfit to add or remove.
+ *    @param sign 1 to add the outfit, -1 to remove it.
+ */
+static void pilot_calcStatsMod( const Pilot *pilot, PilotStatSums *sums,
+      const Outfit *o, int sign )
+{
+   /* Add stats. */
+   ss_statsSumFromList( &sums->stats, o->stats, &sums->amount, sign );
+
+   if (outfit_isMod(o)) { /* Modification */
+      /* Movement. */
+      sums->thrust         += sign * o->u.mod.thrust;
+      sums->turn           += sign * o->u.mod.turn;
+      sums->speed          += sign * o->u.mod.speed;
+      /* Health. */
+      sums->absorb         += sign * o->u.mod.absorb;
+      sums->armour         += sign * o->u.mod.armour;
+      sums->armour_regen   += sign * o->u.mod.armour_regen;
+      sums->shield         += sign * o->u.mod.shield;
+      sums->shield_regen   += sign * o->u.mod.shield_regen;
+      sums->energy         += sign * o->u.mod.energy;
+      sums->energy_regen   += sign * o->u.mod.energy_regen;
+      sums->energy_loss    += sign * o->u.mod.energy_loss;
+      /* Fuel. */
+      sums->fuel           += sign * o->u.mod.fuel;
+      /* Misc. */
+      sums->cap_cargo      += sign * o->u.mod.cargo;
+      sums->mass_outfit    += sign * o->u.mod.mass_rel * pilot->ship->mass;
+      sums->crew           += sign * o->u.mod.crew_rel * pilot->ship->crew;
+   }
+   else if (outfit_isAfterburner(o)) { /* Afterburner */
+      sums->afterburners   += sign;
+      sums->energy_loss    += sign * o->u.afb.energy; /* energy loss */
+   }
+}
+
+
+/**
+ * @brief Sums up the contributions of all the pilot's outfits from scratch.
+ *
+ *    @param pilot Pilot to sum up the outfits of.
+ *    @param sums Where to store the result.
+ */
+static void pilot_calcStatsSums( Pilot *pilot, PilotStatSums *sums )
 {
    int i;
    Outfit* o;
    PilotOutfitSlot *slot;
-   double ac, sc, ec; /* temporary health coefficients to set */
-   ShipStats amount, *s, *default_s;
 
    /*
     * set up the basic stuff
     */
-   /* mass */
-   pilot->solid->mass   = pilot->ship->mass;
-   pilot->base_mass     = pilot->solid->mass;
-   /* cpu */
-   pilot->cpu           = 0.;
-   /* movement */
-   pilot->thrust_base   = pilot->ship->thrust;
-   pilot->turn_base     = pilot->ship->turn;
-   pilot->speed_base    = pilot->ship->speed;
-   /* crew */
-   pilot->crew          = pilot->ship->crew;
-   /* cargo */
-   pilot->cap_cargo     = pilot->ship->cap_cargo;
-   /* fuel_consumption. */
-   pilot->fuel_consumption = pilot->ship->fuel_consumption;
-   /* health */
-   ac = (pilot->armour_max > 0.) ? pilot->armour / pilot->armour_max : 0.;
-   sc = (pilot->shield_max > 0.) ? pilot->shield / pilot->shield_max : 0.;
-   ec = (pilot->energy_max > 0.) ? pilot->energy / pilot->energy_max : 0.;
-   pilot->armour_max    = pilot->ship->armour;
-   pilot->shield_max    = pilot->ship->shield;
-   pilot->fuel_max      = pilot->ship->fuel;
-   pilot->armour_regen  = pilot->ship->armour_regen;
-   pilot->shield_regen  = pilot->ship->shield_regen;
-   /* Absorption. */
-   pilot->dmg_absorb    = pilot->ship->dmg_absorb;
-   /* Energy. */
-   pilot->energy_max    = pilot->ship->energy;
-   pilot->energy_regen  = pilot->ship->energy_regen;
-   pilot->energy_loss   = 0.; /* Initially no net loss. */
-   /* Stats. */
-   s = &pilot->stats;
-   *s = pilot->ship->stats_array;
-   memset( &amount, 0, sizeof(ShipStats) );
+   sums->base_mass      = pilot->ship->mass;
+   sums->cpu            = 0;
+   sums->thrust         = pilot->ship->thrust;
+   sums->turn           = pilot->ship->turn;
+   sums->speed          = pilot->ship->speed;
+   sums->crew           = pilot->ship->crew;
+   sums->cap_cargo      = pilot->ship->cap_cargo;
+   sums->armour         = pilot->ship->armour;
+   sums->shield         = pilot->ship->shield;
+   sums->fuel           = pilot->ship->fuel;
+   sums->armour_regen   = pilot->ship->armour_regen;
+   sums->shield_regen   = pilot->ship->shield_regen;
+   sums->absorb         = pilot->ship->dmg_absorb;
+   sums->energy         = pilot->ship->energy;
+   sums->energy_regen   = pilot->ship->energy_regen;
+   sums->energy_loss    = 0.; /* Initially no net loss. */
+   sums->afterburners   = 0;
+   sums->stats          = pilot->ship->stats_array;
+   memset( &sums->amount, 0, sizeof(ShipStats) );
 
    /*
     * Now add outfit changes
     */
-   pilot->mass_outfit   = 0.;
+   sums->mass_outfit    = 0.;
    for (i=0; i<pilot->noutfits; i++) {
       slot = pilot->outfits[i];
       o    = slot->outfit;
@@ -970,57 +1064,214 @@ void pilot_calcStats( Pilot* pilot )
          continue;
 
       /* Modify CPU. */
-      pilot->cpu           += outfit_cpu(o);
+      sums->cpu            += outfit_cpu(o);
 
       /* Add mass. */
-      pilot->mass_outfit   += o->mass;
+      sums->mass_outfit    += o->mass;
 
       /* Keep a separate counter for required (core) outfits. */
       if (sp_required( o->slot.spid ))
-         pilot->base_mass += o->mass;
+         sums->base_mass   += o->mass;
 
       /* Add ammo mass. */
       if (outfit_ammo(o) != NULL)
          if (slot->u.ammo.outfit != NULL)
-            pilot->mass_outfit += slot->u.ammo.quantity * slot->u.ammo.outfit->mass;
+            sums->mass_outfit += slot->u.ammo.quantity * slot->u.ammo.outfit->mass;
 
       if (outfit_isAfterburner(o)) /* Afterburner */
          pilot->afterburner = pilot->outfits[i]; /* Set afterburner */
 
-      /* Active outfits must be on to affect stuff. */
-      if (slot->active && !(slot->state==PILOT_OUTFIT_ON))
-         continue;
+      if (pilot_slotContributes( slot ))
+         pilot_calcStatsMod( pilot, sums, o, 1 );
+   }
+}
 
-      /* Add stats. */
-      ss_statsModFromList( s, o->stats, &amount );
-
-      if (outfit_isMod(o)) { /* Modification */
-         /* Movement. */
-         pilot->thrust_base   += o->u.mod.thrust;
-         pilot->turn_base     += o->u.mod.turn;
-         pilot->speed_base    += o->u.mod.speed;
-         /* Health. */
-         pilot->dmg_absorb    += o->u.mod.absorb;
-         pilot->armour_max    += o->u.mod.armour;
-         pilot->armour_regen  += o->u.mod.armour_regen;
-         pilot->shield_max    += o->u.mod.shield;
-         pilot->shield_regen  += o->u.mod.shield_regen;
-         pilot->energy_max    += o->u.mod.energy;
-         pilot->energy_regen  += o->u.mod.energy_regen;
-         pilot->energy_loss   += o->u.mod.energy_loss;
-         /* Fuel. */
-         pilot->fuel_max      += o->u.mod.fuel;
-         /* Misc. */
-         pilot->cap_cargo     += o->u.mod.cargo;
-         pilot->mass_outfit   += o->u.mod.mass_rel * pilot->ship->mass;
-         pilot->crew          += o->u.mod.crew_rel * pilot->ship->crew;
 
-      }
-      else if (outfit_isAfterburner(o)) { /* Afterburner */
-         pilot_setFlag( pilot, PILOT_AFTERBURNER ); /* We use old school flags for this still... */
-         pilot->energy_loss += pilot->afterburner->outfit->u.afb.energy; /* energy loss */
-      }
+/**
+ * @brief Changes the state of an outfit, keeping the stat sums up to date.
+ *
+ * Only the outfit's own contribution is added or removed. Once done changing
+ * outfit states, pilot_calcStatsUpdate() must be called to apply the changes.
+ *
+ *    @param pilot Pilot the outfit belongs to.
+ *    @param slot Slot to change the state of.
+ *    @param state New state of the slot.
+ */
+void pilot_outfitState( Pilot *pilot, PilotOutfitSlot *slot, PilotOutfitState state )
+{
+   int was, now;
+
+   was = pilot_slotContributes( slot );
+   slot->state = state;
+   now = pilot_slotContributes( slot );
+
+   if (was != now)
+      pilot_calcStatsMod( pilot, &pilot->stat_sums, slot->outfit, now ? 1 : -1 );
+
+   /* State timers need ticking. */
+   pilot_outfitWake( pilot, slot );
+}
+
+
+/**
+ * @brief Puts an outfit slot back in the list of slots pilot_update ticks.
+ *
+ * Slots with no timers running at thermal equilibrium are dropped from the
+ *  list, anything that fires them, heats them or changes their state must
+ *  wake them up again.
+ *
+ *    @param pilot Pilot whose slot it is.
+ *    @param o Slot to wake up.
+ */
+void pilot_outfitWake( Pilot *pilot, PilotOutfitSlot *o )
+{
+   if (o->awake || (o->outfit == NULL) || !o->active)
+      return;
+
+   if (pilot->outfit_awake == NULL)
+      pilot->outfit_awake = malloc( pilot->noutfits * sizeof(PilotOutfitSlot*) );
+   pilot->outfit_awake[ pilot->noutfit_awake++ ] = o;
+   o->awake = 1;
+}
+
+
+/**
+ * @brief Rebuilds the list of slots pilot_update ticks with all the active slots.
+ *
+ *    @param pilot Pilot to wake up all the slots of.
+ */
+void pilot_outfitWakeAll( Pilot *pilot )
+{
+   int i;
+
+   pilot->noutfit_awake = 0;
+   pilot->outfit_asleep = 0;
+   for (i=0; i<pilot->noutfits; i++)
+      pilot->outfits[i]->awake = 0;
+   for (i=0; i<pilot->noutfits; i++)
+      pilot_outfitWake( pilot, pilot->outfits[i] );
+}
+
+
+/**
+ * @brief Recalculates the pilot's stats based on his outfits.
+ *
+ *    @param pilot Pilot to recalculate his stats.
+ */
+void pilot_calcStats( Pilot* pilot )
+{
+   pilot_calcStatsSums( pilot, &pilot->stat_sums );
+   pilot->stat_ndelta = 0;
+   pilot_calcStatsApply( pilot );
+
+   /* Outfits may have changed. */
+   pilot_outfitWakeAll( pilot );
+}
+
+
+/**
+ * @brief Updates the pilot's stats after outfits changed state.
+ *
+ * Uses the sums maintained by pilot_outfitState() instead of walking all the
+ * outfits. Every so often a full recalculation is done to get rid of any
+ * floating point drift.
+ *
+ *    @param pilot Pilot to update the stats of.
+ */
+void pilot_calcStatsUpdate( Pilot* pilot )
+{
+#ifdef DEBUGGING
+   PilotStatSums full;
+   double d;
+#endif /* DEBUGGING */
+
+   if (++pilot->stat_ndelta > PILOT_STATS_RESYNC) {
+      pilot_calcStats( pilot );
+      return;
+   }
+
+#ifdef DEBUGGING
+   /* Verify the incremental sums against a full recalculation. */
+   pilot_calcStatsSums( pilot, &full );
+   d = ss_statsDiff( &full.stats, &pilot->stat_sums.stats );
+   d = MAX( d, ss_statsDiff( &full.amount, &pilot->stat_sums.amount ) );
+   d = MAX( d, fabs( full.thrust - pilot->stat_sums.thrust ) );
+   d = MAX( d, fabs( full.turn - pilot->stat_sums.turn ) );
+   d = MAX( d, fabs( full.speed - pilot->stat_sums.speed ) );
+   d = MAX( d, fabs( full.armour - pilot->stat_sums.armour ) );
+   d = MAX( d, fabs( full.shield - pilot->stat_sums.shield ) );
+   d = MAX( d, fabs( full.energy - pilot->stat_sums.energy ) );
+   d = MAX( d, fabs( full.energy_regen - pilot->stat_sums.energy_regen ) );
+   d = MAX( d, fabs( full.energy_loss - pilot->stat_sums.energy_loss ) );
+   d = MAX( d, fabs( full.mass_outfit - pilot->stat_sums.mass_outfit ) );
+   d = MAX( d, fabs( full.cap_cargo - pilot->stat_sums.cap_cargo ) );
+   if ((d > 1e-6) || (full.fuel != pilot->stat_sums.fuel) ||
+         (full.cpu != pilot->stat_sums.cpu) ||
+         (full.afterburners != pilot->stat_sums.afterburners)) {
+      WARN(_("Pilot '%s': incremental stats differ from full recalculation by %g!"),
+            pilot->name, d );
+      pilot->stat_sums = full;
    }
+#endif /* DEBUGGING */
+
+   pilot_calcStatsApply( pilot );
+}
+
+
+/**
+ * @brief Builds the pilot's stats from the outfit sums.
+ *
+ *    @param pilot Pilot to build the stats of.
+ */
+static void pilot_calcStatsApply( Pilot* pilot )
+{
+   double ac, sc, ec; /* temporary health coefficients to set */
+   const PilotStatSums *sums;
+   ShipStats *s, *default_s;
+   const ShipStats *amount;
+
+   sums = &pilot->stat_sums;
+
+   /* health */
+   ac = (pilot->armour_max > 0.) ? pilot->armour / pilot->armour_max : 0.;
+   sc = (pilot->shield_max > 0.) ? pilot->shield / pilot->shield_max : 0.;
+   ec = (pilot->energy_max > 0.) ? pilot->energy / pilot->energy_max : 0.;
+
+   /* mass */
+   pilot->solid->mass   = pilot->ship->mass;
+   pilot->base_mass     = sums->base_mass;
+   pilot->mass_outfit   = sums->mass_outfit;
+   /* cpu */
+   pilot->cpu           = sums->cpu;
+   /* movement */
+   pilot->thrust_base   = sums->thrust;
+   pilot->turn_base     = sums->turn;
+   pilot->speed_base    = sums->speed;
+   /* crew */
+   pilot->crew          = sums->crew;
+   /* cargo */
+   pilot->cap_cargo     = sums->cap_cargo;
+   /* fuel_consumption. */
+   pilot->fuel_consumption = pilot->ship->fuel_consumption;
+   /* health */
+   pilot->armour_max    = sums->armour;
+   pilot->shield_max    = sums->shield;
+   pilot->fuel_max      = sums->fuel;
+   pilot->armour_regen  = sums->armour_regen;
+   pilot->shield_regen  = sums->shield_regen;
+   /* Absorption. */
+   pilot->dmg_absorb    = sums->absorb;
+   /* Energy. */
+   pilot->energy_max    = sums->energy;
+   pilot->energy_regen  = sums->energy_regen;
+   pilot->energy_loss   = sums->energy_loss;
+   /* Stats. */
+   pilot->stats         = sums->stats;
+   ss_statsSumFinish( &pilot->stats );
+   amount               = &sums->amount;
+
+   if (sums->afterburners > 0)
+      pilot_setFlag( pilot, PILOT_AFTERBURNER ); /* We use old school flags for this still... */
 
    if (!pilot_isFlag( pilot, PILOT_AFTERBURNER ))
       pilot->solid->speed_max = pilot->speed;
@@ -1036,23 +1287,23 @@ void pilot_calcStats( Pilot* pilot )
     *  3x 15% -> 33.33%
     *  6x 15% -> 42.51%
     */
-   if (amount.fwd_firerate > 0) {
-      s->fwd_firerate = default_s->fwd_firerate + (s->fwd_firerate-default_s->fwd_firerate) * exp( -0.15 * (double)(MAX(amount.fwd_firerate-1.,0)) );
+   if (amount->fwd_firerate > 0) {
+      s->fwd_firerate = default_s->fwd_firerate + (s->fwd_firerate-default_s->fwd_firerate) * exp( -0.15 * (double)(MAX(amount->fwd_firerate-1.,0)) );
    }
    /* Cruiser. */
-   if (amount.tur_firerate > 0) {
-      s->tur_firerate = default_s->tur_firerate + (s->tur_firerate-default_s->tur_firerate) * exp( -0.15 * (double)(MAX(amount.tur_firerate-1.,0)) );
+   if (amount->tur_firerate > 0) {
+      s->tur_firerate = default_s->tur_firerate + (s->tur_firerate-default_s->tur_firerate) * exp( -0.15 * (double)(MAX(amount->tur_firerate-1.,0)) );
    }
    /* Launchers. */
-   if (amount.launch_rate > 0) {
-      s->launch_rate = default_s->launch_rate + (s->launch_rate-default_s->launch_rate) * exp( -0.15 * (double)(MAX(amount.launch_rate-1.,0)) );
+   if (amount->launch_rate > 0) {
+      s->launch_rate = default_s->launch_rate + (s->launch_rate-default_s->launch_rate) * exp( -0.15 * (double)(MAX(amount->launch_rate-1.,0)) );
    }
    /*
     * Electronic warfare setting base parameters.
     */
-   s->ew_hide           = default_s->ew_hide + (s->ew_hide-default_s->ew_hide)                      * exp( -0.2 * (double)(MAX(amount.ew_hide-1.,0)) );
-   s->ew_detect         = default_s->ew_detect + (s->ew_detect-default_s->ew_detect)                * exp( -0.2 * (double)(MAX(amount.ew_detect-1.,0)) );
-   s->ew_jump_detect    = default_s->ew_jump_detect + (s->ew_jump_detect-default_s->ew_jump_detect) * exp( -0.2 * (double)(MAX(amount.ew_jump_detect-1.,0)) );
+   s->ew_hide           = default_s->ew_hide + (s->ew_hide-default_s->ew_hide)                      * exp( -0.2 * (double)(MAX(amount->ew_hide-1.,0)) );
+   s->ew_detect         = default_s->ew_detect + (s->ew_detect-default_s->ew_detect)                * exp( -0.2 * (double)(MAX(amount->ew_detect-1.,0)) );
+   s->ew_jump_detect    = default_s->ew_jump_detect + (s->ew_jump_detect-default_s->ew_jump_detect) * exp( -0.2 * (double)(MAX(amount->ew_jump_detect-1.,0)) );
 
    /* Square the internal values to speed up comparisons. */
    pilot->ew_base_hide   = pow2( s->ew_hide );
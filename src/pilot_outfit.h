@@ -41,6 +41,10 @@ void pilot_lockClear( Pilot *p );
 /* Other. */
 char* pilot_getOutfits( const Pilot *pilot );
 void pilot_calcStats( Pilot *pilot );
+void pilot_calcStatsUpdate( Pilot *pilot );
+void pilot_outfitState( Pilot *pilot, PilotOutfitSlot *slot, PilotOutfitState state );
+void pilot_outfitWake( Pilot *pilot, PilotOutfitSlot *o );
+void pilot_outfitWakeAll( Pilot *pilot );
 void pilot_updateMass( Pilot *pilot );
 void pilot_healLanded( Pilot *pilot );
 
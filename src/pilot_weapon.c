@@ -237,15 +237,15 @@ void pilot_weapSetPress( Pilot* p, int id, int type )
                if (outfit_isAfterburner(ws->slots[i].slot->outfit))
                   pilot_afterburn( p );
                else {
-                  ws->slots[i].slot->state  = PILOT_OUTFIT_ON;
+                  pilot_outfitState( p, ws->slots[i].slot, PILOT_OUTFIT_ON );
                   ws->slots[i].slot->stimer = outfit_duration( ws->slots[i].slot->outfit );
                }
                n++;
             }
          }
-         /* Must recalculate stats. */
+         /* Must update stats. */
          if (n > 0)
-            pilot_calcStats( p );
+            pilot_calcStatsUpdate( p );
 
          break;
    }
@@ -809,7 +809,7 @@ void pilot_shootStop( Pilot* p, int level )
       if (!outfit_isBeam(slot->outfit)) {
          /* Turn off the state. */
          if (outfit_isMod( slot->outfit )) {
-            slot->state = PILOT_OUTFIT_OFF;
+            pilot_outfitState( p, slot, PILOT_OUTFIT_OFF );
             recalc = 1;
          }
          continue;
@@ -832,9 +832,9 @@ void pilot_shootStop( Pilot* p, int level )
       }
    }
 
-   /* Must recalculate. */
+   /* Must update stats. */
    if (recalc)
-      pilot_calcStats( p );
+      pilot_calcStatsUpdate( p );
 }
 
 
@@ -866,6 +866,7 @@ void pilot_stopBeam( Pilot *p, PilotOutfitSlot *w )
 
    w->timer = rate_mod * (used / w->outfit->u.bem.duration) * outfit_delay( w->outfit );
    w->u.beamid = 0;
+   pilot_outfitWake( p, w );
 }
 
 
@@ -917,16 +918,16 @@ double pilot_weapFlyTime( Outfit *o, Pilot *parent, Vector2d *pos, Vector2d *vel
    orthoradial_speed = vect_dot(&approach_vector, &orthoradial_vector);
    orthoradial_speed = orthoradial_speed / VMOD(relative_location);
 
-   if ( ((speed*speed - VMOD(approach_vector)*VMOD(approach_vector)) != 0) && (speed*speed - orthoradial_speed*orthoradial_speed) > 0)
+   if ( ((speed*speed - vect_odist2(&approach_vector)) != 0) && (speed*speed - orthoradial_speed*orthoradial_speed) > 0)
       t = dist * (sqrt( speed*speed - orthoradial_speed*orthoradial_speed ) - radial_speed) /
-            (speed*speed - VMOD(approach_vector)*VMOD(approach_vector));
+            (speed*speed - vect_odist2(&approach_vector));
    else
       return INFINITY;
 
    /* if t < 0, try the other solution */
    if (t < 0)
       t = - dist * (sqrt( speed*speed - orthoradial_speed*orthoradial_speed ) + radial_speed) /
-            (speed*speed - VMOD(approach_vector)*VMOD(approach_vector));
+            (speed*speed - vect_odist2(&approach_vector));
 
    /* if t still < 0, no solution */
    if (t < 0)
@@ -1044,8 +1045,10 @@ static int pilot_shootWeapon( Pilot* p, PilotOutfitSlot* w, double time )
       return 0;
 
    /* Reset beam shut-off if needed. */
-   if (outfit_isBeam(w->outfit) && w->outfit->u.bem.min_duration)
+   if (outfit_isBeam(w->outfit) && w->outfit->u.bem.min_duration) {
       w->stimer = INFINITY;
+      pilot_outfitWake( p, w );
+   }
 
    /* check to see if weapon is ready */
    if (w->timer > 0.)
@@ -1092,7 +1095,7 @@ static int pilot_shootWeapon( Pilot* p, PilotOutfitSlot* w, double time )
          return 0;
 
       /** @todo Handle warmup stage. */
-      w->state = PILOT_OUTFIT_ON;
+      pilot_outfitState( p, w, PILOT_OUTFIT_ON );
       w->u.beamid = beam_start( w->outfit, p->solid->dir,
             &vp, &p->solid->vel, p, p->target, w );
 
@@ -1128,6 +1131,7 @@ static int pilot_shootWeapon( Pilot* p, PilotOutfitSlot* w, double time )
 
       w->u.ammo.quantity -= 1; /* we just shot it */
       p->mass_outfit     -= w->u.ammo.outfit->mass;
+      p->stat_sums.mass_outfit -= w->u.ammo.outfit->mass;
       p->solid->mass     -= w->u.ammo.outfit->mass;
 
       pilot_updateMass( p );
@@ -1164,6 +1168,7 @@ static int pilot_shootWeapon( Pilot* p, PilotOutfitSlot* w, double time )
 
       w->u.ammo.quantity -= 1; /* we just shot it */
       p->mass_outfit     -= w->u.ammo.outfit->mass;
+      p->stat_sums.mass_outfit -= w->u.ammo.outfit->mass;
       pilot_updateMass( p );
    }
    else
@@ -1172,6 +1177,7 @@ static int pilot_shootWeapon( Pilot* p, PilotOutfitSlot* w, double time )
 
    /* Reset timer. */
    w->timer += rate_mod * outfit_delay( w->outfit );
+   pilot_outfitWake( p, w );
 
    return 1;
 }
@@ -1415,7 +1421,7 @@ int pilot_outfitOff( Pilot *p, PilotOutfitSlot *o )
    }
    else {
       o->stimer = outfit_cooldown( o->outfit );
-      o->state  = PILOT_OUTFIT_COOLDOWN;
+      pilot_outfitState( p, o, PILOT_OUTFIT_COOLDOWN );
    }
 
    return 1;
@@ -1477,10 +1483,10 @@ void pilot_afterburn (Pilot *p)
       return;
 
    if (p->afterburner->state == PILOT_OUTFIT_OFF) {
-      p->afterburner->state  = PILOT_OUTFIT_ON;
+      pilot_outfitState( p, p->afterburner, PILOT_OUTFIT_ON );
       p->afterburner->stimer = outfit_duration( p->afterburner->outfit );
       pilot_setFlag(p,PILOT_AFTERBURNER);
-      pilot_calcStats( p );
+      pilot_calcStatsUpdate( p );
 
       /* @todo Make this part of a more dynamic activated outfit sound system. */
       sound_playPos(p->afterburner->outfit->u.afb.sound_on,
@@ -1505,9 +1511,9 @@ void pilot_afterburnOver (Pilot *p)
       return;
 
    if (p->afterburner->state == PILOT_OUTFIT_ON) {
-      p->afterburner->state  = PILOT_OUTFIT_OFF;
+      pilot_outfitState( p, p->afterburner, PILOT_OUTFIT_OFF );
       pilot_rmFlag(p,PILOT_AFTERBURNER);
-      pilot_calcStats( p );
+      pilot_calcStatsUpdate( p );
 
       /* @todo Make this part of a more dynamic activated outfit sound system. */
       sound_playPos(p->afterburner->outfit->u.afb.sound_off,
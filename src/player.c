@@ -114,6 +114,16 @@ static int player_noutfits             = 0;     /**< Number of outfits player ha
 static int player_moutfits             = 0;     /**< Current allocated memory. */
 #define OUTFIT_CHUNKSIZE               32       /**< Allocation chunk size. */
 
+/**
+ * @brief How many of an outfit the player owns, indexed by outfit.
+ */
+typedef struct PlayerOutfitCount_ {
+   int stored;    /**< Amount in the player's outfit stack. */
+   int equipped;  /**< Amount equipped on the player's ships. */
+} PlayerOutfitCount;
+static PlayerOutfitCount *player_outfitCounts = NULL; /**< Owned counts by outfit index. */
+static int player_noutfitCounts = 0; /**< Number of owned counts allocated. */
+
 
 /*
  * player global properties
@@ -564,6 +574,7 @@ void player_swapShip( char* shipname )
          if (pilot_stack[j] == player.p) {
             player.p         = ship;
             pilot_stack[j] = ship;
+            pilot_gridInvalidate();
             break;
          }
 
@@ -724,6 +735,10 @@ void player_cleanup (void)
    player_noutfits = 0;
    player_moutfits = 0;
 
+   /* Stored outfits are gone, equipped counts go away as the ships are freed. */
+   for (i=0; i<player_noutfitCounts; i++)
+      player_outfitCounts[i].stored = 0;
+
    /* Clean up missions */
    if (missions_done != NULL)
       free(missions_done);
@@ -879,6 +894,7 @@ void player_soundResume (void)
 void player_warp( const double x, const double y )
 {
    vect_cset( &player.p->solid->pos, x, y );
+   pilot_gridInvalidate();
 }
 
 
@@ -2499,6 +2515,116 @@ Pilot* player_getShip( char* shipname )
 }
 
 
+/**
+ * @brief Gets the owned count entry of an outfit.
+ *
+ *    @param o Outfit to get entry of.
+ *    @param create Whether to allocate the entry if it doesn't exist.
+ *    @return The entry or NULL if it doesn't exist and create is 0.
+ */
+static PlayerOutfitCount* player_outfitCount( const Outfit *o, int create )
+{
+   int id, n;
+   Outfit *outfits;
+
+   outfits = outfit_getAll( &n );
+   id = o - outfits;
+   if ((id < 0) || (id >= n)) {
+      WARN(_("Outfit '%s' is not in the outfit stack!"), o->name);
+      return NULL;
+   }
+
+   if (id >= player_noutfitCounts) {
+      if (!create)
+         return NULL;
+      player_outfitCounts = realloc( player_outfitCounts,
+            sizeof(PlayerOutfitCount) * n );
+      memset( &player_outfitCounts[ player_noutfitCounts ], 0,
+            sizeof(PlayerOutfitCount) * (n - player_noutfitCounts) );
+      player_noutfitCounts = n;
+   }
+
+   return &player_outfitCounts[ id ];
+}
+
+
+/**
+ * @brief Modifies the amount of an outfit equipped on the player's ships.
+ *
+ * Called whenever an outfit is added to or removed from a player pilot.
+ *
+ *    @param o Outfit being equipped or unequipped.
+ *    @param q Amount to modify by.
+ */
+void player_modOutfitEquipped( const Outfit *o, int q )
+{
+   PlayerOutfitCount *c;
+
+   c = player_outfitCount( o, q > 0 );
+   if (c == NULL)
+      return;
+   c->equipped += q;
+}
+
+
+/**
+ * @brief Adds or removes all the outfits equipped on a player pilot.
+ *
+ * Used when a pilot becomes or stops being one of the player's ships.
+ *
+ *    @param p Player pilot.
+ *    @param mod 1 to add the outfits, -1 to remove them.
+ */
+void player_modPilotOutfits( const Pilot *p, int mod )
+{
+   int i;
+
+   for (i=0; i<p->noutfits; i++)
+      if (p->outfits[i]->outfit != NULL)
+         player_modOutfitEquipped( p->outfits[i]->outfit, mod );
+}
+
+
+#ifdef DEBUGGING
+/**
+ * @brief Checks the owned outfit counts against a full recount.
+ *
+ *    @return 0 if they are consistent, -1 otherwise.
+ */
+int player_outfitCountsCheck (void)
+{
+   int i, j, n, stored, equipped, ret;
+   Outfit *outfits;
+   PlayerOutfitCount *c;
+
+   ret = 0;
+   outfits = outfit_getAll( &n );
+   for (i=0; i<n; i++) {
+      stored = 0;
+      for (j=0; j<player_noutfits; j++)
+         if (player_outfits[j].o == &outfits[i])
+            stored = player_outfits[j].q;
+      equipped = 0;
+      if (player.p != NULL)
+         equipped += pilot_numOutfit( player.p, &outfits[i] );
+      for (j=0; j<player_nstack; j++)
+         equipped += pilot_numOutfit( player_stack[j].p, &outfits[i] );
+
+      c = (i < player_noutfitCounts) ? &player_outfitCounts[i] : NULL;
+      if ((c == NULL) ? ((stored != 0) || (equipped != 0)) :
+            ((c->stored != stored) || (c->equipped != equipped))) {
+         WARN(_("Outfit '%s' owned counts are inconsistent: %d stored and %d equipped, expected %d and %d."),
+               outfits[i].name, (c==NULL) ? 0 : c->stored,
+               (c==NULL) ? 0 : c->equipped, stored, equipped );
+         ret = -1;
+      }
+   }
+
+   return ret;
+}
+#endif /* DEBUGGING */
+
+
 /**
  * @brief Gets how many of the outfit the player owns.
  *
@@ -2507,7 +2633,7 @@ Pilot* player_getShip( char* shipname )
  */
 int player_outfitOwned( const Outfit* o )
 {
-   int i;
+   PlayerOutfitCount *c;
 
    /* Special case map. */
    if ((outfit_isMap(o) && map_isMapped(o)) ||
@@ -2524,12 +2650,9 @@ int player_outfitOwned( const Outfit* o )
          player_guiCheck(o->u.gui.gui))
       return 1;
 
-   /* Try to find it. */
-   for (i=0; i<player_noutfits; i++)
-      if (player_outfits[i].o == o)
-         return player_outfits[i].q;
-
-   return 0;
+   /* Look it up. */
+   c = player_outfitCount( o, 0 );
+   return (c == NULL) ? 0 : c->stored;
 }
 
 
@@ -2538,15 +2661,10 @@ int player_outfitOwned( const Outfit* o )
  */
 int player_outfitOwnedTotal( const Outfit* o )
 {
-   int i, q;
+   PlayerOutfitCount *c;
 
-   q  = player_outfitOwned(o);
-
-   q += pilot_numOutfit( player.p, o );
-   for (i=0; i<player_nstack; i++)
-      q += pilot_numOutfit( player_stack[i].p, o );
-
-   return q;
+   c = player_outfitCount( o, 0 );
+   return player_outfitOwned(o) + ((c == NULL) ? 0 : c->equipped);
 }
 
 
@@ -2627,6 +2745,7 @@ int player_numOutfits (void)
 int player_addOutfit( const Outfit *o, int quantity )
 {
    int i;
+   PlayerOutfitCount *c;
 
    /* Validity check. */
    if (quantity == 0)
@@ -2652,6 +2771,11 @@ int player_addOutfit( const Outfit *o, int quantity )
       return 1; /* Success. */
    }
 
+   /* Update owned count. */
+   c = player_outfitCount( o, 1 );
+   if (c != NULL)
+      c->stored += quantity;
+
    /* Try to find it. */
    for (i=0; i<player_noutfits; i++) {
       if (player_outfits[i].o == o) {
@@ -2688,6 +2812,7 @@ int player_addOutfit( const Outfit *o, int quantity )
 int player_rmOutfit( const Outfit *o, int quantity )
 {
    int i, q;
+   PlayerOutfitCount *c;
 
    /* Try to find it. */
    for (i=0; i<player_noutfits; i++) {
@@ -2696,6 +2821,11 @@ int player_rmOutfit( const Outfit *o, int quantity )
          q = MIN( player_outfits[i].q, quantity );
          player_outfits[i].q -= q;
 
+         /* Update owned count. */
+         c = player_outfitCount( o, 0 );
+         if (c != NULL)
+            c->stored -= q;
+
          /* See if must remove element. */
          if (player_outfits[i].q <= 0) {
             player_noutfits--;
@@ -194,6 +194,11 @@ int player_getOutfitsFiltered( Outfit **outfits,
 int player_numOutfits (void);
 int player_addOutfit( const Outfit *o, int quantity );
 int player_rmOutfit( const Outfit *o, int quantity );
+void player_modOutfitEquipped( const Outfit *o, int q );
+void player_modPilotOutfits( const Pilot *p, int mod );
+#ifdef DEBUGGING
+int player_outfitCountsCheck (void);
+#endif /* DEBUGGING */
 
 
 /*
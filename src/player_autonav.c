@@ -472,7 +472,7 @@ static void player_autonavFollow( const Vector2d *pos, const Vector2d *vel, cons
    /* Find a point behind the target at a distance of radius unless stationary, or not following */
    if ( !follow || ( vel->x == 0 && vel->y == 0 ) )
       radius = 0;
-   angle = M_PI + vel->angle;
+   angle = M_PI + VANGLE(*vel);
    vect_cset( &point, pos->x + radius * cos(angle),
               pos->y + radius * sin(angle) );
 
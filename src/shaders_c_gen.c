@@ -67,6 +67,20 @@ const Shader shaders[] = {
       .attributes = {"vertex", "brightness"},
       .uniforms = {"projection", "star_xy", "wh", "xy"}
    },
+   {
+      .name = "spfx",
+      .vs_path = "spfx.vert",
+      .fs_path = "spfx.frag",
+      .attributes = {"vertex"},
+      .uniforms = {"projection", "dims", "sprites", "tex_dims", "offset", "instances"}
+   },
+   {
+      .name = "map_shape",
+      .vs_path = "map_shape.vert",
+      .fs_path = "map_shape.frag",
+      .attributes = {"vertex", "vertex_color", "shape"},
+      .uniforms = {"projection", "zoom", "radius", "alpha"}
+   },
    {
       .name = "font",
       .vs_path = "font.vert",
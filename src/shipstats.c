@@ -349,6 +349,160 @@ int ss_statsModFromList( ShipStats *stats, const ShipStatList* list, const ShipS
 }
 
 
+/**
+ * @brief Adds or removes a stat list from a running stat sum.
+ *
+ * Unlike ss_statsModFromList() nothing is clamped and booleans are counted
+ * instead of set, so removing a list exactly undoes having added it. The
+ * result must be passed through ss_statsSumFinish() before being used.
+ *
+ *    @param stats Running stat sum to modify.
+ *    @param list List to add or remove.
+ *    @param amount If non nil keeps track of the number of positive elements.
+ *    @param sign 1 to add the list, -1 to remove it.
+ *    @return 0 on success.
+ */
+int ss_statsSumFromList( ShipStats *stats, const ShipStatList* list, ShipStats *amount, int sign )
+{
+   char *ptr, *aptr;
+   char *fieldptr;
+   double *dbl;
+   int *i;
+   const ShipStatList *ll;
+   const ShipStatsLookup *sl;
+
+   ptr  = (char*) stats;
+   aptr = (char*) amount;
+   for (ll = list; ll != NULL; ll = ll->next) {
+      sl = &ss_lookup[ ll->type ];
+      switch (sl->data) {
+         case SS_DATA_TYPE_DOUBLE:
+         case SS_DATA_TYPE_DOUBLE_ABSOLUTE:
+            fieldptr = &ptr[ sl->offset ];
+            memcpy(&dbl, &fieldptr, sizeof(double*));
+            *dbl += sign * ll->d.d;
+            if ((aptr != NULL) && ((sl->inverted && (ll->d.d < 0.)) ||
+                     (!sl->inverted && (ll->d.d > 0.)))) {
+               fieldptr = &aptr[ sl->offset ];
+               memcpy(&dbl, &fieldptr, sizeof(double*));
+               *dbl += sign;
+            }
+            break;
+
+         case SS_DATA_TYPE_INTEGER:
+            fieldptr = &ptr[ sl->offset ];
+            memcpy(&i, &fieldptr, sizeof(int*));
+            *i += sign * ll->d.i;
+            if ((aptr != NULL) && ((sl->inverted && (ll->d.i < 0)) ||
+                     (!sl->inverted && (ll->d.i > 0)))) {
+               fieldptr = &aptr[ sl->offset ];
+               memcpy(&i, &fieldptr, sizeof(int*));
+               *i += sign;
+            }
+            break;
+
+         case SS_DATA_TYPE_BOOLEAN:
+            /* Count how many elements set it so it can be unset again. */
+            fieldptr = &ptr[ sl->offset ];
+            memcpy(&i, &fieldptr, sizeof(int*));
+            *i += sign;
+            break;
+      }
+   }
+
+   return 0;
+}
+
+
+/**
+ * @brief Turns a running stat sum into usable stats.
+ *
+ * Clamps relative values so they don't go negative and turns boolean counts
+ * back into flags.
+ *
+ *    @param stats Stat sum to finish, modified in place.
+ *    @return 0 on success.
+ */
+int ss_statsSumFinish( ShipStats *stats )
+{
+   int j;
+   char *ptr;
+   char *fieldptr;
+   double *dbl;
+   int *i;
+   const ShipStatsLookup *sl;
+
+   ptr = (char*) stats;
+   for (j=0; j<SS_TYPE_SENTINEL; j++) {
+      sl = &ss_lookup[ j ];
+      if (sl->name == NULL)
+         continue;
+
+      switch (sl->data) {
+         case SS_DATA_TYPE_DOUBLE:
+            fieldptr = &ptr[ sl->offset ];
+            memcpy(&dbl, &fieldptr, sizeof(double*));
+            if (*dbl < 0.)
+               *dbl = 0.;
+            break;
+
+         case SS_DATA_TYPE_BOOLEAN:
+            fieldptr = &ptr[ sl->offset ];
+            memcpy(&i, &fieldptr, sizeof(int*));
+            *i = (*i > 0);
+            break;
+
+         case SS_DATA_TYPE_DOUBLE_ABSOLUTE:
+         case SS_DATA_TYPE_INTEGER:
+            break;
+      }
+   }
+
+   return 0;
+}
+
+
+/**
+ * @brief Gets the largest difference between two stat structures.
+ *
+ *    @param a First stats to compare.
+ *    @param b Second stats to compare.
+ *    @return The largest absolute difference of any field.
+ */
+double ss_statsDiff( const ShipStats *a, const ShipStats *b )
+{
+   int j;
+   double d, da, db;
+   int ia, ib;
+   const ShipStatsLookup *sl;
+
+   d = 0.;
+   for (j=0; j<SS_TYPE_SENTINEL; j++) {
+      sl = &ss_lookup[ j ];
+      if (sl->name == NULL)
+         continue;
+
+      switch (sl->data) {
+         case SS_DATA_TYPE_DOUBLE:
+         case SS_DATA_TYPE_DOUBLE_ABSOLUTE:
+            memcpy( &da, &((const char*)a)[ sl->offset ], sizeof(double) );
+            memcpy( &db, &((const char*)b)[ sl->offset ], sizeof(double) );
+            d = MAX( d, fabs(da-db) );
+            break;
+
+         case SS_DATA_TYPE_INTEGER:
+         case SS_DATA_TYPE_BOOLEAN:
+            memcpy( &ia, &((const char*)a)[ sl->offset ], sizeof(int) );
+            memcpy( &ib, &((const char*)b)[ sl->offset ], sizeof(int) );
+            d = MAX( d, fabs((double)(ia-ib)) );
+            break;
+      }
+   }
+
+   return d;
+}
+
+
 /**
  * @brief Gets the name from type.
  *
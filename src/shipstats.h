@@ -246,6 +246,9 @@ void ss_free( ShipStatList *ll );
 int ss_statsInit( ShipStats *stats );
 int ss_statsModSingle( ShipStats *stats, const ShipStatList* list, const ShipStats *amount );
 int ss_statsModFromList( ShipStats *stats, const ShipStatList* list, const ShipStats *amount );
+int ss_statsSumFromList( ShipStats *stats, const ShipStatList* list, ShipStats *amount, int sign );
+int ss_statsSumFinish( ShipStats *stats );
+double ss_statsDiff( const ShipStats *a, const ShipStats *b );
 
 /*
  * Lookup.
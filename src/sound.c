@@ -30,14 +30,25 @@
 #include "conf.h"
 #include "player.h"
 #include "camera.h"
+#include "threadpool.h"
 
 
 #define SOUND_SUFFIX_WAV   ".wav" /**< Suffix of sounds. */
 #define SOUND_SUFFIX_OGG   ".ogg" /**< Suffix of sounds. */
 
 
+/*
+ * Positional sound scheduling, gains follow the OpenAL inverse clamped model.
+ */
+#define SOUND_REF_DIST     500. /**< Distance under which sounds are at full gain. */
+#define SOUND_CULL_GAIN    0.05 /**< Estimated gain under which sounds are not played. */
+#define SOUND_MAX_SAME     6 /**< Maximum voices playing the same sound. */
+
+
 #define voiceLock()        SDL_LockMutex(voice_mutex)
 #define voiceUnlock()      SDL_UnlockMutex(voice_mutex)
+#define cacheLock()        SDL_LockMutex(cache_mutex)
+#define cacheUnlock()      SDL_UnlockMutex(cache_mutex)
 
 
 /*
@@ -52,17 +63,28 @@ static int sound_initialized  = 0; /**< Whether or not sound is initialized. */
  */
 static alSound *sound_list    = NULL; /**< List of available sounds. */
 static int sound_nlist        = 0; /**< Number of available sounds. */
+static size_t sound_mem       = 0; /**< Memory used by loaded sound buffers. */
+static int sound_nloaded      = 0; /**< Number of loaded sound buffers. */
+static SDL_mutex *cache_mutex = NULL; /**< Lock for the loading state of sounds. */
 
 
 /*
  * Voices.
  */
-static int voice_genid        = 0; /**< Voice identifier generator. */
 alVoice *voice_active         = NULL; /**< Active voices. */
+static alVoice **voice_slots  = NULL; /**< All the voices indexed by slot. */
+static int voice_nslots       = 0; /**< Number of voice slots. */
 static alVoice *voice_pool    = NULL; /**< Pool of free voices. */
 static SDL_mutex *voice_mutex = NULL; /**< Lock for voices. */
 
 
+/*
+ * Positional sound culling.
+ */
+static double sound_listener[2] = { 0., 0. }; /**< Position of the listener. */
+static SoundStats sound_stats; /**< Positional sound counters. */
+
+
 /*
  * Internally used sounds.
  */
@@ -121,6 +143,12 @@ int  (*sound_sys_env) ( SoundEnv_t env, double param ) = NULL;
 static int sound_makeList (void);
 static int sound_load( alSound *snd, const char *filename );
 static void sound_free( alSound *snd );
+static int sound_ready( int sound, int block );
+static int sound_loadThread( void *data );
+static void sound_cacheTrim (void);
+static double sound_gain( double px, double py );
+static alVoice* sound_quietest( int sound, double gain, int *nplaying );
+static void sound_steal( alVoice *v );
 /* Voices. */
 
 
@@ -254,6 +282,11 @@ int sound_init (void)
    if (voice_mutex == NULL)
       WARN(_("Unable to create voice mutex."));
 
+   /* Create sound cache lock. */
+   cache_mutex = SDL_CreateMutex();
+   if (cache_mutex == NULL)
+      WARN(_("Unable to create sound cache mutex."));
+
    /* Load available sounds. */
    ret = sound_makeList();
    if (ret != 0)
@@ -314,6 +347,9 @@ void sound_exit (void)
          voice_pool = v->next;
          free(v);
       }
+      free(voice_slots);
+      voice_slots  = NULL;
+      voice_nslots = 0;
       voiceUnlock();
 
       /* Destroy voice lock. */
@@ -321,12 +357,27 @@ void sound_exit (void)
       voice_mutex = NULL;
    }
 
+   /* Wait for pending loads, they write into the sound list. */
+   for (i=0; i<sound_nlist; i++) {
+      cacheLock();
+      while (sound_list[i].state == SOUND_LOADING) {
+         cacheUnlock();
+         SDL_Delay( 1 );
+         cacheLock();
+      }
+      cacheUnlock();
+   }
+
    /* free the sounds */
    for (i=0; i<sound_nlist; i++)
       sound_free( &sound_list[i] );
    free( sound_list );
    sound_list = NULL;
    sound_nlist = 0;
+   sound_mem = 0;
+   sound_nloaded = 0;
+   SDL_DestroyMutex( cache_mutex );
+   cache_mutex = NULL;
 
    /* Exit sound subsystem. */
    sound_sys_exit();
@@ -369,10 +420,159 @@ double sound_length( int sound )
    if (sound_disabled)
       return 0.;
 
+   /* Length is only known once loaded. */
+   if (sound_ready( sound, 1 ))
+      return 0.;
+
    return sound_list[sound].length;
 }
 
 
+/**
+ * @brief Makes sure a sound buffer is loaded.
+ *
+ *    @param sound Sound to check.
+ *    @param block Whether to decode it right away instead of on a worker thread.
+ *    @return 0 if the sound is ready to be played.
+ */
+static int sound_ready( int sound, int block )
+{
+   alSound *s;
+   sound_state_t state;
+
+   if ((sound < 0) || (sound >= sound_nlist))
+      return -1;
+   s = &sound_list[sound];
+
+   cacheLock();
+   state = s->state;
+   if (state == SOUND_UNLOADED) {
+      s->state = SOUND_LOADING;
+      cacheUnlock();
+      if (block)
+         sound_loadThread( (void*)(intptr_t)sound );
+      else if (threadpool_newJob( sound_loadThread, (void*)(intptr_t)sound ))
+         sound_loadThread( (void*)(intptr_t)sound );
+      cacheLock();
+   }
+   else if (block) {
+      /* Another thread is already on it. */
+      while (s->state == SOUND_LOADING) {
+         cacheUnlock();
+         SDL_Delay( 1 );
+         cacheLock();
+      }
+   }
+   state = s->state;
+   cacheUnlock();
+
+   if (state != SOUND_LOADED)
+      return -1;
+   s->used = SDL_GetTicks();
+   return 0;
+}
+
+
+/**
+ * @brief Decodes a sound buffer, may be run on a worker thread.
+ *
+ *    @param data Index of the sound to load.
+ *    @return 0 on success.
+ */
+static int sound_loadThread( void *data )
+{
+   int ret;
+   alSound *s, tmp;
+
+   s   = &sound_list[ (intptr_t)data ];
+   tmp = *s;
+   ret = sound_load( &tmp, s->path );
+
+   cacheLock();
+   if (ret == 0) {
+      s->u      = tmp.u;
+      s->length = tmp.length;
+      s->mem    = tmp.mem;
+      s->state  = SOUND_LOADED;
+      sound_mem += s->mem;
+      sound_nloaded++;
+   }
+   else
+      s->state  = SOUND_FAILED;
+   cacheUnlock();
+
+   return ret;
+}
+
+
+/**
+ * @brief Starts loading a sound in the background so it is ready when needed.
+ *
+ *    @param sound Sound to preload, negative values are ignored.
+ */
+void sound_preload( int sound )
+{
+   if (sound_disabled || (sound < 0))
+      return;
+
+   sound_ready( sound, 0 );
+}
+
+
+/**
+ * @brief Evicts the least recently used idle sounds until under the budget.
+ */
+static void sound_cacheTrim (void)
+{
+   int i, lru;
+   size_t budget;
+   alSound *s;
+
+   if (conf.snd_cache <= 0)
+      return;
+   budget = (size_t)conf.snd_cache * 1024 * 1024;
+
+   while (sound_mem > budget) {
+      /* Only sounds nothing is playing can go. */
+      lru = -1;
+      cacheLock();
+      for (i=0; i<sound_nlist; i++) {
+         s = &sound_list[i];
+         if ((s->state != SOUND_LOADED) || s->pinned || (s->nvoices > 0))
+            continue;
+         if ((lru < 0) || (s->used < sound_list[lru].used))
+            lru = i;
+      }
+      if (lru < 0) {
+         cacheUnlock();
+         return;
+      }
+      s = &sound_list[lru];
+      s->state = SOUND_UNLOADED;
+      sound_mem -= s->mem;
+      sound_nloaded--;
+      cacheUnlock();
+
+      sound_sys_free( s );
+      s->mem = 0;
+   }
+}
+
+
+/**
+ * @brief Gets the memory used by the loaded sound buffers.
+ *
+ *    @param[out] nloaded Number of loaded sounds (may be NULL).
+ *    @return Memory used by sound buffers in bytes.
+ */
+size_t sound_cacheMemory( int *nloaded )
+{
+   if (nloaded != NULL)
+      *nloaded = sound_nloaded;
+   return sound_mem;
+}
+
+
 /**
  * @brief Plays the sound in the first available channel.
  *
@@ -390,8 +590,14 @@ int sound_play( int sound )
    if ((sound < 0) || (sound >= sound_nlist))
       return -1;
 
+   /* Interface sounds are expected right away, so decode now if needed. */
+   if (sound_ready( sound, 1 ))
+      return -1;
+
    /* Gets a new voice. */
    v = voice_new();
+   if (v == NULL)
+      return -1;
 
    /* Get the sound. */
    s = &sound_list[sound];
@@ -402,7 +608,8 @@ int sound_play( int sound )
 
    /* Set state and add to list. */
    v->state = VOICE_PLAYING;
-   v->id = ++voice_genid;
+   v->sound = sound;
+   s->nvoices++;
    voice_add(v);
 
    return v->id;
@@ -421,11 +628,11 @@ int sound_play( int sound )
  */
 int sound_playPos( int sound, double px, double py, double vx, double vy )
 {
-   alVoice *v;
+   alVoice *v, *tv;
    alSound *s;
    Pilot *p;
-   double cx, cy, dist;
-   int target;
+   double cx, cy, dist, gain;
+   int target, nplaying;
 
    if (sound_disabled)
       return 0;
@@ -438,39 +645,171 @@ int sound_playPos( int sound, double px, double py, double vx, double vy )
    /* Following a pilot. */
    p = pilot_get(target);
    if (target && (p != NULL)) {
-      if (!pilot_inRange( p, px, py ))
+      if (!pilot_inRange( p, px, py )) {
+         sound_stats.culled_range++;
          return 0;
+      }
    }
    /* Set to a position. */
    else {
       cam_getPos(&cx, &cy);
       dist = pow2(px - cx) + pow2(py - cy);
-      if (dist > pilot_sensorRange())
+      if (dist > pilot_sensorRange()) {
+         sound_stats.culled_range++;
          return 0;
+      }
    }
 
-   /* Gets a new voice. */
-   v = voice_new();
+   /* Too far to be heard anyway. */
+   gain = sound_gain( px, py );
+   if (gain < SOUND_CULL_GAIN) {
+      sound_stats.culled_range++;
+      return 0;
+   }
+
+   /* Skip it while the buffer is decoded in the background. */
+   if (sound_ready( sound, 0 ))
+      return 0;
 
    /* Get the sound. */
    s = &sound_list[sound];
 
-   /* Try to play the sound. */
-   if (sound_sys_playPos( v, s, px, py, vx, vy ))
+   /* Only a few copies of the same sound, the quietest makes room. */
+   if (s->nvoices >= SOUND_MAX_SAME) {
+      tv = sound_quietest( sound, gain, &nplaying );
+      if (nplaying >= SOUND_MAX_SAME) {
+         if (tv == NULL) {
+            sound_stats.culled_limit++;
+            return 0;
+         }
+         sound_steal( tv );
+      }
+   }
+
+   /* Gets a new voice. */
+   v = voice_new();
+   if (v == NULL)
       return -1;
 
+   /* Try to play the sound, stealing the quietest voice if all are in use. */
+   if (sound_sys_playPos( v, s, px, py, vx, vy )) {
+      tv = sound_quietest( -1, gain, NULL );
+      if (tv == NULL) {
+         sound_stats.culled_limit++;
+         return 0;
+      }
+      sound_steal( tv );
+      if (sound_sys_playPos( v, s, px, py, vx, vy )) {
+         sound_stats.culled_limit++;
+         return 0;
+      }
+   }
+
    /* Actually add the voice to the list. */
    v->state = VOICE_PLAYING;
-   v->id = ++voice_genid;
+   v->sound = sound;
+   v->flags |= VOICE_POSITIONAL;
+   v->px    = px;
+   v->py    = py;
+   s->nvoices++;
    voice_add(v);
+   sound_stats.played++;
 
    return v->id;
 }
 
 
+/**
+ * @brief Estimates the gain of a positional sound from the listener distance.
+ *
+ *    @param px X position of the sound.
+ *    @param py Y position of the sound.
+ *    @return Estimated gain in the [0:1] range.
+ */
+static double sound_gain( double px, double py )
+{
+   double d;
+
+   d = sqrt( pow2(px - sound_listener[0]) + pow2(py - sound_listener[1]) );
+   if (d <= SOUND_REF_DIST)
+      return 1.;
+   return SOUND_REF_DIST / d;
+}
+
+
+/**
+ * @brief Finds the quietest positional voice that is quieter than a gain.
+ *
+ *    @param sound Sound the voice must be playing, or -1 for any.
+ *    @param gain Gain the voice must be quieter than.
+ *    @param[out] nplaying Number of playing voices of the sound (may be NULL).
+ *    @return The quietest voice or NULL if none is quieter.
+ */
+static alVoice* sound_quietest( int sound, double gain, int *nplaying )
+{
+   int n;
+   double g;
+   alVoice *v, *best;
+
+   n    = 0;
+   best = NULL;
+   voiceLock();
+   for (v=voice_active; v!=NULL; v=v->next) {
+      if (v->state != VOICE_PLAYING)
+         continue;
+      if ((sound >= 0) && (v->sound != sound))
+         continue;
+      n++;
+      if (!(v->flags & VOICE_POSITIONAL))
+         continue;
+      g = sound_gain( v->px, v->py );
+      if (g < gain) {
+         gain = g;
+         best = v;
+      }
+   }
+   voiceUnlock();
+
+   if (nplaying != NULL)
+      *nplaying = n;
+   return best;
+}
+
+
+/**
+ * @brief Stops a voice right away so its resources can be reused.
+ *
+ *    @param v Voice to steal.
+ */
+static void sound_steal( alVoice *v )
+{
+   voiceLock();
+   sound_sys_stop( v );
+   v->state = VOICE_STOPPED;
+   /* Let the backend reclaim whatever the voice was holding. */
+   sound_sys_updateVoice( v );
+   voiceUnlock();
+   sound_stats.stolen++;
+}
+
+
+/**
+ * @brief Gets the positional sound counters.
+ *
+ *    @param[out] stats Where to store the counters.
+ */
+void sound_getStats( SoundStats *stats )
+{
+   *stats = sound_stats;
+}
+
+
 /**
  * @brief Updates the position of a voice.
  *
+ * The position is only stored, the backend gets all the pending positions
+ * at once in sound_update.
+ *
  *    @param voice Identifier of the voice to update.
  *    @param x New x position to update to.
  *    @param y New y position to update to.
@@ -484,10 +823,11 @@ int sound_updatePos( int voice, double px, double py, double vx, double vy )
 
    v = voice_get(voice);
    if (v != NULL) {
-
-      /* Update the voice. */
-      if (sound_sys_updatePos( v, px, py, vx, vy))
-         return -1;
+      v->px = px;
+      v->py = py;
+      v->vx = vx;
+      v->vy = vy;
+      v->flags |= VOICE_MOVED;
    }
 
    return 0;
@@ -512,6 +852,9 @@ int sound_update( double dt )
    /* System update. */
    sound_sys_update();
 
+   /* Drop cold buffers if over budget. */
+   sound_cacheTrim();
+
    if (voice_active == NULL)
       return 0;
 
@@ -520,6 +863,12 @@ int sound_update( double dt )
    /* The actual control loop. */
    for (v=voice_active; v!=NULL; v=v->next) {
 
+      /* Apply pending position updates. */
+      if (v->flags & VOICE_MOVED) {
+         v->flags &= ~VOICE_MOVED;
+         sound_sys_updatePos( v, v->px, v->py, v->vx, v->vy );
+      }
+
       /* Run first to clear in same iteration. */
       sound_sys_updateVoice( v );
 
@@ -539,7 +888,10 @@ int sound_update( double dt )
                tv->next->prev = tv;
          }
 
-         /* Add to free pool. */
+         /* Add to free pool, invalidating the identifier. */
+         sound_list[ v->sound ].nvoices--;
+         v->id = 0;
+         v->flags &= ~VOICE_POSITIONAL;
          v->next = voice_pool;
          v->prev = NULL;
          voice_pool = v;
@@ -651,6 +1003,9 @@ int sound_updateListener( double dir, double px, double py,
    if (sound_disabled)
       return 0;
 
+   sound_listener[0] = px;
+   sound_listener[1] = py;
+
    return sound_sys_updateListener( dir, px, py, vx, vy );
 }
 
@@ -743,11 +1098,12 @@ static int sound_makeList (void)
       strncpy( tmp, files[i], len );
       tmp[len] = '\0';
 
-      /* Load the sound. */
-      sound_list[sound_nlist-1].name = strdup(tmp);
+      /* Register the sound, it only gets loaded when first needed. */
       nsnprintf( path, PATH_MAX, SOUND_PATH"%s", files[i] );
-      if (sound_load( &sound_list[sound_nlist-1], path ))
-         sound_nlist--; /* Song not actually added. */
+      memset( &sound_list[sound_nlist-1], 0, sizeof(alSound) );
+      sound_list[sound_nlist-1].name  = strdup(tmp);
+      sound_list[sound_nlist-1].path  = strdup(path);
+      sound_list[sound_nlist-1].state = SOUND_UNLOADED;
 
       /* Clean up. */
       free(files[i]);
@@ -755,7 +1111,7 @@ static int sound_makeList (void)
    /* shrink to minimum ram usage */
    sound_list = realloc( sound_list, sound_nlist*sizeof(alSound));
 
-   DEBUG( ngettext("Loaded %d Sound", "Loaded %d Sounds", sound_nlist), sound_nlist );
+   DEBUG( ngettext("Registered %d Sound", "Registered %d Sounds", sound_nlist), sound_nlist );
 
    /* More clean up. */
    free(files);
@@ -837,9 +1193,13 @@ static void sound_free( alSound *snd )
       free(snd->name);
       snd->name = NULL;
    }
+   free(snd->path);
+   snd->path = NULL;
 
    /* Free internals. */
-   sound_sys_free(snd);
+   if (snd->state == SOUND_LOADED)
+      sound_sys_free(snd);
+   snd->state = SOUND_UNLOADED;
 }
 
 
@@ -875,6 +1235,11 @@ int sound_playGroup( int group, int sound, int once )
    if ((sound < 0) || (sound >= sound_nlist))
       return -1;
 
+   /* Groups do not use voices, so their sounds stay loaded. */
+   if (sound_ready( sound, 1 ))
+      return -1;
+   sound_list[sound].pinned = 1;
+
    return sound_sys_playGroup( group, &sound_list[sound], once );
 }
 
@@ -996,7 +1361,14 @@ alVoice* voice_new (void)
 
    /* No free voices, allocate a new one. */
    if (voice_pool == NULL) {
+      if (voice_nslots > VOICE_SLOT_MASK) {
+         WARN(_("Out of voice slots!"));
+         return NULL;
+      }
       v = calloc( 1, sizeof(alVoice) );
+      v->slot = voice_nslots++;
+      voice_slots = realloc( voice_slots, voice_nslots * sizeof(alVoice*) );
+      voice_slots[ v->slot ] = v;
       voice_pool = v;
       return v;
    }
@@ -1030,6 +1402,11 @@ int voice_add( alVoice* v )
          voice_pool->prev = NULL;
    }
 
+   /* New generation for the slot, so old identifiers become stale. */
+   v->gen = (v->gen >= VOICE_GEN_MAX) ? 1 : v->gen+1;
+   v->id  = (v->gen << VOICE_SLOT_BITS) | v->slot;
+   v->flags &= ~VOICE_MOVED;
+
    /* Insert to the front of active voices. */
    voiceLock();
    tv = voice_active;
@@ -1046,22 +1423,28 @@ int voice_add( alVoice* v )
 /**
  * @brief Gets a voice by identifier.
  *
+ * The slot table is only modified from the main thread, so no locking is
+ * needed to look it up.
+ *
  *    @param id Identifier to look for.
  *    @return Voice matching identifier or NULL if not found.
  */
 alVoice* voice_get( int id )
 {
+   int slot;
    alVoice *v;
 
-   /* Make sure there are voices. */
-   if (voice_active==NULL)
+   if (id <= 0)
       return NULL;
 
-   voiceLock();
-   for (v=voice_active; v!=NULL; v=v->next)
-      if (v->id == id)
-         break;
-   voiceUnlock();
+   slot = id & VOICE_SLOT_MASK;
+   if (slot >= voice_nslots)
+      return NULL;
+
+   /* Voices that were recycled have a different generation or no id. */
+   v = voice_slots[ slot ];
+   if (v->id != id)
+      return NULL;
 
    return v;
 }
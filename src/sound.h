@@ -8,12 +8,26 @@
 #  define SOUND_H
 
 
+#include <stddef.h>
+
+
 #define SOUND_SPEED_PLAY_LIMIT      2.0 /**< Speed modifier at which sounds do not play. */
 
 
 extern int sound_disabled;
 
 
+/**
+ * @brief Counters of the positional sound scheduler.
+ */
+typedef struct SoundStats_ {
+   unsigned int played; /**< Positional sounds played. */
+   unsigned int culled_range; /**< Plays dropped for being out of range or inaudible. */
+   unsigned int culled_limit; /**< Plays dropped for too many of the same sound or no free voices. */
+   unsigned int stolen; /**< Voices stopped to make room for a louder sound. */
+} SoundStats;
+
+
 /*
  * Environmental features.
  */
@@ -49,6 +63,9 @@ int sound_updatePos( int voice, double px, double py, double vx, double vy );
 int sound_updateListener( double dir, double px, double py,
       double vx, double vy );
 void sound_setSpeed( double s );
+void sound_preload( int sound );
+size_t sound_cacheMemory( int *nloaded );
+void sound_getStats( SoundStats *stats );
 
 
 /*
@@ -727,6 +727,7 @@ int sound_al_load( alSound *snd, const char *filename )
    }
    else
       snd->length = (double)size / (double)(freq * (bits/8) * channels);
+   snd->mem = size;
 
    /* Check for errors. */
    al_checkErr();
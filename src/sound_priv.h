@@ -25,12 +25,36 @@
  */
 #define VOICE_LOOPING      (1<<10) /* voice loops */
 #define VOICE_STATIC       (1<<11) /* voice isn't relative */
+#define VOICE_MOVED        (1<<12) /* voice has a pending position update */
+#define VOICE_POSITIONAL   (1<<13) /* voice is positional and can be stolen */
+
+
+/*
+ * Voice identifiers are a slot index with a generation counter on top, so
+ * stale identifiers of recycled voices never match.
+ */
+#define VOICE_SLOT_BITS    16 /**< Bits of the identifier used by the slot. */
+#define VOICE_SLOT_MASK    ((1<<VOICE_SLOT_BITS)-1) /**< Mask of the slot in the identifier. */
+#define VOICE_GEN_MAX      ((1<<(31-VOICE_SLOT_BITS))-1) /**< Largest generation. */
 
 
 #define MUSIC_FADEOUT_DELAY   1000 /**< Time it takes to fade out. */
 #define MUSIC_FADEIN_DELAY    2000 /**< Time it takes to fade in. */
 
 
+/**
+ * @typedef sound_state_t
+ * @brief The loading state of a sound buffer.
+ * @sa alSound
+ */
+typedef enum sound_state_ {
+   SOUND_UNLOADED, /**< Sound is only registered. */
+   SOUND_LOADING,  /**< Sound is being decoded by a worker thread. */
+   SOUND_LOADED,   /**< Sound buffer is ready to be played. */
+   SOUND_FAILED    /**< Sound could not be loaded. */
+} sound_state_t;
+
+
 /**
  * @struct alSound
  *
@@ -38,7 +62,15 @@
  */
 typedef struct alSound_ {
    char *name; /**< Buffer's name. */
+   char *path; /**< Path of the file to load the buffer from. */
    double length; /**< Length of the buffer. */
+   size_t mem; /**< Memory used by the buffer, set by the backend. */
+
+   /* Cache. */
+   sound_state_t state; /**< Loading state of the buffer. */
+   unsigned int used; /**< Last time the sound was played, for eviction. */
+   int nvoices; /**< Number of active voices using the buffer. */
+   int pinned; /**< Played through groups so it can never be evicted. */
 
    /*
     * Backend specific.
@@ -82,7 +114,16 @@ typedef struct alVoice_ {
    struct alVoice_ *prev; /**< Linked list previous member. */
    struct alVoice_ *next; /**< Linked list next member. */
 
-   int id; /**< Identifier of the voice. */
+   int id; /**< Identifier of the voice, 0 when not active. */
+   int sound; /**< Sound the voice is playing. */
+   int slot; /**< Index of the voice in the slot table. */
+   int gen; /**< Generation of the slot, bumped every time it is reused. */
+
+   /* Pending position update, applied by sound_update. */
+   double px; /**< X position of the voice. */
+   double py; /**< Y position of the voice. */
+   double vx; /**< X velocity of the voice. */
+   double vy; /**< Y velocity of the voice. */
 
    voice_state_t state; /**< Current state of the sound. */
    unsigned int flags; /**< Voice flags. */
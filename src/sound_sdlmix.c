@@ -446,6 +446,7 @@ int sound_mix_load( alSound *s, const char *filename )
 
    /* Set length. */
    s->length = (double)s->u.mix.buf->alen / (double)(freq*bytes*channels);
+   s->mem    = s->u.mix.buf->alen;
 
    return 0;
 }
@@ -74,6 +74,8 @@
 
 #define ASTEROID_EXPLODE_INTERVAL 5. /**< Interval of asteroids randomly exploding */
 #define ASTEROID_EXPLODE_CHANCE   0.1 /**< Chance of asteroid exploding each interval */
+#define ASTEROID_GROW_TIME        2. /**< Time it takes an asteroid to appear or disappear. */
+#define ASTEROID_EXPLODE_TIME     .5 /**< Time it takes an asteroid to explode. */
 
 /*
  * planet <-> system name stack
@@ -100,12 +102,48 @@ static Planet *planet_stack = NULL; /**< Planet stack. */
 static int planet_nstack = 0; /**< Planet stack size. */
 static int planet_mstack = 0; /**< Memory size of planet stack. */
 
+/*
+ * Known state bitsets, mirroring the known flags so map outfits can be
+ * checked with a subset test.
+ */
+static SpaceKnownSet space_known[SPACE_KNOWN_SENTINEL]; /**< Known bitsets by type. */
+static int jump_nid = 0; /**< Next jump point identifier. */
+
 /*
  * Asteroid types stack.
  */
 static AsteroidType *asteroid_types = NULL; /**< Asteroid types stack. */
 static int asteroid_ntypes = 0; /**< Asteroid types stack size. */
 
+/*
+ * Asteroid field occupancy grid of the current system.
+ */
+#define FIELD_GRID_OUTSIDE    -1 /**< Cell is entirely outside every field. */
+#define FIELD_GRID_BOUNDARY   -2 /**< Cell needs exact per-point tests. */
+#define FIELD_GRID_MAXCELLS   64 /**< Maximum cells along a side of the grid. */
+#define FIELD_GRID_MINSIZE    100. /**< Minimum size of a cell. */
+static StarSystem *field_grid_sys = NULL; /**< System the grid was built for. */
+static int *field_grid    = NULL; /**< Classification of each cell. */
+static int field_grid_w   = 0; /**< Grid width in cells. */
+static int field_grid_h   = 0; /**< Grid height in cells. */
+static double field_grid_x = 0.; /**< Left edge of the grid. */
+static double field_grid_y = 0.; /**< Bottom edge of the grid. */
+static double field_grid_cell = 0.; /**< Size of a cell. */
+
+/*
+ * Asteroid state updates.
+ */
+static const double asteroid_stateTime[] = {
+   ASTEROID_EXPLODE_INTERVAL, /* ASTEROID_VISIBLE */
+   ASTEROID_GROW_TIME,        /* ASTEROID_GROWING */
+   ASTEROID_GROW_TIME,        /* ASTEROID_SHRINKING */
+   ASTEROID_EXPLODE_TIME,     /* ASTEROID_EXPLODING */
+   HUGE_VAL,                  /* ASTEROID_INIT */
+   HUGE_VAL                   /* ASTEROID_INVISIBLE */
+}; /**< Time spent in each state before the asteroid needs attention. */
+static int *asteroid_due   = NULL; /**< Asteroids that need a state change. */
+static int asteroid_mdue   = 0; /**< Memory allocated for asteroid_due. */
+
 /*
  * Misc.
  */
@@ -116,6 +154,7 @@ static glTexture *jumpbuoy_gfx = NULL; /**< Jump buoy graphics. */
 static nlua_env landing_env = LUA_NOREF; /**< Landing lua env. */
 static int space_fchg = 0; /**< Faction change counter, to avoid unnecessary calls. */
 static int space_simulating = 0; /**< Are we simulating space? */
+static SystemPresence *space_spawning = NULL; /**< Presence whose spawn script is running. */
 glTexture **asteroid_gfx = NULL;
 static size_t nasterogfx = 0; /**< Nb of asteroid gfx. */
 
@@ -158,7 +197,11 @@ static void system_parseAsteroids( const xmlNodePtr parent, StarSystem *sys );
 /* misc */
 static int getPresenceIndex( StarSystem *sys, int faction );
 static void system_scheduler( double dt, int init );
+static void space_simulate (void);
 static void asteroid_explode ( Asteroid *a, AsteroidAnchor *field, int give_reward );
+static void space_buildFieldGrid( StarSystem *sys );
+static void space_freeFieldGrid (void);
+static int space_isInFieldExact( double x, double y );
 /* Render. */
 static void space_renderJumpPoint( JumpPoint *jp, int i );
 static void space_renderPlanet( Planet *p );
@@ -971,13 +1014,142 @@ Planet* planet_getAll( int *n )
 }
 
 
+/**
+ * @brief Sets or clears a bit in one of the known bitsets, growing it if needed.
+ *
+ * The cached map geometry is invalidated whenever the known state changes.
+ *
+ *    @param set Bitset to modify.
+ *    @param id Index of the bit to modify.
+ *    @param known Whether to set or clear the bit.
+ */
+static void space_knownSetBit( SpaceKnownSet *set, int id, int known )
+{
+   int nwords, old;
+
+   if (id < 0)
+      return;
+
+   /* Nothing to do if it's already in the right state. */
+   known = !!known;
+   old   = (SPACE_KNOWN_WORD(id) < set->nwords) &&
+         (set->bits[ SPACE_KNOWN_WORD(id) ] & SPACE_KNOWN_BIT(id));
+   if (old == known)
+      return;
+   map_invalidateGeometry();
+
+   if (SPACE_KNOWN_WORD(id) >= set->nwords) {
+      nwords = MAX( 2*set->nwords, SPACE_KNOWN_WORD(id)+1 );
+      set->bits = realloc( set->bits, nwords * sizeof(uint32_t) );
+      memset( &set->bits[ set->nwords ], 0,
+            (nwords - set->nwords) * sizeof(uint32_t) );
+      set->nwords = nwords;
+   }
+
+   if (known)
+      set->bits[ SPACE_KNOWN_WORD(id) ] |= SPACE_KNOWN_BIT(id);
+   else
+      set->bits[ SPACE_KNOWN_WORD(id) ] &= ~SPACE_KNOWN_BIT(id);
+}
+
+
+/**
+ * @brief Checks to see if a mask is a subset of one of the known bitsets.
+ *
+ *    @param type Which known bitset to check against.
+ *    @param mask Mask to check.
+ *    @param nwords Number of words in the mask.
+ *    @return 1 if everything in the mask is known, 0 otherwise.
+ */
+int space_knownSubset( SpaceKnownType type, const uint32_t *mask, int nwords )
+{
+   int i;
+   const SpaceKnownSet *set;
+
+   set = &space_known[ type ];
+   for (i=0; i<nwords; i++) {
+      if (i >= set->nwords) {
+         if (mask[i] != 0)
+            return 0;
+      }
+      else if ((mask[i] & ~set->bits[i]) != 0)
+         return 0;
+   }
+   return 1;
+}
+
+
+/**
+ * @brief Adds an element to a mask to be tested with space_knownSubset.
+ *
+ *    @param set Mask to modify.
+ *    @param id Identifier of the element to add.
+ */
+void space_knownMaskAdd( SpaceKnownSet *set, int id )
+{
+   space_knownSetBit( set, id, 1 );
+}
+
+
 /**
  * @brief Sets a planet's known status, if it's real.
  */
 void planet_setKnown( Planet *p )
 {
-   if (p->real == ASSET_REAL)
+   if (p->real == ASSET_REAL) {
       planet_setFlag(p, PLANET_KNOWN);
+      space_knownSetBit( &space_known[SPACE_KNOWN_PLANET], p->id, 1 );
+   }
+}
+
+
+/**
+ * @brief Clears a planet's known status.
+ */
+void planet_rmKnown( Planet *p )
+{
+   planet_rmFlag(p, PLANET_KNOWN);
+   space_knownSetBit( &space_known[SPACE_KNOWN_PLANET], p->id, 0 );
+}
+
+
+/**
+ * @brief Sets a system's known status.
+ */
+void sys_setKnown( StarSystem *sys )
+{
+   sys_setFlag(sys, SYSTEM_KNOWN);
+   space_knownSetBit( &space_known[SPACE_KNOWN_SYSTEM], sys->id, 1 );
+}
+
+
+/**
+ * @brief Clears a system's known status.
+ */
+void sys_rmKnown( StarSystem *sys )
+{
+   sys_rmFlag(sys, SYSTEM_KNOWN);
+   space_knownSetBit( &space_known[SPACE_KNOWN_SYSTEM], sys->id, 0 );
+}
+
+
+/**
+ * @brief Sets a jump point's known status.
+ */
+void jp_setKnown( JumpPoint *jp )
+{
+   jp_setFlag(jp, JP_KNOWN);
+   space_knownSetBit( &space_known[SPACE_KNOWN_JUMP], jp->id, 1 );
+}
+
+
+/**
+ * @brief Clears a jump point's known status.
+ */
+void jp_rmKnown( JumpPoint *jp )
+{
+   jp_rmFlag(jp, JP_KNOWN);
+   space_knownSetBit( &space_known[SPACE_KNOWN_JUMP], jp->id, 0 );
 }
 
 
@@ -1148,12 +1320,15 @@ static void system_scheduler( double dt, int init )
       lua_pushnumber( naevL, p->value ); /* f, [arg,], max */
 
       /* Actually run the function. */
+      space_spawning = p;
       if (nlua_pcall(env, n+1, 2)) { /* error has occurred */
+         space_spawning = NULL;
          WARN(_("Lua Spawn script for faction '%s' : %s"),
                faction_name( p->faction ), lua_tostring(naevL,-1));
          lua_pop(naevL,1);
          continue;
       }
+      space_spawning = NULL;
 
       /* Output is handled the same way. */
       if (!lua_isnumber(naevL,-2)) {
@@ -1211,6 +1386,77 @@ static void system_scheduler( double dt, int init )
 void space_factionChange (void)
 {
    space_fchg = 1;
+   map_invalidateGeometry();
+}
+
+
+/**
+ * @brief Moves the asteroids of a field and finds the ones changing state.
+ *
+ * Only the kinematics and timers are touched here so the loop stays tight,
+ * asteroids whose timer ran out are stored in asteroid_due for the caller.
+ *
+ *    @param field Field to update.
+ *    @param dt Current delta tick.
+ *    @return Number of asteroids in asteroid_due.
+ */
+static int asteroids_drift( AsteroidAnchor *field, double dt )
+{
+   int j, n;
+   Asteroid *a;
+
+   if (field->nb > asteroid_mdue) {
+      asteroid_mdue = field->nb;
+      asteroid_due  = realloc( asteroid_due, asteroid_mdue * sizeof(int) );
+   }
+
+   n = 0;
+   for (j=0; j<field->nb; j++) {
+      a = &field->asteroids[j];
+
+      /* Skip invisible asteroids */
+      if (a->appearing == ASTEROID_INVISIBLE)
+         continue;
+
+      a->pos.x += a->vel.x * dt;
+      a->pos.y += a->vel.y * dt;
+      a->timer += dt;
+      if (a->timer >= asteroid_stateTime[ a->appearing ])
+         asteroid_due[ n++ ] = j;
+   }
+   return n;
+}
+
+
+/**
+ * @brief Moves the debris of a field relative to the player.
+ *
+ *    @param field Field to update.
+ *    @param vx X velocity of the player.
+ *    @param vy Y velocity of the player.
+ *    @param dt Current delta tick.
+ */
+static void debris_drift( AsteroidAnchor *field, double vx, double vy, double dt )
+{
+   int j;
+   Debris *d;
+
+   for (j=0; j<field->ndebris; j++) {
+      d = &field->debris[j];
+
+      d->pos.x += (d->vel.x-vx) * dt;
+      d->pos.y += (d->vel.y-vy) * dt;
+
+      /* Check boundaries */
+      if (d->pos.x > SCREEN_W + DEBRIS_BUFFER)
+         d->pos.x -= SCREEN_W + 2*DEBRIS_BUFFER;
+      else if (d->pos.x < -DEBRIS_BUFFER)
+         d->pos.x += SCREEN_W + 2*DEBRIS_BUFFER;
+      if (d->pos.y > SCREEN_H + DEBRIS_BUFFER)
+         d->pos.y -= SCREEN_H + 2*DEBRIS_BUFFER;
+      else if (d->pos.y < -DEBRIS_BUFFER)
+         d->pos.y += SCREEN_H + 2*DEBRIS_BUFFER;
+   }
 }
 
 
@@ -1221,14 +1467,13 @@ void space_factionChange (void)
  */
 void space_update( const double dt )
 {
-   int i, j;
+   int i, k, n;
    double x, y;
    Pilot *p;
    Damage dmg;
    HookParam hparam[3];
    AsteroidAnchor *ast;
    Asteroid *a;
-   Debris *d;
    Pilot *pplayer;
    Solid *psolid;
 
@@ -1331,7 +1576,7 @@ void space_update( const double dt )
       /* Jump point updates */
       for (i=0; i<cur_system->njumps; i++)
          if (( !jp_isKnown( &cur_system->jumps[i] )) && ( pilot_inRangeJump( player.p, i ))) {
-            jp_setFlag( &cur_system->jumps[i], JP_KNOWN );
+            jp_setKnown( &cur_system->jumps[i] );
             player_message( _("You discovered a Jump Point.") );
             hparam[0].type  = HOOK_PARAM_STRING;
             hparam[0].u.str = "jump";
@@ -1347,85 +1592,91 @@ void space_update( const double dt )
    gatherable_update(dt);
    
    /* Asteroids/Debris update */
+   x = 0;
+   y = 0;
+   pplayer = pilot_get( PLAYER_ID );
+   if (pplayer != NULL) {
+      psolid  = pplayer->solid;
+      x = psolid->vel.x;
+      y = psolid->vel.y;
+   }
    for (i=0; i<cur_system->nasteroids; i++) {
       ast = &cur_system->asteroids[i];
 
-      for (j=0; j<ast->nb; j++) {
-         a = &ast->asteroids[j];
-
-         /* Skip invisible asteroids */
-         if (a->appearing == ASTEROID_INVISIBLE)
-            continue;
-
-         a->pos.x += a->vel.x * dt;
-         a->pos.y += a->vel.y * dt;
+      /* Move everything first, only a few asteroids change state. */
+      n = asteroids_drift( ast, dt );
+      for (k=0; k<n; k++) {
+         a = &ast->asteroids[ asteroid_due[k] ];
 
          if (a->appearing == ASTEROID_VISIBLE) {
             /* Random explosions */
-            a->timer += dt;
-            if (a->timer >= ASTEROID_EXPLODE_INTERVAL) {
-               a->timer = 0.;
-               if ( (RNGF() < ASTEROID_EXPLODE_CHANCE) ||
-                     (space_isInField(&a->pos) < 0) ) {
-                  asteroid_explode( a, ast, 0 );
-               }
+            a->timer = 0.;
+            if ( (RNGF() < ASTEROID_EXPLODE_CHANCE) ||
+                  (space_isInField(&a->pos) < 0) ) {
+               asteroid_explode( a, ast, 0 );
             }
          }
          else if (a->appearing == ASTEROID_GROWING) {
             /* Grow */
-            a->timer += dt;
-            if (a->timer >= 2.) {
-               a->timer = 0.;
-               a->appearing = ASTEROID_VISIBLE;
-            }
+            a->timer = 0.;
+            a->appearing = ASTEROID_VISIBLE;
          }
          else if (a->appearing == ASTEROID_SHRINKING) {
-            /* Shrink */
-            a->timer += dt;
-            if (a->timer >= 2.) {
-               /* Remove the asteroid target to any pilot. */
-               pilot_untargetAsteroid( a->parent, a->id );
-               /* reinit any disappeared asteroid */
-               asteroid_init( a, ast );
-            }
+            /* Remove the asteroid target to any pilot. */
+            pilot_untargetAsteroid( a->parent, a->id );
+            /* reinit any disappeared asteroid */
+            asteroid_init( a, ast );
          }
          else if (a->appearing == ASTEROID_EXPLODING) {
-            /* Exploding asteroid */
-            a->timer += dt;
-            if (a->timer >= .5) {
-               /* Make it explode */
-               asteroid_explode( a, ast, 1 );
-            }
+            /* Make it explode */
+            asteroid_explode( a, ast, 1 );
          }
       }
 
-      x = 0;
-      y = 0;
-      pplayer = pilot_get( PLAYER_ID );
-      if (pplayer != NULL) {
-         psolid  = pplayer->solid;
-         x = psolid->vel.x;
-         y = psolid->vel.y;
-      }
+      debris_drift( ast, x, y, dt );
 
-      for (j=0; j<ast->ndebris; j++) {
-         d = &ast->debris[j];
+   }
+}
 
-         d->pos.x += (d->vel.x-x) * dt;
-         d->pos.y += (d->vel.y-y) * dt;
-
-         /* Check boundaries */
-         if (d->pos.x > SCREEN_W + DEBRIS_BUFFER)
-            d->pos.x -= SCREEN_W + 2*DEBRIS_BUFFER;
-         else if (d->pos.y > SCREEN_H + DEBRIS_BUFFER)
-            d->pos.y -= SCREEN_H + 2*DEBRIS_BUFFER;
-         else if (d->pos.x < -DEBRIS_BUFFER)
-            d->pos.x += SCREEN_W + 2*DEBRIS_BUFFER;
-         else if (d->pos.y < -DEBRIS_BUFFER)
-            d->pos.y += SCREEN_H + 2*DEBRIS_BUFFER;
-      }
 
+/**
+ * @brief Checks to see if the system is being simulated before the player enters.
+ *
+ *    @return 1 if the system is being simulated.
+ */
+int space_isSimulation (void)
+{
+   return space_simulating;
+}
+
+
+/**
+ * @brief Simulates the system so it is populated when the player enters.
+ *
+ * Only the scheduler and pilots are updated, in coarse steps. Weapons and
+ *  special effects are skipped, the AI thinks at a reduced rate and doesn't
+ *  shoot, so pilots just fly along their way.
+ */
+static void space_simulate (void)
+{
+   int i, n;
+#ifdef DEBUGGING
+   Uint64 t0;
+
+   t0 = SDL_GetPerformanceCounter();
+#endif /* DEBUGGING */
+
+   n = SYSTEM_SIMULATE_TIME / SYSTEM_SIMULATE_STEP;
+   for (i=0; i<n; i++) {
+      space_update( SYSTEM_SIMULATE_STEP );
+      pilots_update( SYSTEM_SIMULATE_STEP );
    }
+
+#ifdef DEBUGGING
+   DEBUG( _("Simulated %s in %.1f ms"), cur_system->name,
+         1e3 * (double)(SDL_GetPerformanceCounter() - t0) /
+         (double)SDL_GetPerformanceFrequency() );
+#endif /* DEBUGGING */
 }
 
 
@@ -1437,7 +1688,7 @@ void space_update( const double dt )
 void space_init( const char* sysname )
 {
    char* nt;
-   int i, j, n, s;
+   int i, j, s;
    Planet *pnt;
    AsteroidAnchor *ast;
    Asteroid *a;
@@ -1503,6 +1754,7 @@ void space_init( const char* sysname )
    }
 
    /* Set up asteroids. */
+   space_buildFieldGrid( cur_system );
    for (i=0; i<cur_system->nasteroids; i++) {
       ast = &cur_system->asteroids[i];
       ast->id = i;
@@ -1552,7 +1804,7 @@ void space_init( const char* sysname )
    system_scheduler( 0., 1 );
 
    /* we now know this system */
-   sys_setFlag(cur_system,SYSTEM_KNOWN);
+   sys_setKnown(cur_system);
 
    /* Simulate system. */
    space_simulating = 1;
@@ -1562,9 +1814,7 @@ void space_init( const char* sysname )
    s = sound_disabled;
    sound_disabled = 1;
    ntime_allowUpdate( 0 );
-   n = SYSTEM_SIMULATE_TIME / fps_min;
-   for (i=0; i<n; i++)
-      update_routine( fps_min, 1 );
+   space_simulate();
    ntime_allowUpdate( 1 );
    sound_disabled = s;
    player_messageToggle( 1 );
@@ -2872,6 +3122,7 @@ static int system_parseJumpPointDiff( const xmlNodePtr node, StarSystem *sys )
    free(buf);
    j->targetid = j->target->id;
    j->radius = 200.;
+   j->id = jump_nid++;
 
    if (!jp_isFlag(j,JP_AUTOPOS))
       vect_cset( &j->pos, x, y );
@@ -2939,6 +3190,7 @@ static int system_parseJumpPoint( const xmlNodePtr node, StarSystem *sys )
    free(buf);
    j->targetid = j->target->id;
    j->radius = 200.;
+   j->id = jump_nid++;
 
    pos = 0;
 
@@ -3722,9 +3974,9 @@ static void space_renderAsteroid( Asteroid *a )
 
    /* Check if needs scaling. */
    if (a->appearing == ASTEROID_GROWING)
-      scale = CLAMP( 0., 1., a->timer / 2. );
+      scale = CLAMP( 0., 1., a->timer / ASTEROID_GROW_TIME );
    else if (a->appearing == ASTEROID_SHRINKING)
-      scale = CLAMP( 0., 1., 1. - a->timer / 2. );
+      scale = CLAMP( 0., 1., 1. - a->timer / ASTEROID_GROW_TIME );
    else
       scale = 1.;
 
@@ -3785,6 +4037,20 @@ void space_exit (void)
       gl_freeTexture(jumpbuoy_gfx);
    jumpbuoy_gfx = NULL;
 
+   /* Free the known bitsets. */
+   for (i=0; i<SPACE_KNOWN_SENTINEL; i++) {
+      free( space_known[i].bits );
+      space_known[i].bits   = NULL;
+      space_known[i].nwords = 0;
+   }
+   jump_nid = 0;
+
+   /* Free the asteroid field grid. */
+   space_freeFieldGrid();
+   free(asteroid_due);
+   asteroid_due  = NULL;
+   asteroid_mdue = 0;
+
    /* Free asteroid graphics. */
    for (i=0; i<(int)nasterogfx; i++)
       gl_freeTexture(asteroid_gfx[i]);
@@ -3913,6 +4179,11 @@ void space_clearKnown (void)
    }
    for (j=0; j<planet_nstack; j++)
       planet_rmFlag(&planet_stack[j],PLANET_KNOWN);
+   for (i=0; i<SPACE_KNOWN_SENTINEL; i++)
+      if (space_known[i].bits != NULL)
+         memset( space_known[i].bits, 0,
+               space_known[i].nwords * sizeof(uint32_t) );
+   map_invalidateGeometry();
 }
 
 
@@ -3929,6 +4200,7 @@ void space_clearMarkers (void)
       systems_stack[i].markers_high  = 0;
       systems_stack[i].markers_low   = 0;
    }
+   map_invalidateGeometry();
 }
 
 
@@ -3940,6 +4212,7 @@ void space_clearComputerMarkers (void)
    int i;
    for (i=0; i<systems_nstack; i++)
       sys_rmFlag(&systems_stack[i],SYSTEM_CMARKED);
+   map_invalidateGeometry();
 }
 
 
@@ -3982,6 +4255,7 @@ int space_addMarker( int sys, SysMarker type )
    /* Decrement markers. */
    (*markers)++;
    sys_setFlag(ssys, SYSTEM_MARKED);
+   map_invalidateGeometry();
 
    return 0;
 }
@@ -4029,6 +4303,7 @@ int space_rmMarker( int sys, SysMarker type )
       sys_rmFlag(ssys, SYSTEM_MARKED);
       (*markers) = 0;
    }
+   map_invalidateGeometry();
 
    return 0;
 }
@@ -4105,7 +4380,7 @@ int space_sysLoad( xmlNodePtr parent )
                else /* load from 5.0 saves */
                   sys = system_get(xml_get(cur));
                if (sys != NULL) { /* Must exist */
-                  sys_setFlag(sys,SYSTEM_KNOWN);
+                  sys_setKnown(sys);
                   space_parseAssets(cur, sys);
                }
             }
@@ -4139,7 +4414,7 @@ static int space_parseAssets( xmlNodePtr parent, StarSystem* sys )
       else if (xml_isNode(node,"jump")) {
          jp = jump_get(xml_get(node), sys);
          if (jp != NULL) /* Must exist */
-            jp_setFlag(jp,JP_KNOWN);
+            jp_setKnown(jp);
       }
    } while (xml_nextNode(node));
 
@@ -4375,12 +4650,127 @@ void space_reconstructPresences( void )
 
 
 /**
- * @brief See if the position is in an asteroid field.
+ * @brief Frees the asteroid field occupancy grid.
+ */
+static void space_freeFieldGrid (void)
+{
+   free(field_grid);
+   field_grid     = NULL;
+   field_grid_sys = NULL;
+   field_grid_w   = 0;
+   field_grid_h   = 0;
+}
+
+
+/**
+ * @brief Builds the asteroid field occupancy grid of a system.
  *
- *    @param p pointer to the position.
+ * Every cell is classified as being entirely inside a single field (and
+ * no exclusion zone), entirely outside all fields or on a boundary. Only
+ * boundary cells need to test positions against the circles afterwards.
+ *
+ *    @param sys System to build the grid for.
+ */
+static void space_buildFieldGrid( StarSystem *sys )
+{
+   int i, j, k, c;
+   int partial;
+   double x0, y0, x1, y1, cx, cy;
+   double xmin, ymin, xmax, ymax;
+   double dx, dy, near2, far2, r2;
+   AsteroidAnchor *a;
+   AsteroidExclusion *e;
+
+   space_freeFieldGrid();
+   if (sys->nasteroids <= 0)
+      return;
+
+   /* Bounding box of all the fields, nothing outside can be in one. */
+   xmin = ymin =  HUGE_VAL;
+   xmax = ymax = -HUGE_VAL;
+   for (i=0; i < sys->nasteroids; i++) {
+      a = &sys->asteroids[i];
+      xmin = MIN( xmin, a->pos.x - a->radius );
+      ymin = MIN( ymin, a->pos.y - a->radius );
+      xmax = MAX( xmax, a->pos.x + a->radius );
+      ymax = MAX( ymax, a->pos.y + a->radius );
+   }
+   field_grid_cell = MAX( MAX( xmax-xmin, ymax-ymin ) / FIELD_GRID_MAXCELLS,
+         FIELD_GRID_MINSIZE );
+   field_grid_x = xmin;
+   field_grid_y = ymin;
+   /* One extra cell so positions on the far edge still map to a cell. */
+   field_grid_w = (int)floor( (xmax-xmin) / field_grid_cell ) + 1;
+   field_grid_h = (int)floor( (ymax-ymin) / field_grid_cell ) + 1;
+   field_grid   = malloc( field_grid_w * field_grid_h * sizeof(int) );
+
+   for (j=0; j < field_grid_h; j++) {
+      y0 = field_grid_y + j * field_grid_cell;
+      y1 = y0 + field_grid_cell;
+      for (i=0; i < field_grid_w; i++) {
+         x0 = field_grid_x + i * field_grid_cell;
+         x1 = x0 + field_grid_cell;
+         c  = FIELD_GRID_OUTSIDE;
+
+         /* Exclusion zones take priority over fields. */
+         partial = 0;
+         for (k=0; k < sys->nastexclude; k++) {
+            e  = &sys->astexclude[k];
+            cx = e->pos.x;
+            cy = e->pos.y;
+            r2 = pow2( e->radius );
+            dx = cx - CLAMP( x0, x1, cx );
+            dy = cy - CLAMP( y0, y1, cy );
+            near2 = pow2(dx) + pow2(dy);
+            if (near2 > r2)
+               continue;
+            far2 = pow2( MAX( FABS(cx-x0), FABS(cx-x1) ) ) +
+                  pow2( MAX( FABS(cy-y0), FABS(cy-y1) ) );
+            if (far2 <= r2) {
+               partial = -1;
+               break;
+            }
+            partial = 1;
+         }
+
+         /* The first field touching the cell decides, unless it only
+          * covers part of it. */
+         if (partial >= 0) {
+            for (k=0; k < sys->nasteroids; k++) {
+               a  = &sys->asteroids[k];
+               cx = a->pos.x;
+               cy = a->pos.y;
+               r2 = pow2( a->radius );
+               dx = cx - CLAMP( x0, x1, cx );
+               dy = cy - CLAMP( y0, y1, cy );
+               near2 = pow2(dx) + pow2(dy);
+               if (near2 > r2)
+                  continue;
+               far2 = pow2( MAX( FABS(cx-x0), FABS(cx-x1) ) ) +
+                     pow2( MAX( FABS(cy-y0), FABS(cy-y1) ) );
+               if ((far2 <= r2) && !partial)
+                  c = k;
+               else
+                  c = FIELD_GRID_BOUNDARY;
+               break;
+            }
+         }
+
+         field_grid[ j*field_grid_w + i ] = c;
+      }
+   }
+   field_grid_sys = sys;
+}
+
+
+/**
+ * @brief Tests a position against every exclusion zone and field.
+ *
+ *    @param x X position to test.
+ *    @param y Y position to test.
  *    @return -1 If false; index of the field otherwise.
  */
-int space_isInField ( Vector2d *p )
+static int space_isInFieldExact( double x, double y )
 {
    int i;
    AsteroidAnchor *a;
@@ -4389,14 +4779,14 @@ int space_isInField ( Vector2d *p )
    /* Always return -1 if in an exclusion zone */
    for (i=0; i < cur_system->nastexclude; i++) {
       e = &cur_system->astexclude[i];
-      if (vect_dist( p, &e->pos ) <= e->radius)
+      if (pow2(x - e->pos.x) + pow2(y - e->pos.y) <= pow2(e->radius))
          return -1;
    }
 
    /* Check if in asteroid field */
    for (i=0; i < cur_system->nasteroids; i++) {
       a = &cur_system->asteroids[i];
-      if (vect_dist( p, &a->pos ) <= a->radius)
+      if (pow2(x - a->pos.x) + pow2(y - a->pos.y) <= pow2(a->radius))
          return i;
    }
 
@@ -4404,6 +4794,35 @@ int space_isInField ( Vector2d *p )
 }
 
 
+/**
+ * @brief See if the position is in an asteroid field.
+ *
+ *    @param p pointer to the position.
+ *    @return -1 If false; index of the field otherwise.
+ */
+int space_isInField ( Vector2d *p )
+{
+   int i, j, c;
+
+   /* Grid is only valid for the system it was built in. */
+   if (field_grid_sys != cur_system)
+      return space_isInFieldExact( p->x, p->y );
+
+   if (field_grid == NULL)
+      return -1;
+
+   i = (int)floor( (p->x - field_grid_x) / field_grid_cell );
+   j = (int)floor( (p->y - field_grid_y) / field_grid_cell );
+   if ((i < 0) || (j < 0) || (i >= field_grid_w) || (j >= field_grid_h))
+      return -1; /* Outside the bounding box of all fields. */
+
+   c = field_grid[ j*field_grid_w + i ];
+   if (c == FIELD_GRID_BOUNDARY)
+      return space_isInFieldExact( p->x, p->y );
+   return c;
+}
+
+
 /**
  * @brief Returns the asteroid type corresponding to an ID
  *
@@ -4514,6 +4933,25 @@ int system_hasPlanet( const StarSystem *sys )
 }
 
 
+/**
+ * @brief Accounts the presence of a pilot created by a spawn script.
+ *
+ * Only does something from within the scheduler, where the presence is
+ *  added to the faction being spawned so the script doesn't have to return
+ *  it. Pilots created elsewhere don't use up presence, like with pilot.add.
+ *
+ *    @param p Pilot that was spawned.
+ *    @param presence Presence the pilot uses up.
+ */
+void system_addSpawnedPilot( Pilot *p, double presence )
+{
+   if (space_spawning == NULL)
+      return;
+   p->presence = presence;
+   space_spawning->curUsed += presence;
+}
+
+
 /**
  * @brief Removes active presence.
  */
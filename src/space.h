@@ -7,6 +7,8 @@
 #ifndef SPACE_H
 #  define SPACE_H
 
+#include <stdint.h>
+
 typedef struct Planet_ Planet;
 typedef struct JumpPoint_ JumpPoint;
 
@@ -22,6 +24,7 @@ typedef struct JumpPoint_ JumpPoint;
 
 
 #define SYSTEM_SIMULATE_TIME  30. /**< Time to simulate system before player is added. */
+#define SYSTEM_SIMULATE_STEP  (4.*fps_min) /**< Step size of the system simulation. */
 
 #define MAX_HYPERSPACE_VEL    25 /**< Speed to brake to before jumping. */
 
@@ -29,6 +32,31 @@ typedef struct JumpPoint_ JumpPoint;
 #define ASSET_REAL            1 /**< The asset is real. */
 
 
+/*
+ * Known state bitsets.
+ */
+#define SPACE_KNOWN_WORD(id)  ((id) >> 5) /**< Word containing an element's bit. */
+#define SPACE_KNOWN_BIT(id)   (1u << ((id) & 31)) /**< Bit of an element in its word. */
+
+/**
+ * @brief Types of elements tracked by the known bitsets.
+ */
+typedef enum SpaceKnownType_ {
+   SPACE_KNOWN_SYSTEM,  /**< Systems, by system ID. */
+   SPACE_KNOWN_PLANET,  /**< Planets, by planet ID. */
+   SPACE_KNOWN_JUMP,    /**< Jump points, by jump point ID. */
+   SPACE_KNOWN_SENTINEL /**< Number of known bitset types. */
+} SpaceKnownType;
+
+/**
+ * @brief Growable bitset of element identifiers.
+ */
+typedef struct SpaceKnownSet_ {
+   uint32_t *bits; /**< Bits, one per element identifier. */
+   int nwords;     /**< Number of words in bits. */
+} SpaceKnownSet;
+
+
 /* Asteroid status enum */
 enum {
    ASTEROID_VISIBLE,    /**< Asteroid is visible (normal state). */
@@ -178,6 +206,7 @@ typedef struct SystemPresence_ {
 typedef struct JumpPoint_ JumpPoint;
 struct JumpPoint_ {
    StarSystem *from; /**< System containing this jump point. */
+   int id; /**< Unique jump point identifier, used by the known bitsets. */
    int targetid; /**< ID of the target star system. */
    StarSystem *target; /**< Target star system to jump to. */
    JumpPoint *returnJump; /**< How to get back. Can be NULL */
@@ -349,6 +378,7 @@ Planet* planet_getAll( int *n );
 Planet* planet_get( const char* planetname );
 Planet* planet_getIndex( int ind );
 void planet_setKnown( Planet *p );
+void planet_rmKnown( Planet *p );
 int planet_index( const Planet *p );
 int planet_exists( const char* planetname );
 const char *planet_existsCase( const char* planetname );
@@ -374,6 +404,8 @@ int planet_setRadiusFromGFX(Planet* planet);
  */
 JumpPoint* jump_get( const char* jumpname, const StarSystem* sys );
 JumpPoint* jump_getTarget( StarSystem* target, const StarSystem* sys );
+void jp_setKnown( JumpPoint *jp );
+void jp_rmKnown( JumpPoint *jp );
 
 /*
  * system adding/removing stuff.
@@ -406,11 +438,13 @@ double system_getPresence( StarSystem *sys, int faction );
 void system_addAllPlanetsPresence( StarSystem *sys );
 void space_reconstructPresences( void );
 void system_rmCurrentPresence( StarSystem *sys, int faction, double amount );
+void system_addSpawnedPilot( Pilot *p, double presence );
 
 /*
  * update.
  */
 void space_update( const double dt );
+int space_isSimulation (void);
 
 /*
  * Graphics.
@@ -444,6 +478,10 @@ double system_getClosestAng( const StarSystem *sys, int *pnt, int *jp, int *ast,
 int space_addMarker( int sys, SysMarker type );
 int space_rmMarker( int sys, SysMarker type );
 void space_clearKnown (void);
+void sys_setKnown( StarSystem *sys );
+void sys_rmKnown( StarSystem *sys );
+int space_knownSubset( SpaceKnownType type, const uint32_t *mask, int nwords );
+void space_knownMaskAdd( SpaceKnownSet *set, int id );
 void space_clearMarkers (void);
 void space_clearComputerMarkers (void);
 int system_hasPlanet( const StarSystem *sys );
@@ -29,6 +29,7 @@
 #include "nxml.h"
 #include "debris.h"
 #include "perlin.h"
+#include "camera.h"
 
 
 #define SPFX_XML_ID     "spfxs" /**< XML Document tag. */
@@ -45,6 +46,8 @@
 
 #define HAPTIC_UPDATE_INTERVAL   0.1 /**< Time between haptic updates. */
 
+#define SPFX_INST_SIZE  4 /**< Floats per instance: x, y, frame, alpha. */
+
 
 /*
  * special hard-coded special effects
@@ -109,6 +112,17 @@ static int spfx_nstack_back = 0; /**< Number of special effects in back. */
 static int spfx_mstack_back = 0; /**< Memory allocated for special effects in back. */
 
 
+/*
+ * Instanced rendering.
+ */
+static gl_vbo *spfx_instVBO      = NULL; /**< Per-instance data streamed every frame. */
+static GLuint spfx_instTex       = 0; /**< Texture buffer view of spfx_instVBO. */
+static GLfloat *spfx_instData    = NULL; /**< Instance data being built. */
+static int spfx_minstData        = 0; /**< Instances allocated in spfx_instData. */
+static int *spfx_instCount       = NULL; /**< Visible instances per effect. */
+static int *spfx_instOffset      = NULL; /**< First instance of each effect. */
+
+
 /*
  * prototypes
  */
@@ -117,6 +131,10 @@ static int spfx_base_parse( SPFX_Base *temp, const xmlNodePtr parent );
 static void spfx_base_free( SPFX_Base *effect );
 static void spfx_destroy( SPFX *layer, int *nlayer, int spfx );
 static void spfx_update_layer( SPFX *layer, int *nlayer, const double dt );
+/* Rendering. */
+static int spfx_renderInit (void);
+static void spfx_renderFree (void);
+static void spfx_renderInstanced( const SPFX *layer, int nlayer );
 /* Haptic. */
 static int spfx_hapticInit (void);
 static void spfx_hapticRumble( double mod );
@@ -270,10 +288,69 @@ int spfx_load (void)
    spfx_hapticInit();
    shake_noise = noise_new( 1, NOISE_DEFAULT_HURST, NOISE_DEFAULT_LACUNARITY );
 
+   /* Set up instanced rendering. */
+   spfx_renderInit();
+
+   return 0;
+}
+
+
+/**
+ * @brief Sets up the instanced rendering of the special effects.
+ *
+ * Per-instance data is streamed into a VBO and read by the shader through a
+ * texture buffer, which only needs OpenGL 3.1.
+ *
+ *    @return 0 on success.
+ */
+static int spfx_renderInit (void)
+{
+   int n;
+
+   /* Fall back to blitting each sprite if the shader is unavailable. */
+   if (shaders.spfx.program == 0) {
+      WARN(_("SPFX shader unavailable, not using instanced rendering."));
+      return -1;
+   }
+
+   n = MAX( array_size(spfx_effects), 1 );
+   spfx_instCount  = calloc( n, sizeof(int) );
+   spfx_instOffset = calloc( n, sizeof(int) );
+
+   spfx_instVBO = gl_vboCreateStream( sizeof(GLfloat) * SPFX_INST_SIZE * SPFX_CHUNK_MIN, NULL );
+   glGenTextures( 1, &spfx_instTex );
+   glBindTexture( GL_TEXTURE_BUFFER, spfx_instTex );
+   glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA32F, gl_vboID( spfx_instVBO ) );
+   glBindTexture( GL_TEXTURE_BUFFER, 0 );
+
+   gl_checkErr();
+
    return 0;
 }
 
 
+/**
+ * @brief Frees the instanced rendering data.
+ */
+static void spfx_renderFree (void)
+{
+   if (spfx_instTex != 0)
+      glDeleteTextures( 1, &spfx_instTex );
+   spfx_instTex = 0;
+   if (spfx_instVBO != NULL)
+      gl_vboDestroy( spfx_instVBO );
+   spfx_instVBO = NULL;
+
+   free( spfx_instData );
+   spfx_instData = NULL;
+   spfx_minstData = 0;
+   free( spfx_instCount );
+   spfx_instCount = NULL;
+   free( spfx_instOffset );
+   spfx_instOffset = NULL;
+}
+
+
 /**
  * @brief Frees the spfx stack.
  */
@@ -295,6 +372,9 @@ void spfx_free (void)
    spfx_stack_back = NULL;
    spfx_mstack_back = 0;
 
+   /* Free the rendering data. */
+   spfx_renderFree();
+
    /* now clear the effects */
    for (i=0; i<array_size(spfx_effects); i++)
       spfx_base_free( &spfx_effects[i] );
@@ -329,6 +409,10 @@ void spfx_add( int effect,
       return;
    }
 
+   /* Nobody will see it. */
+   if (naev_isFastForward())
+      return;
+
    /*
     * Select the Layer
     */
@@ -567,6 +651,9 @@ void spfx_end (void)
  */
 void spfx_shake( double mod )
 {
+   if (naev_isFastForward())
+      return;
+
    /* Add the modifier. */
    shake_force_mod += mod;
    if (shake_force_mod  > SHAKE_MAX)
@@ -717,18 +804,27 @@ void spfx_render( const int layer )
          return;
    }
 
+   /* Update the frames. */
+   if (!paused) { /* don't calculate frame if paused */
+      for (i=0; i<spfx_nstack; i++) {
+         effect = &spfx_effects[ spfx_stack[i].effect ];
+         sx = (int)effect->gfx->sx;
+         sy = (int)effect->gfx->sy;
+         time = 1. - fmod(spfx_stack[i].timer,effect->anim) / effect->anim;
+         spfx_stack[i].lastframe = sx * sy * MIN(time, 1.);
+      }
+   }
+
+   /* Draw all the effects of a type at once. */
+   if (spfx_instVBO != NULL) {
+      spfx_renderInstanced( spfx_stack, spfx_nstack );
+      return;
+   }
+
    /* Now render the layer */
    for (i=spfx_nstack-1; i>=0; i--) {
       effect = &spfx_effects[ spfx_stack[i].effect ];
-
-      /* Simplifies */
       sx = (int)effect->gfx->sx;
-      sy = (int)effect->gfx->sy;
-
-      if (!paused) { /* don't calculate frame if paused */
-         time = 1. - fmod(spfx_stack[i].timer,effect->anim) / effect->anim;
-         spfx_stack[i].lastframe = sx * sy * MIN(time, 1.);
-      }
 
       /* Renders */
       gl_blitSprite( effect->gfx,
@@ -739,3 +835,113 @@ void spfx_render( const int layer )
    }
 }
 
+
+/**
+ * @brief Renders a layer with one instanced draw call per effect type.
+ *
+ * Effects are grouped by type so they keep their relative order within a
+ * type, the sprite sheet frame is looked up in the shader.
+ *
+ *    @param layer Layer to render.
+ *    @param nlayer Number of effects in the layer.
+ */
+static void spfx_renderInstanced( const SPFX *layer, int nlayer )
+{
+   int i, e, n, neffects;
+   const SPFX_Base *effect;
+   double ox, oy, x, y, w, h, z;
+   GLfloat *inst;
+
+   if (nlayer <= 0)
+      return;
+
+   /* Screen position of the origin, positions are linear from there. */
+   z = cam_getZoom();
+   gl_gameToScreenCoords( &ox, &oy, 0., 0. );
+
+   /* Count the visible effects of each type. */
+   neffects = array_size(spfx_effects);
+   memset( spfx_instCount, 0, neffects*sizeof(int) );
+   for (i=0; i<nlayer; i++) {
+      effect = &spfx_effects[ layer[i].effect ];
+      w = effect->gfx->sw*z;
+      h = effect->gfx->sh*z;
+      x = ox + (VX(layer[i].pos) - effect->gfx->sw/2.)*z;
+      y = oy + (VY(layer[i].pos) - effect->gfx->sh/2.)*z;
+      if ((x < -w) || (x > SCREEN_W+w) ||
+            (y < -h) || (y > SCREEN_H+h))
+         continue;
+      spfx_instCount[ layer[i].effect ]++;
+   }
+
+   /* Lay out the instances of each type contiguously. */
+   n = 0;
+   for (e=0; e<neffects; e++) {
+      spfx_instOffset[e] = n;
+      n += spfx_instCount[e];
+   }
+   if (n == 0)
+      return;
+   if (spfx_minstData < n) {
+      spfx_minstData = MAX( n, 2*spfx_minstData );
+      spfx_instData = realloc( spfx_instData,
+            spfx_minstData * SPFX_INST_SIZE * sizeof(GLfloat) );
+   }
+
+   /* Fill in back to front like the sprite path. */
+   memset( spfx_instCount, 0, neffects*sizeof(int) );
+   for (i=nlayer-1; i>=0; i--) {
+      e = layer[i].effect;
+      effect = &spfx_effects[ e ];
+      w = effect->gfx->sw*z;
+      h = effect->gfx->sh*z;
+      x = ox + (VX(layer[i].pos) - effect->gfx->sw/2.)*z;
+      y = oy + (VY(layer[i].pos) - effect->gfx->sh/2.)*z;
+      if ((x < -w) || (x > SCREEN_W+w) ||
+            (y < -h) || (y > SCREEN_H+h))
+         continue;
+      inst = &spfx_instData[ SPFX_INST_SIZE * (spfx_instOffset[e] + spfx_instCount[e]) ];
+      inst[0] = x;
+      inst[1] = y;
+      inst[2] = layer[i].lastframe;
+      inst[3] = 1.;
+      spfx_instCount[e]++;
+   }
+
+   /* Upload the instances, orphaning last frame's data. */
+   gl_vboData( spfx_instVBO, n * SPFX_INST_SIZE * sizeof(GLfloat), spfx_instData );
+
+   /* Set up the program. */
+   glUseProgram( shaders.spfx.program );
+   glActiveTexture( GL_TEXTURE1 );
+   glBindTexture( GL_TEXTURE_BUFFER, spfx_instTex );
+   glActiveTexture( GL_TEXTURE0 );
+   glUniform1i( shaders.spfx.instances, 1 );
+   gl_Matrix4_Uniform( shaders.spfx.projection, gl_view_matrix );
+   glEnableVertexAttribArray( shaders.spfx.vertex );
+   gl_vboActivateAttribOffset( gl_squareVBO, shaders.spfx.vertex,
+         0, 2, GL_FLOAT, 0 );
+
+   /* One draw per effect type. */
+   for (e=0; e<neffects; e++) {
+      if (spfx_instCount[e] == 0)
+         continue;
+      effect = &spfx_effects[e];
+      glBindTexture( GL_TEXTURE_2D, effect->gfx->texture );
+      glUniform2f( shaders.spfx.dims, effect->gfx->sw*z, effect->gfx->sh*z );
+      glUniform2f( shaders.spfx.sprites, effect->gfx->sx, effect->gfx->sy );
+      glUniform2f( shaders.spfx.tex_dims, effect->gfx->srw, effect->gfx->srh );
+      glUniform1i( shaders.spfx.offset, spfx_instOffset[e] );
+      glDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, spfx_instCount[e] );
+   }
+
+   /* Clear state. */
+   glDisableVertexAttribArray( shaders.spfx.vertex );
+   glActiveTexture( GL_TEXTURE1 );
+   glBindTexture( GL_TEXTURE_BUFFER, 0 );
+   glActiveTexture( GL_TEXTURE0 );
+   glUseProgram(0);
+
+   /* anything failed? */
+   gl_checkErr();
+}
@@ -2,274 +2,351 @@
  * See Licensing and Copyright notice in threadpool.h
  */
 /*
- * @brief A simple threadpool implementation using a single queue.
+ * @brief A work-stealing threadpool.
  *
- * The queue is inspired by this paper (look for the queue with two locks):
+ * There is one worker per hardware thread, each with its own deque of jobs.
+ *  Workers push and pop jobs at the bottom of their own deque, and when it is
+ *  empty they steal from the top of the deques of the other workers. Jobs
+ *  submitted from threads that are not workers go into a shared injection
+ *  deque that everyone steals from.
  *
- * Maged M. Michael and Michael L. Scott. 1998. Nonblocking algorithms and
- * preemption-safe locking on multiprogrammed shared memory multiprocessors. J.
- * Parallel Distrib. Comput. 51, 1 (May 1998), 1-26. DOI=10.1006/jpdc.1998.1446
- * http://dx.doi.org/10.1006/jpdc.1998.1446
+ * A single counting semaphore keeps track of how many jobs are queued, so
+ *  idle workers sleep on it instead of spinning. Anyone taking a job must first
+ *  take a unit from the semaphore, which guarantees there is a job for them
+ *  somewhere in the deques.
  *
- * @ARTICLE{Michael98non-blockingalgorithms,
- *    author = {Maged M. Michael and Michael L. Scott},
- *    title = {Non-Blocking Algorithms and Preemption-Safe Locking on Multiprogrammed Shared Memory Multiprocessors},
- *    journal = {Journal of Parallel and Distributed Computing},
- *    year = {1998},
- *    volume = {51},
- *    pages = {1--26},
- * }
+ * Threads waiting on a ThreadGroup run queued jobs while they wait, so groups
+ *  can be waited on from inside jobs without deadlocking the pool.
  *
- * @note The algorithm/strategy for killing idle workers should be moved into
- *       the threadhandler and it should also be improved (the current strategy
- *       is probably not very good).
+ * Job nodes are never freed, they are recycled through a free list.
  */
 
 
 #include "threadpool.h"
 
 #include "SDL.h"
+#include "SDL_atomic.h"
 #include "SDL_error.h"
 #include "SDL_thread.h"
 
 #include <stdlib.h>
+#include <string.h>
 
+#include "naev.h"
 #include "log.h"
 
 
-#define THREADPOOL_TIMEOUT (5 * 100) /* The time a worker thread waits in ms. */
-#define THREADSIG_STOP     (1) /* The signal to stop a worker thread */
-#define THREADSIG_RUN      (0) /* The signal to indicate the worker thread is running */
+#define THREADPOOL_TIMEOUT    10 /* Time to sleep in ms when waiting on a group with nothing to do. */
+#define THREADDEQUE_SIZE      64 /* Initial size of the deques, must be a power of two. */
+#define THREADJOB_CHUNK       64 /* Number of job nodes allocated at once. */
 
 
 /**
- * Threads to use.
+ * @brief A job to be run by the threadpool.
  */
-static int MAXTHREADS = 8; /* Bit overkill, but oh well. */
-
+typedef struct ThreadJob_ {
+   int (*function)(void *);   /* The function to be called */
+   void *data;                /* And its arguments */
+   ThreadGroup *group;        /* Group the job belongs to, or NULL. */
+   struct ThreadJob_ *next;   /* Next job in the free list. */
+} ThreadJob;
 
 /**
- * @brief Node in the thread queue.
+ * @brief Double ended queue of jobs.
+ *
+ * The owner uses the bottom, thieves use the top.
  */
-typedef struct Node_ {
-   void *data;          /* The element in the list */
-   struct Node_ *next;  /* The next node in the list */
-} Node;
+typedef struct ThreadDeque_ {
+   SDL_SpinLock lock;   /* Protects everything below. */
+   ThreadJob **buf;     /* Ring buffer of jobs. */
+   unsigned int mask;   /* Size of the buffer minus one. */
+   unsigned int top;    /* Next job to steal. */
+   unsigned int bottom; /* Next free position. */
+} ThreadDeque;
 
 /**
- * @brief Threadqueue itself.
+ * @brief A worker thread.
  */
-struct ThreadQueue_ {
-   Node *first;         /* The first node */
-   Node *last;          /* The second node */
-   /* A semaphore to ensure reads only happen when the queue is not empty */
-   SDL_sem *semaphore;
-   SDL_mutex *t_lock;   /* Tail lock. Lock when reading/updating tail */
-   SDL_mutex *h_lock;   /* Same as tail lock, except it's head lock */
-};
+typedef struct ThreadWorker_ {
+   int id;              /* Index of the worker, also of its deque. */
+   unsigned int seed;   /* Seed for choosing whom to steal from. */
+   SDL_Thread *thread;  /* The thread itself. */
+} ThreadWorker;
 
 /**
- * @brief Data for the threadqueue.
+ * @brief A group of jobs that can be waited on.
  */
-typedef struct ThreadQueueData_ {
-   int (*function)(void *);  /* The function to be called */
-   void *data;               /* And its arguments */
-} ThreadQueueData;
+struct ThreadGroup_ {
+   SDL_SpinLock lock;         /* Protects everything below. */
+   int pending;               /* Jobs in the group that haven't finished. */
+   int finished;              /* All the jobs added so far have finished. */
+   int (*cont)(void *);       /* Continuation to run when finished. */
+   void *cont_data;           /* Arguments of the continuation. */
+   SDL_sem *done;             /* Posted when the group finishes. */
+};
 
 /**
- * @brief Thread data.
- */
-typedef struct ThreadData_ {
-   int (*function)(void *); /* The function to be called */
-   void *data;             /* Arguments to the above function */
-   int signal;             /* Signals to the thread */
-   SDL_sem *semaphore;     /* The semaphore to signal new jobs or new signal in the
-                              'signal' variable */
-   ThreadQueue *idle;      /* The queue with idle threads */
-   ThreadQueue *stopped;   /* The queue with stopped threads */
-} ThreadData;
+ * @brief Virtual thread pool, just a group under the hood.
+ */
+struct ThreadQueue_ {
+   ThreadGroup *group;  /* Group the jobs get run in. */
+};
 
 /**
- * @brief Virtual thread pool data.
+ * @brief A chunk of a parallel for.
  */
-typedef struct vpoolThreadData_ {
-   SDL_cond *cond;         /* Condition variable for signalling all jobs in the vpool
-                              are done */
-   SDL_mutex *mutex;       /* The mutex to use with the above condition variable */
-   int *count;             /* Variable to count number of finished jobs in the vpool */
-   ThreadQueueData *node;  /* The job to be done */
-} vpoolThreadData;
+typedef struct ThreadRange_ {
+   int start;           /* First index. */
+   int end;             /* Index after the last. */
+   void (*function)( int start, int end, void *data ); /* Function to run. */
+   void *data;          /* Arguments of the function. */
+} ThreadRange;
+
 
-/* The global threadpool queue */
-static ThreadQueue *global_queue = NULL;
+/*
+ * The pool.
+ */
+static int tp_nworkers           = 0;     /* Number of workers. */
+static ThreadWorker *tp_workers  = NULL;  /* The workers. */
+static ThreadDeque *tp_deques    = NULL;  /* Worker deques followed by the injection deque. */
+static SDL_sem *tp_jobs          = NULL;  /* Counts the queued jobs. */
+static SDL_TLSID tp_self         = 0;     /* Worker of the current thread. */
+/* Job node pool. */
+static SDL_SpinLock tp_free_lock = 0;     /* Protects the free list. */
+static ThreadJob *tp_free        = NULL;  /* Free job nodes. */
 
 
 /*
  * Prototypes.
  */
-static ThreadQueue* tq_create (void);
-static void tq_enqueue( ThreadQueue *q, void *data );
-static void* tq_dequeue( ThreadQueue *q );
-static void tq_destroy( ThreadQueue *q );
+static void td_init( ThreadDeque *d );
+static void td_push( ThreadDeque *d, ThreadJob *job );
+static ThreadJob* td_pop( ThreadDeque *d );
+static ThreadJob* td_steal( ThreadDeque *d );
+static ThreadJob* tj_alloc (void);
+static void tj_free( ThreadJob *job );
+static void tp_submit( ThreadJob *job );
+static ThreadJob* tp_find (void);
+static int tp_runOne( int block );
 static int threadpool_worker( void *data );
-static int threadpool_handler( void *data );
-static int vpool_worker( void *data );
+static void tgroup_jobDone( ThreadGroup *g );
+static int threadpool_rangeWorker( void *data );
 
 
 /**
- * @brief Creates a concurrent queue.
- *
- * The basic concept is that we have a separate lock for both head and tail, so
- *  we can operate separately on either head or tail. This lets us enqueue at
- *  tail and dequeue at the head in true FIFO fashion.
+ * @brief Initializes a deque.
  *
- *    @return The ThreadQueue.
+ *    @param d Deque to initialize.
  */
-static ThreadQueue* tq_create (void)
+static void td_init( ThreadDeque *d )
 {
-   ThreadQueue *q;
-   Node *n;
-
-   /* Queue memory allocation. */
-   q        = calloc( 1, sizeof(ThreadQueue) );
+   memset( d, 0, sizeof(ThreadDeque) );
+   d->buf   = malloc( THREADDEQUE_SIZE * sizeof(ThreadJob*) );
+   d->mask  = THREADDEQUE_SIZE-1;
+}
 
-   /* Allocate and insert the dummy node */
-   n        = calloc( 1, sizeof(Node) );
-   n->next  = NULL;
-   q->first = n;
-   q->last  = n;
+/**
+ * @brief Pushes a job at the bottom of a deque, growing it if needed.
+ *
+ *    @param d Deque to push to.
+ *    @param job Job to push.
+ */
+static void td_push( ThreadDeque *d, ThreadJob *job )
+{
+   unsigned int i, n;
+   ThreadJob **buf;
+
+   SDL_AtomicLock( &d->lock );
+   n = d->bottom - d->top;
+   if (n > d->mask) {
+      /* Full, double the size keeping the order. */
+      buf = malloc( 2 * (d->mask+1) * sizeof(ThreadJob*) );
+      for (i=0; i<n; i++)
+         buf[i] = d->buf[ (d->top+i) & d->mask ];
+      free( d->buf );
+      d->buf     = buf;
+      d->mask    = 2*(d->mask+1) - 1;
+      d->top     = 0;
+      d->bottom  = n;
+   }
+   d->buf[ d->bottom & d->mask ] = job;
+   d->bottom++;
+   SDL_AtomicUnlock( &d->lock );
+}
 
-   /* Create locks. */
-   q->t_lock      = SDL_CreateMutex();
-   q->h_lock      = SDL_CreateMutex();
-   q->semaphore   = SDL_CreateSemaphore( 0 );
+/**
+ * @brief Pops the most recently pushed job of a deque.
+ *
+ *    @param d Deque to pop from.
+ *    @return The job or NULL if empty.
+ */
+static ThreadJob* td_pop( ThreadDeque *d )
+{
+   ThreadJob *job;
+
+   SDL_AtomicLock( &d->lock );
+   if (d->bottom == d->top)
+      job = NULL;
+   else {
+      d->bottom--;
+      job = d->buf[ d->bottom & d->mask ];
+   }
+   SDL_AtomicUnlock( &d->lock );
 
-   return q;
+   return job;
 }
 
 /**
- * @brief Enqueue data to the ThreadQueue q.
+ * @brief Steals the oldest job of a deque.
  *
- *    @param q The queue to be inserted into.
- *    @param data The element to be stored in the queue.
+ *    @param d Deque to steal from.
+ *    @return The job or NULL if empty.
  */
-static void tq_enqueue( ThreadQueue *q, void *data )
+static ThreadJob* td_steal( ThreadDeque *d )
 {
-   Node *n;
+   ThreadJob *job;
+
+   SDL_AtomicLock( &d->lock );
+   if (d->bottom == d->top)
+      job = NULL;
+   else {
+      job = d->buf[ d->top & d->mask ];
+      d->top++;
+   }
+   SDL_AtomicUnlock( &d->lock );
 
-   /* Allocate new struct. */
-   n        = calloc( 1, sizeof(Node) );
-   n->data  = data;
-   n->next  = NULL;
+   return job;
+}
 
-   /* Lock */
-   SDL_mutexP( q->t_lock );
 
-   /* Enqueue. */
-   q->last->next  = n;
-   q->last        = n;
+/**
+ * @brief Gets a job node from the pool.
+ *
+ *    @return A new job node.
+ */
+static ThreadJob* tj_alloc (void)
+{
+   int i;
+   ThreadJob *job;
+
+   SDL_AtomicLock( &tp_free_lock );
+   if (tp_free == NULL) {
+      /* Allocate a new chunk of nodes and thread them into the free list. */
+      job = malloc( THREADJOB_CHUNK * sizeof(ThreadJob) );
+      for (i=0; i<THREADJOB_CHUNK-1; i++)
+         job[i].next = &job[i+1];
+      job[THREADJOB_CHUNK-1].next = NULL;
+      tp_free = job;
+   }
+   job      = tp_free;
+   tp_free  = job->next;
+   SDL_AtomicUnlock( &tp_free_lock );
 
-   /* Signal and unlock. This wil break if someone tries to enqueue 2^32+1
-    * elements or something. */
-   SDL_SemPost( q->semaphore );
-   SDL_mutexV( q->t_lock );
+   return job;
 }
 
 /**
- * @brief Dequeue from the ThreadQueue q.
- *
- * @attention The callee should ALWAYS have called SDL_SemWait() on the semaphore.
+ * @brief Returns a job node to the pool.
  *
- *    @param q The queue to dequeue from.
- *    @return A void pointer to the element from the queue.
+ *    @param job Job node to return.
  */
-static void* tq_dequeue( ThreadQueue *q )
+static void tj_free( ThreadJob *job )
 {
-   void *d;
-   Node *newhead, *node;
-
-   /* Lock the head. */
-   SDL_mutexP( q->h_lock );
-
-   /* Start running. */
-   node     = q->first;
-   newhead  = node->next;
-
-   /* Head not consistent. */
-   if (newhead == NULL) {
-      WARN(_("Tried to dequeue while the queue was empty!"));
-      /* Ugly fix :/ */
-      /*
-      SDL_mutexV(q->h_lock);
-      return NULL;
-      */
-      /* We prefer to wait until the cache updates :/ */
-      do {
-         node     = q->first;
-         newhead  = node->next;
-      } while (newhead == NULL);
-   }
+   SDL_AtomicLock( &tp_free_lock );
+   job->next   = tp_free;
+   tp_free     = job;
+   SDL_AtomicUnlock( &tp_free_lock );
+}
 
-   /* Remember the value and assign newhead as the new dummy element. */
-   d        = newhead->data;
-   q->first = newhead;
 
-   /* Unlock */
-   SDL_mutexV( q->h_lock );
+/**
+ * @brief Queues a job, in the current worker's deque if possible.
+ *
+ *    @param job Job to queue.
+ */
+static void tp_submit( ThreadJob *job )
+{
+   ThreadWorker *self;
 
-   free( node );
-   return d;
+   self = SDL_TLSGet( tp_self );
+   if (self != NULL)
+      td_push( &tp_deques[ self->id ], job );
+   else
+      td_push( &tp_deques[ tp_nworkers ], job );
+
+   /* Must be done after pushing, a unit of the semaphore means a job exists. */
+   SDL_SemPost( tp_jobs );
 }
 
 /**
- * @brief Destroys and frees a ThreadQueue.
+ * @brief Finds a queued job.
  *
- * Frees all elements too.
+ * Only call after taking a unit from tp_jobs, or it may never return.
  *
- *    @param q The ThreadQueue to free.
+ *    @return The job found.
  */
-static void tq_destroy( ThreadQueue *q )
+static ThreadJob* tp_find (void)
 {
-   /* Iterate through the list and free the nodes */
-   while (q->first->next != NULL)
-      free( tq_dequeue(q) ); /* Locks q->t_lock, so we must destroy mutex after. */
+   int i, j;
+   ThreadWorker *self;
+   ThreadJob *job;
 
-   /* Clean up threading structures. */
-   SDL_DestroySemaphore( q->semaphore );
-   SDL_DestroyMutex( q->h_lock );
-   SDL_DestroyMutex( q->t_lock );
+   self = SDL_TLSGet( tp_self );
+   while (1) {
+      /* Own work first, most recent first as it's likely still in cache. */
+      if (self != NULL) {
+         job = td_pop( &tp_deques[ self->id ] );
+         if (job != NULL)
+            return job;
+      }
 
-   free( q->first );
-   free( q );
-}
+      /* Then jobs coming from outside. */
+      job = td_steal( &tp_deques[ tp_nworkers ] );
+      if (job != NULL)
+         return job;
 
+      /* Finally steal from the other workers, starting at a random one. */
+      i = 0;
+      if (self != NULL) {
+         self->seed = self->seed*1103515245 + 12345;
+         i = (self->seed >> 16) % tp_nworkers;
+      }
+      for (j=0; j<tp_nworkers; j++) {
+         job = td_steal( &tp_deques[ (i+j) % tp_nworkers ] );
+         if (job != NULL)
+            return job;
+      }
+   }
+}
 
 /**
- * @brief Enqueues a new job for the threadpool.
- *
- * @warning Do NOT enqueue a job that has to wait for another job to be done as
- *          this could lead to a deadlock.
+ * @brief Takes a queued job and runs it.
  *
- *    @param function The function (job) to be called (executed).
- *    @param data The arguments for the function.
- *    @return Returns 0 on success and -2 if there was no threadpool.
+ *    @param block Whether to sleep until there is a job.
+ *    @return 0 if a job was run, -1 if there were none.
  */
-int threadpool_newJob( int (*function)(void *), void *data )
+static int tp_runOne( int block )
 {
-   ThreadQueueData *node;
+   ThreadJob *job;
+   ThreadGroup *group;
 
-   if (global_queue == NULL) {
-      WARN(_("Threadpool has not been initialized yet!"));
-      return -2;
+   if (block) {
+      while (SDL_SemWait( tp_jobs ) == -1)
+         WARN(_("SDL_SemWait failed! Error: %s"), SDL_GetError());
    }
+   else if (SDL_SemTryWait( tp_jobs ) != 0)
+      return -1;
 
-   /* Allocate and set parameters. */
-   node           = calloc( 1, sizeof(ThreadQueueData) );
-   node->data     = data;
-   node->function = function;
+   job = tp_find();
 
-   /* Actually enque. */
-   tq_enqueue( global_queue, node );
+   /* Run and recycle. */
+   group = job->group;
+   job->function( job->data );
+   tj_free( job );
+
+   /* Let the group know. */
+   if (group != NULL)
+      tgroup_jobDone( group );
 
    return 0;
 }
@@ -277,339 +354,335 @@ int threadpool_newJob( int (*function)(void *), void *data )
 /**
  * @brief The worker function for the threadpool.
  *
- * It waits for a signal from the handler. If it receives THREADSIG_STOP it
- *  means the worker thread should stop. Else it dequeues a job from the
- *  global_queue and executes it.
- *
- *    @param data A pointer to the ThreadData struct used for a lot of stuff.
+ *    @param data The ThreadWorker of the thread.
  */
 static int threadpool_worker( void *data )
 {
-   ThreadData *work;
+   SDL_TLSSet( tp_self, data, NULL );
 
-   work = (ThreadData*) data;
+   /* Work loop, sleeps when there's nothing to do. */
+   while (1)
+      tp_runOne( 1 );
 
-   /* Work loop */
-   while (1) {
-      /* Wait for new signal */
-      while (SDL_SemWait( work->semaphore ) == -1) {
-          /* Putting this in a while-loop is probably a really bad idea, but I
-           * don't have any better ideas. */
-          WARN(_("SDL_SemWait failed! Error: %s"), SDL_GetError());
-      }
-      /* Break if received signal to stop */
-      if (work->signal == THREADSIG_STOP)
-         break;
+   /** @TODO A way to stop the threadpool. */
+   return 0;
+}
+
+
+/**
+ * @brief Initialize the global threadpool.
+ *
+ *    @return Returns 0 on success and -1 if there's already a threadpool.
+ */
+int threadpool_init (void)
+{
+   int i;
 
-      /* Do work :-) */
-      work->function( work->data );
+   /* There's already a pool */
+   if (tp_workers != NULL) {
+      WARN(_("Threadpool has already been initialized!"));
+      return -1;
+   }
 
-      /* Enqueue itself in the idle worker threads queue */
-      tq_enqueue( work->idle, work );
+   /* One worker per hardware thread. */
+   tp_nworkers = MAX( 1, SDL_GetCPUCount() );
+
+   /* Worker deques plus the injection deque. */
+   tp_deques   = calloc( tp_nworkers+1, sizeof(ThreadDeque) );
+   for (i=0; i<tp_nworkers+1; i++)
+      td_init( &tp_deques[i] );
+   tp_jobs     = SDL_CreateSemaphore( 0 );
+   tp_self     = SDL_TLSCreate();
+
+   /* Start the workers. */
+   tp_workers  = calloc( tp_nworkers, sizeof(ThreadWorker) );
+   for (i=0; i<tp_nworkers; i++) {
+      tp_workers[i].id     = i;
+      tp_workers[i].seed   = i+1;
+      tp_workers[i].thread = SDL_CreateThread( threadpool_worker,
+            "threadpool_worker", &tp_workers[i] );
+      if (tp_workers[i].thread == NULL) {
+         ERR( _( "Threadpool init failed: %s" ), SDL_GetError() );
+         return -1;
+      }
+      SDL_DetachThread( tp_workers[i].thread );
    }
-   /* Enqueue itself in the stopped worker threads queue when stopped */
-   tq_enqueue( work->stopped, work );
 
    return 0;
 }
 
 /**
- * @brief Handles assigning jobs to the workers and killing them if necessary.
- *
- * @note Stopping the threeadpool_handler is not yet implemented.
- *
- * Process is:
+ * @brief Gets the number of worker threads.
  *
- * 1) Wait for job
- * 2) if Timed out -> kill idle, putting on stopped, go to 1)
- * 3) Have thread run job
- * 3.1) Grab a job from the queue
- * 3.2) If idle thread, grab idle thread
- *      else if stopped threads, reactivate stopped thread
- *      else wait for running thread
- * 4) Go to 1)
+ *    @return The number of worker threads.
+ */
+int threadpool_nworkers (void)
+{
+   return tp_nworkers;
+}
+
+/**
+ * @brief Enqueues a new job for the threadpool.
  *
- *    @param data Not used. SDL threading requires functions to take a void
- *                pointer as argument.
- *    @return Not really implemented yet.
+ *    @param function The function (job) to be called (executed).
+ *    @param data The arguments for the function.
+ *    @return Returns 0 on success and -2 if there was no threadpool.
  */
-static int threadpool_handler( void *data )
+int threadpool_newJob( int (*function)(void *), void *data )
 {
-   (void) data;
-   int i, nrunning, newthread;
-   ThreadData *threadargs, *threadarg;
-   /* Queues for idle workers and stopped workers */
-   ThreadQueue *idle, *stopped;
-   ThreadQueueData *node;
-
-   /* Initialize the idle and stopped queues. */
-   idle     = tq_create();
-   stopped  = tq_create();
-
-   /* Allocate threadargs to communicate with workers */
-   threadargs = calloc( MAXTHREADS, sizeof(ThreadData) );
-
-   /* Initialize threadargs */
-   for (i=0; i<MAXTHREADS; i++) {
-      threadargs[i].function  = NULL;
-      threadargs[i].data      = NULL;
-      threadargs[i].semaphore = SDL_CreateSemaphore( 0 ); /* Used to give orders. */
-      threadargs[i].idle      = idle;
-      threadargs[i].stopped   = stopped;
-      threadargs[i].signal    = THREADSIG_RUN;
-      /* 'Workers' that do not have a thread are considered stopped */
-      tq_enqueue( stopped, &threadargs[i] );
-   }
+   ThreadJob *job;
 
-   /* Set the number of running threads to 0 */
-   nrunning = 0;
+   if (tp_workers == NULL) {
+      WARN(_("Threadpool has not been initialized yet!"));
+      return -2;
+   }
 
-   /*
-    * Thread handler main loop.
-    */
-   while (1) {
-      /*
-       * We must now wait, this shall be done on each active thread. However they will
-       * be put to sleep as time passes. When we receive a command we'll proceed to process
-       * it.
-       */
-      if (nrunning > 0) {
-         /*
-          * Here we'll wait until thread gets work to do. If it doesn't it will
-          * just stop a worker thread and wait until it gets something to do.
-          */
-         if (SDL_SemWaitTimeout( global_queue->semaphore, THREADPOOL_TIMEOUT ) != 0) {
-            /* There weren't any new jobs so we'll start killing threads ;) */
-            if (SDL_SemTryWait( idle->semaphore ) == 0) {
-               threadarg         = tq_dequeue( idle );
-               /* Set signal to stop worker thread */
-               threadarg->signal = THREADSIG_STOP;
-               /* Signal thread and decrement running threads counter */
-               SDL_SemPost( threadarg->semaphore );
-               nrunning -= 1;
-            }
-
-            /* We just go back to waiting on a thread. */
-            continue;
-         }
-
-         /* We got work. Continue to handle work. */
-      }
-      else {
-         /*
-          * Here we wait for a new job. No threads are alive at this point and the
-          * threadpool is just patiently waiting for work to arrive.
-          */
-         if (SDL_SemWait( global_queue->semaphore ) == -1) {
-             WARN(_("SDL_SemWait failed! Error: %s"), SDL_GetError());
-             continue;
-         }
-
-         /* We got work. Continue to handle work. */
-      }
+   job            = tj_alloc();
+   job->function  = function;
+   job->data      = data;
+   job->group     = NULL;
+   tp_submit( job );
 
-      /*
-       * Get a new job from the queue. This should be safe as we have received
-       * a permission from the global_queue->semaphore.
-       */
-      node        = tq_dequeue( global_queue );
-      newthread   = 0;
-
-      /*
-       * Choose where to get the thread. Either idle, revive stopped or block until
-       * another thread becomes idle.
-       */
-      /* Idle thread available */
-      if (SDL_SemTryWait(idle->semaphore) == 0)
-         threadarg         = tq_dequeue( idle );
-      /* Make a new thread */
-      else if (SDL_SemTryWait(stopped->semaphore) == 0) {
-         threadarg         = tq_dequeue( stopped );
-         threadarg->signal = THREADSIG_RUN;
-         newthread         = 1;
-      }
-      /* Wait for idle thread */
-      else {
-         while (SDL_SemWait(idle->semaphore) == -1) {
-             /* Bad idea */
-             WARN(_("SDL_SemWait failed! Error: %s"), SDL_GetError());
-         }
-         threadarg         = tq_dequeue( idle );
-      }
+   return 0;
+}
 
-      /* Assign arguments for the thread */
-      threadarg->function  = node->function;
-      threadarg->data      = node->data;
-      /* Signal the thread that there's a new job */
-      SDL_SemPost( threadarg->semaphore );
-
-      /* Start a new thread and increment the thread counter */
-      if (newthread) {
-         SDL_CreateThread( threadpool_worker,
-               "threadpool_worker",
-               threadarg );
-         nrunning += 1;
-      }
 
-      /* Free the now unused job from the global_queue */
-      free(node);
-   }
-   /** @TODO A way to stop the threadpool. */
+/**
+ * @brief Creates a new job group.
+ *
+ *    @return The new group.
+ */
+ThreadGroup* tgroup_create (void)
+{
+   ThreadGroup *g;
 
-   /* Clean up. */
-   tq_destroy( idle );
-   tq_destroy( stopped );
-   free( threadargs );
+   g           = calloc( 1, sizeof(ThreadGroup) );
+   g->finished = 1; /* Nothing to wait for yet. */
+   g->done     = SDL_CreateSemaphore( 0 );
 
-   return 0;
+   return g;
 }
 
 /**
- * @brief Initialize the global threadpool.
+ * @brief Runs a job as part of a group.
  *
- *    @return Returns 0 on success and -1 if there's already a threadpool.
+ * Unlike with threadpool_newJob() the job may wait on other groups, as
+ *  waiting threads run queued jobs in the meantime.
+ *
+ *    @param g Group to add the job to.
+ *    @param function The function (job) to be called (executed).
+ *    @param data The arguments for the function.
  */
-int threadpool_init (void)
+void tgroup_run( ThreadGroup *g, int (*function)(void *), void *data )
 {
-   MAXTHREADS = SDL_GetCPUCount() + 1; /* SDL 1.3 is pretty cool. */
+   ThreadJob *job;
 
-   /* There's already a queue */
-   if (global_queue != NULL) {
-      WARN(_("Threadpool has already been initialized!"));
-      return -1;
+   /* No pool, just run it. */
+   if (tp_workers == NULL) {
+      function( data );
+      return;
    }
 
-   /* Create the global queue queue */
-   global_queue = tq_create();
+   SDL_AtomicLock( &g->lock );
+   g->finished = 0;
+   g->pending++;
+   SDL_AtomicUnlock( &g->lock );
 
-   /* Initialize the threadpool handler. */
-   if ( SDL_CreateThread( threadpool_handler, "threadpool_handler", NULL ) == NULL ) {
-      ERR( _( "Threadpool init failed: %s" ), SDL_GetError() );
-      return -1;
+   job            = tj_alloc();
+   job->function  = function;
+   job->data      = data;
+   job->group     = g;
+   tp_submit( job );
+}
+
+/**
+ * @brief Sets a job to run once all the jobs of a group finished.
+ *
+ * If the group has already finished the job is queued right away. Only one
+ *  continuation can be set at a time.
+ *
+ *    @param g Group to set the continuation of.
+ *    @param function The function (job) to be called (executed).
+ *    @param data The arguments for the function.
+ */
+void tgroup_then( ThreadGroup *g, int (*function)(void *), void *data )
+{
+   int finished;
+
+   SDL_AtomicLock( &g->lock );
+   finished = g->finished;
+   if (!finished) {
+      g->cont        = function;
+      g->cont_data   = data;
    }
+   SDL_AtomicUnlock( &g->lock );
 
-   return 0;
+   if (finished && (threadpool_newJob( function, data ) != 0))
+      function( data );
 }
 
 /**
- * @brief Creates a new vpool queue.
- *
- * This is just an interface to make running a number of jobs and then wait for
- *  them to finish more pleasant. You should not nest vpools as of now as there
- *  are only a limit number of worker threads and we can't have them wait for a
- *  thread to finish that doesn't exist.
+ * @brief Notifies a group that one of its jobs is done.
  *
- * If you really want to sort of nest vpools, you should start a new thread
- *  instead of using the threadpool. I might add a vpool_waitInANewThread
- *  function some day.
+ * Everything is done under the lock: the group may be freed by a waiter as
+ *  soon as it is released.
  *
- *    @return Returns a ThreadQueue to be used.
+ *    @param g Group the job belonged to.
  */
-ThreadQueue* vpool_create (void)
+static void tgroup_jobDone( ThreadGroup *g )
 {
-   return tq_create();
+   int (*cont)(void *);
+   void *cont_data;
+
+   SDL_AtomicLock( &g->lock );
+   if (--g->pending > 0) {
+      SDL_AtomicUnlock( &g->lock );
+      return;
+   }
+   cont        = g->cont;
+   cont_data   = g->cont_data;
+   g->cont     = NULL;
+   g->finished = 1;
+   SDL_SemPost( g->done );
+   SDL_AtomicUnlock( &g->lock );
+
+   if (cont != NULL)
+      threadpool_newJob( cont, cont_data );
 }
 
 /**
- * @brief Enqueue a job in the vpool queue.
+ * @brief Blocks until all the jobs of a group are done.
  *
- * @warning Do NOT enqueue jobs that wait for another job to be done, as this
- *          could lead to a deadlock.
+ * Runs queued jobs while waiting, so it is safe to call from within a job.
  *
- * @warning Do NOT enqueue jobs that wait for a vpool, as this could lead to a
- *          deadlock.
+ *    @param g Group to wait on.
  */
-void vpool_enqueue( ThreadQueue *queue, int (*function)(void *), void *data )
+void tgroup_wait( ThreadGroup *g )
 {
-   ThreadQueueData *node;
+   int finished;
 
-   /* Allocate and set up data. */
-   node           = calloc( 1, sizeof(ThreadQueueData) );
-   node->data     = data;
-   node->function = function;
+   while (1) {
+      SDL_AtomicLock( &g->lock );
+      finished = g->finished;
+      SDL_AtomicUnlock( &g->lock );
+      if (finished)
+         break;
 
-   /* Add to vpool. */
-   tq_enqueue( queue, node );
+      /* Help out, otherwise sleep a bit. */
+      if (tp_runOne( 0 ) != 0)
+         SDL_SemWaitTimeout( g->done, THREADPOOL_TIMEOUT );
+   }
 }
 
 /**
- * @brief A special vpool worker that signals the waiting thread when all jobs
- *        are done.
+ * @brief Frees a group.
+ *
+ * @note The group must not have any jobs still running.
  *
- * It uses a mutex+condition variable+counter.
+ *    @param g Group to free.
  */
-static int vpool_worker( void *data )
+void tgroup_free( ThreadGroup *g )
 {
-   int cnt;
-   vpoolThreadData *work;
-
-   work = (vpoolThreadData*) data;
-
-   /* Do work */
-   work->node->function( work->node->data );
+   if (g == NULL)
+      return;
+   SDL_DestroySemaphore( g->done );
+   free( g );
+}
 
-   /* Decrement the counter and signal vpool_wait if all threads are done */
-   SDL_mutexP( work->mutex );
-   cnt   = *(work->count) - 1;
-   if (cnt <= 0)                    /* All jobs done. */
-      SDL_CondSignal( work->cond );  /* Signal waiting thread */
-   *(work->count) = cnt;
-   SDL_mutexV( work->mutex );
 
+/**
+ * @brief Runs a chunk of a parallel for.
+ */
+static int threadpool_rangeWorker( void *data )
+{
+   ThreadRange *r = (ThreadRange*) data;
+   r->function( r->start, r->end, r->data );
    return 0;
 }
 
-/* @brief Run every job in the vpool queue and block until every job in the
- *        queue is done.
+/**
+ * @brief Runs a function over an index range in parallel.
  *
- * @note It destroys the queue when it's done.
+ * The range is split into chunks of grain indices that are run by the
+ *  workers, and the call blocks until they are all done.
+ *
+ *    @param start First index.
+ *    @param end Index after the last.
+ *    @param grain Number of indices per chunk.
+ *    @param function Function to run on each chunk as [start,end).
+ *    @param data Arguments of the function.
  */
-void vpool_wait( ThreadQueue *queue )
+void threadpool_parallelFor( int start, int end, int grain,
+      void (*function)( int start, int end, void *data ), void *data )
 {
-   int i, cnt;
-   SDL_cond *cond;
-   SDL_mutex *mutex;
-   vpoolThreadData *arg;
-   ThreadQueueData *node;
-
-   /* Create temporary threading structures. */
-   cond  = SDL_CreateCond();
-   mutex = SDL_CreateMutex();
-   /* This might be a little ugly (and inefficient?) */
-   cnt   = SDL_SemValue( queue->semaphore );
-
-   /* Allocate all vpoolThreadData objects */
-   arg = calloc( cnt, sizeof(vpoolThreadData) );
-
-   SDL_mutexP( mutex );
-   /* Initialize the vpoolThreadData */
-   for (i=0; i<cnt; i++) {
-      /* This is needed to keep the invariants of the queue */
-      while (SDL_SemWait( queue->semaphore ) == -1) {
-          /* Again, a really bad idea */
-          WARN(_("SDL_SemWait failed! Error: %s"), SDL_GetError());
-      }
-      node = tq_dequeue( queue );
-
-      /* Set up arguments. */
-      arg[i].node    = node;
-      arg[i].cond    = cond;
-      arg[i].mutex   = mutex;
-      arg[i].count   = &cnt;
+   int i, n;
+   ThreadRange *r;
+   ThreadGroup *g;
+
+   if (end <= start)
+      return;
+   grain = MAX( 1, grain );
+   n     = (end - start + grain - 1) / grain;
+
+   /* Not worth the trouble. */
+   if ((n == 1) || (tp_workers == NULL)) {
+      function( start, end, data );
+      return;
+   }
 
-      /* Launch new job. */
-      threadpool_newJob( vpool_worker, &arg[i] );
+   r = malloc( n * sizeof(ThreadRange) );
+   g = tgroup_create();
+   for (i=0; i<n; i++) {
+      r[i].start     = start + i*grain;
+      r[i].end       = MIN( end, r[i].start + grain );
+      r[i].function  = function;
+      r[i].data      = data;
+      /* Run the first chunk ourselves. */
+      if (i > 0)
+         tgroup_run( g, threadpool_rangeWorker, &r[i] );
    }
+   threadpool_rangeWorker( &r[0] );
+   tgroup_wait( g );
+
+   tgroup_free( g );
+   free( r );
+}
 
-   /* Wait for the threads to finish */
-   SDL_CondWait( cond, mutex );
-   SDL_mutexV( mutex );
 
-   /* Clean up */
-   SDL_DestroyMutex( mutex );
-   SDL_DestroyCond( cond );
-   tq_destroy( queue );
-   free( arg );
+/**
+ * @brief Creates a new vpool queue.
+ *
+ * This is just an interface to make running a number of jobs and then wait for
+ *  them to finish more pleasant. Jobs start running as soon as they are
+ *  enqueued.
+ *
+ *    @return Returns a ThreadQueue to be used.
+ */
+ThreadQueue* vpool_create (void)
+{
+   ThreadQueue *q;
+
+   q        = malloc( sizeof(ThreadQueue) );
+   q->group = tgroup_create();
+
+   return q;
 }
 
+/**
+ * @brief Enqueue a job in the vpool queue.
+ */
+void vpool_enqueue( ThreadQueue *queue, int (*function)(void *), void *data )
+{
+   tgroup_run( queue->group, function, data );
+}
 
+/* @brief Block until every job in the queue is done.
+ *
+ * @note It destroys the queue when it's done.
+ */
+void vpool_wait( ThreadQueue *queue )
+{
+   tgroup_wait( queue->group );
+   tgroup_free( queue->group );
+   free( queue );
+}
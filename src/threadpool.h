@@ -20,23 +20,37 @@
 
 struct ThreadQueue_;
 typedef struct ThreadQueue_ ThreadQueue;
+struct ThreadGroup_;
+typedef struct ThreadGroup_ ThreadGroup;
 
 
 /* Initializes the threadpool */
 int threadpool_init( void );
+int threadpool_nworkers( void );
 
-/* Enqueues a new job */
+/* Enqueues a new job. Do NOT enqueue a job that has to wait for another job
+ * to be done as this could lead to a deadlock, use a group instead. */
 int threadpool_newJob( int (*function)(void *), void *data );
 
+/* Job groups. Waiting runs queued jobs, so jobs may wait on other groups. */
+ThreadGroup* tgroup_create( void );
+void tgroup_run( ThreadGroup *g, int (*function)(void *), void *data );
+void tgroup_then( ThreadGroup *g, int (*function)(void *), void *data );
+void tgroup_wait( ThreadGroup *g );
+void tgroup_free( ThreadGroup *g );
+
+/* Runs function over [start,end) split into chunks of grain indices. */
+void threadpool_parallelFor( int start, int end, int grain,
+      void (*function)( int start, int end, void *data ), void *data );
+
 /* Creates a new vpool queue */
 ThreadQueue* vpool_create( void );
 
-/* Enqueue a job in the vpool queue. Do NOT enqueue a job that has to wait for
- * another job to be done as this could lead to a deadlock. */
+/* Enqueue a job in the vpool queue. */
 void vpool_enqueue( ThreadQueue* queue, int (*function)(void *), void *data );
 
-/* Run every job in the vpool queue and block untill every job in the queue is
- * done. It destroys the queue when it's done. */
+/* Block until every job in the queue is done. It destroys the queue when it's
+ * done. */
 void vpool_wait( ThreadQueue* queue );
 
 
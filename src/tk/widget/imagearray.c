@@ -100,6 +100,7 @@ void window_addImageArray( const unsigned int wid,
    wgt->dat.iar.ih         = ih;
    wgt->dat.iar.fptr       = call;
    wgt->dat.iar.rmptr      = rmcall;
+   wgt->dat.iar.altptr     = NULL;
    wgt->dat.iar.xelem      = floor((w - 10.) / (double)(wgt->dat.iar.iw+10));
    wgt->dat.iar.yelem      = (wgt->dat.iar.xelem == 0) ? 0 :
          (int)wgt->dat.iar.nelements / wgt->dat.iar.xelem + 1;
@@ -280,6 +281,7 @@ static void iar_renderOverlay( Widget* iar, double bx, double by )
 {
    double x, y;
    const char *alt;
+   ImageArrayCell *cell;
 
    /*
     * Draw Alt text if applicable.
@@ -291,9 +293,19 @@ static void iar_renderOverlay( Widget* iar, double bx, double by )
       x = bx + iar->x + iar->dat.iar.altx;
       y = by + iar->y + iar->dat.iar.alty;
 
+      /* Generate alt text the first time it's needed. An empty string marks
+       * cells that have none, so the callback isn't run again. */
+      cell = &iar->dat.iar.images[iar->dat.iar.alt];
+      if ((cell->alt == NULL) && (iar->dat.iar.altptr != NULL)
+            && (cell->caption != NULL)) {
+         cell->alt = iar->dat.iar.altptr( cell->caption );
+         if (cell->alt == NULL)
+            cell->alt = strdup( "" );
+      }
+
       /* Draw alt text. */
-      alt = iar->dat.iar.images[iar->dat.iar.alt].alt;
-      if (alt != NULL)
+      alt = cell->alt;
+      if ((alt != NULL) && (alt[0] != '\0'))
          toolkit_drawAltText( x, y, alt );
    }
 }
@@ -858,3 +870,52 @@ int toolkit_unsetSelection( const unsigned int wid, const char *name )
 
   return 0;
 }
+
+
+/**
+ * @brief Sets the function used to generate alt text lazily.
+ *
+ * Cells without alt text will have it generated from their caption the first
+ * time it is displayed, which avoids formatting text nobody looks at.
+ *
+ *    @param wid Window containing the image array.
+ *    @param name Name of the image array widget.
+ *    @param altptr Function returning allocated alt text for a caption.
+ *    @return 0 on success.
+ */
+int toolkit_setImageArrayAltCallback( const unsigned int wid, const char *name,
+      char* (*altptr) (const char*) )
+{
+   Widget *wgt = iar_getWidget( wid, name );
+   if (wgt == NULL)
+      return -1;
+
+   wgt->dat.iar.altptr = altptr;
+
+   return 0;
+}
+
+
+/**
+ * @brief Changes the quantity displayed by an element without rebuilding.
+ *
+ *    @param wid Window containing the image array.
+ *    @param name Name of the image array widget.
+ *    @param elem Element to modify.
+ *    @param quantity New quantity of the element.
+ *    @return 0 on success.
+ */
+int toolkit_setImageArrayQuantity( const unsigned int wid, const char *name,
+      int elem, int quantity )
+{
+   Widget *wgt = iar_getWidget( wid, name );
+   if (wgt == NULL)
+      return -1;
+
+   if ((elem < 0) || (elem >= wgt->dat.iar.nelements))
+      return -1;
+
+   wgt->dat.iar.images[ elem ].quantity = quantity;
+
+   return 0;
+}
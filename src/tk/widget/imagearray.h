@@ -42,6 +42,7 @@ typedef struct WidgetImageArrayData_ {
    int ih; /**< Image height to use. */
    void (*fptr) (unsigned int,char*); /**< Modify callback - triggered on selection. */
    void (*rmptr) (unsigned int,char*); /**< Right click callback. */
+   char* (*altptr) (const char*); /**< Generates missing alt text from the caption. */
 } WidgetImageArrayData;
 
 
@@ -73,6 +74,10 @@ int toolkit_setImageArrayOffset( const unsigned int wid, const char* name, doubl
 int toolkit_saveImageArrayData( const unsigned int wid, const char *name,
       iar_data_t *iar_data );
 int toolkit_unsetSelection( const unsigned int wid, const char *name );
+int toolkit_setImageArrayAltCallback( const unsigned int wid, const char *name,
+      char* (*altptr) (const char*) );
+int toolkit_setImageArrayQuantity( const unsigned int wid, const char *name,
+      int elem, int quantity );
 
 
 #endif /* WGT_IMAGEARRAY_H */
@@ -27,6 +27,7 @@
 #include "ndata.h"
 #include "economy.h"
 #include "fleet.h"
+#include "map.h"
 #include "map_overlay.h"
 
 
@@ -744,6 +745,7 @@ static int diff_patch( xmlNodePtr parent )
 
    /* Update overlay map just in case. */
    ovr_refresh();
+   map_invalidateGeometry();
    return 0;
 }
 
@@ -939,6 +941,7 @@ void diff_remove( const char *name )
    diff_removeDiff(diff);
 
    economy_execQueued();
+   map_invalidateGeometry();
 }
 
 
@@ -954,6 +957,7 @@ void diff_clear (void)
       diff_removeDiff(&diff_stack[array_size(diff_stack)-1]);
 
    economy_execQueued();
+   map_invalidateGeometry();
 }
 
 
@@ -0,0 +1,261 @@
+/*
+ * Checks the instanced special effect shaders.
+ *
+ * Draws a few instances of a 2x2 sprite sheet through dat/glsl/spfx.vert and
+ * dat/glsl/spfx.frag the same way spfx_render() does, and reads the result
+ * back to make sure every instance got the right position and frame.
+ */
+#include "SDL.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "glad.h"
+
+#define FB_SIZE   64 /* Size of the framebuffer to render to. */
+#define SPR_SIZE  16 /* Size of a sprite on screen. */
+#define SKIPPED   77 /* Exit code meson takes as a skipped test. */
+
+static char *read_file( const char *dir, const char *name )
+{
+   char  path[4096];
+   FILE *f;
+   long  len;
+   char *buf;
+
+   snprintf( path, sizeof( path ), "%s/%s", dir, name );
+   f = fopen( path, "rb" );
+   if ( f == NULL ) {
+      fprintf( stderr, "Unable to open '%s'\n", path );
+      return NULL;
+   }
+   fseek( f, 0, SEEK_END );
+   len = ftell( f );
+   fseek( f, 0, SEEK_SET );
+   buf = calloc( len + 1, 1 );
+   if ( fread( buf, 1, len, f ) != (size_t)len ) {
+      free( buf );
+      buf = NULL;
+   }
+   fclose( f );
+   return buf;
+}
+
+static GLuint compile_shader( GLenum type, const char *dir, const char *name )
+{
+   GLuint shader;
+   GLint  status;
+   char   log[4096];
+   char * src;
+
+   src = read_file( dir, name );
+   if ( src == NULL )
+      return 0;
+
+   shader = glCreateShader( type );
+   glShaderSource( shader, 1, (const char **)&src, NULL );
+   glCompileShader( shader );
+   free( src );
+
+   glGetShaderiv( shader, GL_COMPILE_STATUS, &status );
+   if ( status == GL_FALSE ) {
+      glGetShaderInfoLog( shader, sizeof( log ), NULL, log );
+      fprintf( stderr, "%s: %s\n", name, log );
+      glDeleteShader( shader );
+      return 0;
+   }
+   return shader;
+}
+
+static GLuint load_program( const char *dir )
+{
+   GLuint vs, fs, program;
+   GLint  status;
+   char   log[4096];
+
+   vs = compile_shader( GL_VERTEX_SHADER, dir, "spfx.vert" );
+   fs = compile_shader( GL_FRAGMENT_SHADER, dir, "spfx.frag" );
+   if ( ( vs == 0 ) || ( fs == 0 ) )
+      return 0;
+
+   program = glCreateProgram();
+   glAttachShader( program, vs );
+   glAttachShader( program, fs );
+   glLinkProgram( program );
+   glDeleteShader( vs );
+   glDeleteShader( fs );
+
+   glGetProgramiv( program, GL_LINK_STATUS, &status );
+   if ( status == GL_FALSE ) {
+      glGetProgramInfoLog( program, sizeof( log ), NULL, log );
+      fprintf( stderr, "%s\n", log );
+      return 0;
+   }
+   return program;
+}
+
+static int check_spfx( const char *dir )
+{
+   /* Unit square like gl_squareVBO. */
+   static const GLfloat square[] = { 0., 0., 1., 0., 0., 1., 1., 1. };
+   /* 2x2 sheet, first row of data is the bottom row of sprites. */
+   static const GLubyte sheet[] = {
+      0,   0,   255, 255, /* Frame 2: blue. */
+      255, 255, 255, 255, /* Frame 3: white. */
+      255, 0,   0,   255, /* Frame 0: red. */
+      0,   255, 0,   255, /* Frame 1: green. */
+   };
+   static const GLubyte expected[4][3] = {
+      { 255, 0, 0 }, { 0, 255, 0 }, { 0, 0, 255 }, { 255, 255, 255 } };
+   GLfloat projection[16] = { 0 };
+   GLfloat instances[5][4];
+   GLuint  program, vao, vbo, ibo, itex, tex, fbo, fbtex;
+   GLubyte pixel[4];
+   int     i, frame, ret;
+
+   program = load_program( dir );
+   if ( program == 0 )
+      return 1;
+
+   /* Render target. */
+   glGenTextures( 1, &fbtex );
+   glBindTexture( GL_TEXTURE_2D, fbtex );
+   glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, FB_SIZE, FB_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+   glGenFramebuffers( 1, &fbo );
+   glBindFramebuffer( GL_FRAMEBUFFER, fbo );
+   glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, fbtex, 0 );
+   if ( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE ) {
+      fprintf( stderr, "Incomplete framebuffer\n" );
+      return 1;
+   }
+   glViewport( 0, 0, FB_SIZE, FB_SIZE );
+   glClearColor( 0., 0., 0., 1. );
+   glClear( GL_COLOR_BUFFER_BIT );
+
+   /* Sprite sheet. */
+   glGenTextures( 1, &tex );
+   glBindTexture( GL_TEXTURE_2D, tex );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+   glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, sheet );
+
+   /* Instance 0 must be skipped through the offset, the rest go left to right. */
+   instances[0][0] = 0.;
+   instances[0][1] = FB_SIZE - SPR_SIZE;
+   instances[0][2] = 0.;
+   instances[0][3] = 1.;
+   for ( i = 0; i < 4; i++ ) {
+      instances[i + 1][0] = i * SPR_SIZE;
+      instances[i + 1][1] = 0.;
+      instances[i + 1][2] = 3 - i;
+      instances[i + 1][3] = 1.;
+   }
+   glGenBuffers( 1, &ibo );
+   glBindBuffer( GL_TEXTURE_BUFFER, ibo );
+   glBufferData( GL_TEXTURE_BUFFER, sizeof( instances ), instances, GL_STREAM_DRAW );
+   glGenTextures( 1, &itex );
+   glBindTexture( GL_TEXTURE_BUFFER, itex );
+   glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA32F, ibo );
+
+   /* Quad. */
+   glGenVertexArrays( 1, &vao );
+   glBindVertexArray( vao );
+   glGenBuffers( 1, &vbo );
+   glBindBuffer( GL_ARRAY_BUFFER, vbo );
+   glBufferData( GL_ARRAY_BUFFER, sizeof( square ), square, GL_STATIC_DRAW );
+
+   /* Pixel coordinates to clip space. */
+   projection[0]  = 2. / FB_SIZE;
+   projection[5]  = 2. / FB_SIZE;
+   projection[10] = -1.;
+   projection[12] = -1.;
+   projection[13] = -1.;
+   projection[15] = 1.;
+
+   glUseProgram( program );
+   glActiveTexture( GL_TEXTURE1 );
+   glBindTexture( GL_TEXTURE_BUFFER, itex );
+   glActiveTexture( GL_TEXTURE0 );
+   glBindTexture( GL_TEXTURE_2D, tex );
+   glUniform1i( glGetUniformLocation( program, "instances" ), 1 );
+   glUniformMatrix4fv( glGetUniformLocation( program, "projection" ), 1, GL_FALSE, projection );
+   glUniform2f( glGetUniformLocation( program, "dims" ), SPR_SIZE, SPR_SIZE );
+   glUniform2f( glGetUniformLocation( program, "sprites" ), 2., 2. );
+   glUniform2f( glGetUniformLocation( program, "tex_dims" ), .5, .5 );
+   glUniform1i( glGetUniformLocation( program, "offset" ), 1 );
+   glEnableVertexAttribArray( glGetAttribLocation( program, "vertex" ) );
+   glVertexAttribPointer( glGetAttribLocation( program, "vertex" ), 2, GL_FLOAT, GL_FALSE, 0, NULL );
+   glDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, 4 );
+   glFinish();
+
+   if ( glGetError() != GL_NO_ERROR ) {
+      fprintf( stderr, "OpenGL error while drawing\n" );
+      return 1;
+   }
+
+   /* Check each instance and the skipped one. */
+   ret = 0;
+   for ( i = 0; i < 4; i++ ) {
+      frame = 3 - i;
+      glReadPixels( i * SPR_SIZE + SPR_SIZE / 2, SPR_SIZE / 2, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel );
+      if ( ( pixel[0] != expected[frame][0] ) || ( pixel[1] != expected[frame][1] ) ||
+           ( pixel[2] != expected[frame][2] ) ) {
+         fprintf( stderr, "Instance %d: expected frame %d (%d,%d,%d), got (%d,%d,%d)\n", i, frame,
+                  expected[frame][0], expected[frame][1], expected[frame][2], pixel[0], pixel[1],
+                  pixel[2] );
+         ret = 1;
+      }
+   }
+   glReadPixels( SPR_SIZE / 2, FB_SIZE - SPR_SIZE / 2, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel );
+   if ( pixel[0] || pixel[1] || pixel[2] ) {
+      fprintf( stderr, "Instance before offset was drawn\n" );
+      ret = 1;
+   }
+
+   return ret;
+}
+
+int main( int argc, char **argv )
+{
+   SDL_Window *  window;
+   SDL_GLContext context;
+   int           ret;
+
+   if ( argc < 2 ) {
+      fprintf( stderr, "Usage: %s GLSL_DIR\n", argv[0] );
+      exit( -1 );
+   }
+
+   /* No OpenGL 3.1 context means there is nothing to test. */
+   if ( SDL_Init( SDL_INIT_VIDEO ) ) {
+      exit( SKIPPED );
+   }
+
+   SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 3 );
+   SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 1 );
+   SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
+
+   window = SDL_CreateWindow( "SPFX Instancing", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 1, 1,
+                              SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN );
+   if ( window == NULL ) {
+      exit( SKIPPED );
+   }
+
+   context = SDL_GL_CreateContext( window );
+   if ( !context ) {
+      exit( SKIPPED );
+   }
+
+   if ( !gladLoadGLLoader( SDL_GL_GetProcAddress ) || !GLAD_GL_VERSION_3_1 ) {
+      exit( SKIPPED );
+   }
+
+   printf( "%s\n", glGetString( GL_RENDERER ) );
+
+   ret = check_spfx( argv[1] );
+
+   SDL_GL_DeleteContext( context );
+   SDL_DestroyWindow( window );
+   SDL_Quit();
+
+   exit( ret );
+}
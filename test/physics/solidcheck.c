@@ -0,0 +1,214 @@
+/*
+ * Checks and benchmarks the solid integrators in src/physics.c.
+ *
+ * Without arguments it flies a ship thrusting while turning with RK4 and the
+ * semi-implicit integrator at several frame times, and compares the final
+ * positions against RK4 run with tiny steps. With "bench" it times solid
+ * updates and the on demand polar components of vectors instead.
+ */
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "conf.h"
+#include "physics.h"
+
+#define FLIGHT_TIME  10.   /* Seconds of flight for the accuracy check. */
+#define REF_DT       1e-4  /* Frame time of the reference flight. */
+#define MAX_ERROR    50.   /* Largest position error allowed, in pixels. */
+#define NSOLIDS      1024  /* Solids updated together by the benchmark. */
+#define BENCH_TIME   0.5   /* Seconds to run each benchmark for. */
+
+PlayerConf_t conf; /* physics.c reads conf.semi_implicit. */
+
+/* Logging used by WARN() and ERR() in physics.c. */
+int logprintf( FILE *stream, int newline, const char *fmt, ... )
+{
+   va_list ap;
+   int     n;
+
+   va_start( ap, fmt );
+   n = vfprintf( stream, fmt, ap );
+   va_end( ap );
+   if ( newline )
+      fputc( '\n', stream );
+   return n;
+}
+
+/* Sets up a ship like a pilot does, thrusting and turning at 1.5 rad/s. */
+static void setup_ship( Solid *s, int update, double speed )
+{
+   Vector2d pos, vel;
+
+   vect_cset( &pos, 0., 0. );
+   vect_cset( &vel, speed, 0. );
+   solid_init( s, 100., 0.3, &pos, &vel, update );
+   s->thrust    = 30000.;
+   s->dir_vel   = 1.5;
+   s->speed_max = fmax( 350., speed + 100. );
+}
+
+static void fly( Solid *s, double dt, double t )
+{
+   int i, n;
+
+   n = (int)round( t / dt );
+   for ( i = 0; i < n; i++ )
+      s->update( s, dt );
+}
+
+static double now( void )
+{
+   return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static int check_accuracy( void )
+{
+   static const double dts[] = { 1. / 60., 1. / 30., 0.1, 0.25 };
+   Solid  ref, rk4, semi;
+   double erk4, esemi;
+   int    i, ret;
+
+   setup_ship( &ref, SOLID_UPDATE_RK4, 100. );
+   fly( &ref, REF_DT, FLIGHT_TIME );
+
+   ret = 0;
+   for ( i = 0; i < (int)( sizeof( dts ) / sizeof( dts[0] ) ); i++ ) {
+      setup_ship( &rk4, SOLID_UPDATE_RK4, 100. );
+      setup_ship( &semi, SOLID_UPDATE_SEMI, 100. );
+      fly( &rk4, dts[i], FLIGHT_TIME );
+      fly( &semi, dts[i], FLIGHT_TIME );
+      erk4  = vect_dist( &rk4.pos, &ref.pos );
+      esemi = vect_dist( &semi.pos, &ref.pos );
+      printf( "dt=%.3f s: RK4 error %6.2f px, semi-implicit error %6.2f px\n", dts[i], erk4,
+              esemi );
+      if ( ( erk4 > MAX_ERROR ) || ( esemi > MAX_ERROR ) ) {
+         fprintf( stderr, "Position error over %g px at dt=%g s\n", MAX_ERROR, dts[i] );
+         ret = 1;
+      }
+   }
+   return ret;
+}
+
+static int check_polar( void )
+{
+   Vector2d v;
+   int      ret;
+
+   ret = 0;
+   vect_pset( &v, 3., 1. );
+   if ( ( fabs( VMOD( v ) - 3. ) > 1e-9 ) || ( fabs( VANGLE( v ) - 1. ) > 1e-9 ) ) {
+      fprintf( stderr, "vect_pset( 3, 1 ) reads back as (%g, %g)\n", VMOD( v ), VANGLE( v ) );
+      ret = 1;
+   }
+   /* Polar components are computed from x and y, so the modulus is never negative. */
+   vect_pset( &v, -3., 1. );
+   if ( ( fabs( VMOD( v ) - 3. ) > 1e-9 ) || ( fabs( VANGLE( v ) - ( 1. - M_PI ) ) > 1e-9 ) ) {
+      fprintf( stderr, "vect_pset( -3, 1 ) reads back as (%g, %g)\n", VMOD( v ), VANGLE( v ) );
+      ret = 1;
+   }
+   return ret;
+}
+
+/* Times updating a single solid over and over. */
+static double bench_single( int update, double speed )
+{
+   Solid  s;
+   double t0, t;
+   long   n;
+
+   setup_ship( &s, update, speed );
+   n  = 0;
+   t0 = now();
+   do {
+      fly( &s, 1. / 60., 1. );
+      n += 60;
+      t = now() - t0;
+   } while ( t < BENCH_TIME );
+   return t / n * 1e9;
+}
+
+/* Times updating many solids once per frame, like the pilot and weapon stacks. */
+static double bench_stack( int update, double speed )
+{
+   Solid *s;
+   double t0, t;
+   long   n;
+   int    i;
+
+   s = malloc( NSOLIDS * sizeof( Solid ) );
+   for ( i = 0; i < NSOLIDS; i++ ) {
+      setup_ship( &s[i], update, speed );
+      s[i].dir = i * 2. * M_PI / NSOLIDS;
+   }
+   n  = 0;
+   t0 = now();
+   do {
+      for ( i = 0; i < NSOLIDS; i++ )
+         s[i].update( &s[i], 1. / 60. );
+      n += NSOLIDS;
+      t = now() - t0;
+   } while ( t < BENCH_TIME );
+   free( s );
+   return t / n * 1e9;
+}
+
+/* Times reading the polar components of velocities. */
+static double bench_polar( void )
+{
+   Solid           *s;
+   volatile double  sink;
+   double           t0, t, acc;
+   long             n;
+   int              i;
+
+   s = malloc( NSOLIDS * sizeof( Solid ) );
+   for ( i = 0; i < NSOLIDS; i++ )
+      setup_ship( &s[i], SOLID_UPDATE_RK4, 10. * i );
+   n   = 0;
+   acc = 0.;
+   t0  = now();
+   do {
+      for ( i = 0; i < NSOLIDS; i++ )
+         acc += VMOD( s[i].vel ) + VANGLE( s[i].vel );
+      n += NSOLIDS;
+      t = now() - t0;
+   } while ( t < BENCH_TIME );
+   sink = acc;
+   (void)sink;
+   free( s );
+   return t / n * 1e9;
+}
+
+static void bench( void )
+{
+   printf( "Single solid, 1/60 s update:\n" );
+   printf( "   RK4            %6.1f ns\n", bench_single( SOLID_UPDATE_RK4, 100. ) );
+   printf( "   semi-implicit  %6.1f ns\n", bench_single( SOLID_UPDATE_SEMI, 100. ) );
+   printf( "Single solid at 1200 px/s, 1/60 s update:\n" );
+   printf( "   RK4            %6.1f ns\n", bench_single( SOLID_UPDATE_RK4, 1200. ) );
+   printf( "   semi-implicit  %6.1f ns\n", bench_single( SOLID_UPDATE_SEMI, 1200. ) );
+   printf( "%d solids, 1/60 s update, per solid:\n", NSOLIDS );
+   printf( "   RK4            %6.1f ns\n", bench_stack( SOLID_UPDATE_RK4, 100. ) );
+   printf( "   semi-implicit  %6.1f ns\n", bench_stack( SOLID_UPDATE_SEMI, 100. ) );
+   printf( "VMOD() and VANGLE() of a velocity: %6.1f ns\n", bench_polar() );
+}
+
+int main( int argc, char **argv )
+{
+   int ret;
+
+   memset( &conf, 0, sizeof( conf ) );
+
+   if ( ( argc > 1 ) && ( strcmp( argv[1], "bench" ) == 0 ) ) {
+      bench();
+      exit( 0 );
+   }
+
+   ret = check_accuracy();
+   ret |= check_polar();
+   exit( ret );
+}